@@ -0,0 +1,335 @@
+///
+/// @file Bvh.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Bounding volume hierarchy over the patches of a scene, used to find
+///     the nearest patch along a ray in logarithmic time.
+///
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "point.h"
+#include "vector.h"
+#include "patch.h"
+#include "patchpacket.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace Radiosity
+{
+
+///
+/// @name Frustum
+///
+/// @description
+/// 	The pyramid swept out by the rays leaving one origin through a
+///     quadrilateral, such as a tile of hemicube cells, optionally cut
+///     off by a far plane.
+///
+struct Frustum
+{
+    ///
+    /// @name Set
+    ///
+    /// @description
+    /// 	Bounds the frustum by the planes through the origin and each
+    ///     pair of neighbouring corner rays, with no far plane. Corner
+    ///     rays along one line leave sides without a plane, which then
+    ///     bound nothing.
+    ///
+    /// @param origin - the shared origin of the rays
+    /// @param corners - the corner rays, in order around the frustum
+    ///
+    void Set(const Point &origin, const Vector corners[4]);
+
+    ///
+    /// @name SetFar
+    ///
+    /// @description
+    /// 	Cuts the frustum off at a plane, keeping the side the origin
+    ///     lies on.
+    ///
+    /// @param point - a point on the plane
+    /// @param normal - the normal of the plane
+    ///
+    void SetFar(const Point &point, const Vector &normal);
+
+    float mOrigin[3];
+
+    ///
+    /// @name mPlanes
+    ///
+    /// @description
+    ///		The bounding planes, each a unit normal facing into the frustum
+    ///     followed by an offset, so that a point x is inside when
+    ///     dot(normal, x) + offset >= 0. The far plane, if any, is last.
+    ///
+    float mPlanes[5][4];
+
+    unsigned int mCount;
+};
+
+class Bvh
+{
+public:
+
+    ///
+    /// @name Bvh
+    ///
+    /// @description
+    /// 	Constructor. Builds the hierarchy with the surface area
+    ///     heuristic and flattens it into a contiguous node array. Patches
+    ///     are identified by their position in the given vector, which is
+    ///     usually also their index (see Patch::GetIndex).
+    ///
+    /// @param patches - the patches to build the hierarchy over
+    ///
+    Bvh(const std::vector<Patch*> *patches);
+
+    ///
+    /// @name ~Bvh
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~Bvh();
+
+    ///
+    /// @name Intersect
+    ///
+    /// @description
+    /// 	Finds the nearest patch in front of the ray origin.
+    ///
+    /// @param v - direction vector of the ray
+    /// @param o - origin of the ray
+    /// @param ignore - index of a patch to skip, typically the patch the
+    ///                 ray leaves from; pass -1 to test every patch
+    /// @param distance - receives the distance to the hit along the ray
+    /// @return - index of the nearest patch hit, or -1 if there is none
+    ///
+    int Intersect(const Vector &v, const Point &o, int ignore,
+                  float &distance) const;
+
+    ///
+    /// @name Occluded
+    ///
+    /// @description
+    /// 	Determines if any patch lies on the ray before a given distance.
+    ///     Stops at the first such patch rather than looking for the
+    ///     nearest one.
+    ///
+    /// @param v - normalized direction vector of the ray
+    /// @param o - origin of the ray
+    /// @param distance - only patches closer than this along the ray count
+    /// @param ignore1 - index of a patch to skip, or -1
+    /// @param ignore2 - index of another patch to skip, or -1
+    /// @return - true if some patch blocks the ray
+    ///
+    bool Occluded(const Vector &v, const Point &o, float distance,
+                  int ignore1, int ignore2) const;
+
+    ///
+    /// @name Occupied
+    ///
+    /// @description
+    /// 	Determines if any patch may lie partly inside a frustum. The
+    ///     tests allow for rounding, so the answer errs towards true.
+    ///
+    /// @param frustum - the frustum
+    /// @param ignore1 - index of a patch to skip, or -1
+    /// @param ignore2 - index of another patch to skip, or -1
+    /// @return - false if no patch but the skipped ones can be hit by a
+    ///           ray inside the frustum
+    ///
+    bool Occupied(const Frustum &frustum, int ignore1, int ignore2) const;
+
+    ///
+    /// @name NodeCount
+    ///
+    /// @description
+    /// 	Accessor for the number of nodes in the hierarchy.
+    ///
+    /// @return - the number of nodes
+    ///
+    unsigned int NodeCount() const;
+
+    ///
+    /// @name SetKernel
+    ///
+    /// @description
+    /// 	Chooses the kernel leaves are intersected with. Falls back to
+    ///     the widest supported kernel if the processor lacks the one
+    ///     asked for.
+    ///
+    /// @param kernel - the kernel to use
+    ///
+    void SetKernel(PatchPacket::Kernel kernel);
+
+    ///
+    /// @name GetKernel
+    ///
+    /// @description
+    /// 	Accessor for the kernel leaves are intersected with.
+    ///
+    /// @return - the kernel
+    ///
+    PatchPacket::Kernel GetKernel() const;
+
+    ///
+    /// @name ValidateKernel
+    ///
+    /// @description
+    /// 	Checks the kernel in use against Patch::Intersect. Rays run from
+    ///     the centers of patches to the centers and corners of others,
+    ///     and each is intersected with every packet of patches; each
+    ///     distance must match the one Patch::Intersect gives, bit for
+    ///     bit.
+    ///
+    /// @param tested - receives the number of distances compared
+    /// @return - the number of distances that differ
+    ///
+    std::size_t ValidateKernel(std::size_t &tested) const;
+
+private:
+
+    ///
+    /// @name Node
+    ///
+    /// @description
+    /// 	A node of the flattened hierarchy. Nodes are laid out depth
+    ///     first, so the first child of an interior node immediately
+    ///     follows it and only the second child's position is stored.
+    ///
+    struct Node
+    {
+        float mMin[3];
+        float mMax[3];
+
+        // Leaf: first entry in mPrimitives. Interior: second child.
+        uint32_t mOffset;
+
+        // Number of primitives in a leaf, zero for interior nodes.
+        uint16_t mCount;
+
+        // Axis the node was split along, used to visit the nearer child
+        // first.
+        uint16_t mAxis;
+    };
+
+    ///
+    /// @name Bounds
+    ///
+    /// @description
+    /// 	Axis-aligned bounding box used while building.
+    ///
+    struct Bounds
+    {
+        float mMin[3];
+        float mMax[3];
+
+        Bounds();
+        void Grow(const Bounds &other);
+        void Grow(const float p[3]);
+        float Area() const;
+    };
+
+    ///
+    /// @name Build
+    ///
+    /// @description
+    /// 	Recursively builds the subtree over mPrimitives[begin, end) and
+    ///     appends it to mNodes. Splits at the centroid median instead of
+    ///     by the surface area heuristic when that finds no split of a
+    ///     node too large for a leaf, or when the subtree would otherwise
+    ///     outgrow BVH_MAX_DEPTH, so leaves stay within a packet and the
+    ///     tree within the traversal stack.
+    ///
+    /// @param begin - first primitive of the subtree
+    /// @param end - one past the last primitive of the subtree
+    /// @param depth - depth of the subtree's root, zero for the root
+    /// @param bounds - per-patch bounding boxes
+    /// @param centroids - per-patch bounding box centers, three floats
+    ///                    per patch
+    ///
+    void Build(unsigned int begin, unsigned int end, unsigned int depth,
+               const std::vector<Bounds> &bounds,
+               const std::vector<float> &centroids);
+
+    ///
+    /// @name Outside
+    ///
+    /// @description
+    /// 	Determines if a box lies wholly outside one plane of a frustum,
+    ///     by more than mMargin.
+    ///
+    /// @param min - lower corner of the box
+    /// @param max - upper corner of the box
+    /// @param frustum - the frustum
+    /// @return - true if no ray inside the frustum meets the box
+    ///
+    bool Outside(const float min[3], const float max[3],
+                 const Frustum &frustum) const;
+
+    ///
+    /// @name Outside
+    ///
+    /// @description
+    /// 	Determines if a patch lies wholly outside a frustum, by more
+    ///     than mMargin, by clipping it to each plane in turn. Tighter
+    ///     than testing its box one plane at a time.
+    ///
+    /// @param patch - the patch
+    /// @param frustum - the frustum
+    /// @return - true if no ray inside the frustum meets the patch
+    ///
+    bool Outside(const Patch *patch, const Frustum &frustum) const;
+
+    const std::vector<Patch*> *mPatches;
+
+    std::vector<Node> mNodes;
+
+    ///
+    /// @name mBounds
+    ///
+    /// @description
+    ///		Bounding box of each patch, by patch index.
+    ///
+    std::vector<Bounds> mBounds;
+
+    ///
+    /// @name mMargin
+    ///
+    /// @description
+    ///		Slack given to frustum tests, so that rounding never has a box
+    ///     counted outside a frustum that a ray inside it would meet.
+    ///
+    float mMargin;
+
+    ///
+    /// @name mPrimitives
+    ///
+    /// @description
+    ///		Patch indices, ordered so that each leaf refers to a contiguous
+    ///     range.
+    ///
+    std::vector<uint32_t> mPrimitives;
+
+    ///
+    /// @name mPacket
+    ///
+    /// @description
+    ///		The geometry of the patches in the order of mPrimitives, so
+    ///     that the patches of a leaf are tested together.
+    ///
+    PatchPacket mPacket;
+
+};  // class Bvh
+
+}   // namespace Radiosity
+
+#endif
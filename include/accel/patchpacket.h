@@ -0,0 +1,210 @@
+///
+/// @file PatchPacket.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Patches laid out as structure-of-arrays floats, for intersecting
+///     a ray with up to eight patches at once using SSE or AVX2 when the
+///     processor supports them.
+///
+
+#ifndef PATCH_PACKET_H
+#define PATCH_PACKET_H
+
+#include "patch.h"
+
+#include <vector>
+#include <stdint.h>
+
+// Number of patches handled by one call to a kernel
+#define PACKET_WIDTH 8
+
+namespace Radiosity
+{
+
+class PatchPacket
+{
+public:
+
+    ///
+    /// @name Kernel
+    ///
+    /// @description
+    /// 	Instruction set used to intersect a packet.
+    ///
+    ///     SCALAR - plain C++, available everywhere
+    ///     SSE - two four-wide SSE2 passes
+    ///     AVX2 - one eight-wide AVX2 pass
+    ///
+    enum Kernel
+    {
+        SCALAR,
+        SSE,
+        AVX2
+    };
+
+    ///
+    /// @name PatchPacket
+    ///
+    /// @description
+    /// 	Constructor. Holds no patches until Reset is called, and picks
+    ///     the widest kernel the processor supports.
+    ///
+    PatchPacket();
+
+    ///
+    /// @name ~PatchPacket
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~PatchPacket();
+
+    ///
+    /// @name Reset
+    ///
+    /// @description
+    /// 	Copies the geometry of the patches, in the given order.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param order - indices of the patches; the patch at order[k] is
+    ///                stored at position k
+    ///
+    void Reset(const std::vector<Patch*> *patches,
+               const std::vector<uint32_t> &order);
+
+    ///
+    /// @name Intersect
+    ///
+    /// @description
+    /// 	Intersects one ray with the PACKET_WIDTH patches stored from a
+    ///     position onwards. Gives the same distances as Patch::Intersect.
+    ///     Positions past the last patch always miss.
+    ///
+    /// @param origin - origin of the ray
+    /// @param direction - direction vector of the ray
+    /// @param position - position of the first patch
+    /// @param distances - receives the distance along the ray to each
+    ///                    patch, zero or less if the ray misses it
+    ///
+    void Intersect(const float origin[3], const float direction[3],
+                   unsigned int position,
+                   float distances[PACKET_WIDTH]) const;
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of patches.
+    ///
+    /// @return - the number of patches
+    ///
+    unsigned int Size() const;
+
+    ///
+    /// @name GetKernel
+    ///
+    /// @description
+    /// 	Accessor for the kernel in use.
+    ///
+    /// @return - the kernel
+    ///
+    Kernel GetKernel() const;
+
+    ///
+    /// @name SetKernel
+    ///
+    /// @description
+    /// 	Chooses the kernel to use, such as the scalar one for checking
+    ///     the others. Falls back to the widest supported kernel if the
+    ///     processor lacks the one asked for.
+    ///
+    /// @param kernel - the kernel to use
+    ///
+    void SetKernel(Kernel kernel);
+
+    ///
+    /// @name Supported
+    ///
+    /// @description
+    /// 	Determines the widest kernel the processor supports.
+    ///
+    /// @return - the kernel
+    ///
+    static Kernel Supported();
+
+    ///
+    /// @name KernelName
+    ///
+    /// @description
+    /// 	Names a kernel for printing.
+    ///
+    /// @param kernel - the kernel
+    /// @return - its name
+    ///
+    static const char* KernelName(Kernel kernel);
+
+    ///
+    /// @name Field
+    ///
+    /// @description
+    /// 	The rows of mData. A is the corner the plane is anchored at, BC
+    ///     and CD are the edges leaving corner C, and the lengths are the
+    ///     squared lengths of those edges.
+    ///
+    enum Field
+    {
+        A_X, A_Y, A_Z,
+        C_X, C_Y, C_Z,
+        BC_X, BC_Y, BC_Z,
+        CD_X, CD_Y, CD_Z,
+        NORMAL_X, NORMAL_Y, NORMAL_Z,
+        BC_LENGTH,
+        CD_LENGTH,
+        FIELD_COUNT
+    };
+
+private:
+
+    PatchPacket(const PatchPacket &);
+    PatchPacket &operator=(const PatchPacket &);
+
+    unsigned int mSize;
+
+    ///
+    /// @name mStride
+    ///
+    /// @description
+    ///		Length of each row of mData. Leaves room for a full packet to
+    ///     be loaded from the last patch; the padding is all zeros, which
+    ///     no ray can hit.
+    ///
+    unsigned int mStride;
+
+    ///
+    /// @name mData
+    ///
+    /// @description
+    ///		FIELD_COUNT rows of mStride floats each.
+    ///
+    std::vector<float> mData;
+
+    Kernel mKernel;
+
+};  // class PatchPacket
+
+inline unsigned int PatchPacket::Size() const
+{
+    return mSize;
+}
+
+inline PatchPacket::Kernel PatchPacket::GetKernel() const
+{
+    return mKernel;
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -88,6 +88,16 @@ public:
     ///
     inline Color GetColor() const;
 
+    ///
+    /// @name X, Y, Z
+    ///
+    /// @description
+    ///     Accessors for the coordinates of this point.
+    ///
+    inline float X() const;
+    inline float Y() const;
+    inline float Z() const;
+
     ///
     /// @name operator=
     ///
@@ -110,16 +120,6 @@ public:
     ///
     inline float DistanceTo(const Point& other) const;
 
-    ///
-    /// @name UpdateColor
-    ///
-    /// @description
-    /// 	Average in the given color using the given weight
-    ///
-    /// @param color - the color to average in.
-    ///
-    void UpdateColor(const Color& color);
-
     void Draw();
     void DrawNoColor();
 
@@ -137,15 +137,6 @@ private:
     ///
     Color mColor;
 
-    ///
-    /// @name mCount
-    ///
-    /// @description
-    /// 	Number of colors which have been averaged in
-    ///
-    int mCount;
-
-
 };  // class Point
 
 inline Color Point::GetColor() const
@@ -153,6 +144,21 @@ inline Color Point::GetColor() const
     return (mColor);
 }
 
+inline float Point::X() const
+{
+    return x;
+}
+
+inline float Point::Y() const
+{
+    return y;
+}
+
+inline float Point::Z() const
+{
+    return z;
+}
+
 inline Point& Point::operator=(const Point& other)
 {
     x = other.x;
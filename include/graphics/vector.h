@@ -87,6 +87,16 @@ public:
 
     inline Point Translate(const Point &p);
 
+    ///
+    /// @name X, Y, Z
+    ///
+    /// @description
+    ///     Accessors for the components of this vector.
+    ///
+    inline float X() const;
+    inline float Y() const;
+    inline float Z() const;
+
 private:
 
     ///
@@ -121,6 +131,21 @@ inline Point Vector::Translate(const Point &p)
 	return Point(p.x + _x, p.y + _y, p.z + _z);
 }
 
+inline float Vector::X() const
+{
+    return _x;
+}
+
+inline float Vector::Y() const
+{
+    return _y;
+}
+
+inline float Vector::Z() const
+{
+    return _z;
+}
+
 }   // namespace Radiosity
 
 #endif
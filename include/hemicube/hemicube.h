@@ -15,6 +15,9 @@
 #include "vector.h"
 #include "patch.h"
 #include "rectangle.h"
+#include "rectanglebatch.h"
+#include "bvh.h"
+#include "formfactormatrix.h"
 
 #include <vector>
 #include <cstdlib>
@@ -32,15 +35,41 @@ class Hemicube
 
 public:
 
+    ///
+    /// @name Backend
+    ///
+    /// @description
+    /// 	How the patch seen through each cell of a face is determined.
+    ///
+    ///     RAY_CAST - fire one ray per cell and intersect it with the scene
+    ///     Z_BUFFER - project every patch onto the face and keep the
+    ///                nearest one per cell in an item buffer
+    ///
+    enum Backend
+    {
+        RAY_CAST,
+        Z_BUFFER
+    };
+
     ///
     /// @name Hemicube
     ///
     /// @description
     /// 	Constructor
     ///
-    /// @param subdivisions - resolution of the hemicube
+    /// @param subdivisions - resolution of the hemicube, i.e. the number of
+    ///                       cells across the front face. Rounded up with
+    ///                       RoundResolution.
+    /// @param quads - the quads making up the scene
+    /// @param patches - the patches making up the scene
+    /// @param bvh - hierarchy over the scene's patches used to find the
+    ///              patch seen through each cell, or nullptr to find the
+    ///              nearest quad and test the viewable patches cut from it
+    /// @param backend - how each face is traced
     ///
-    Hemicube(int subdivisions, std::vector<Rectangle*> *quads);
+    Hemicube(int subdivisions, std::vector<Rectangle*> *quads,
+             const std::vector<Patch*> *patches, const Bvh *bvh,
+             Backend backend);
 
     ///
     /// @name ~Hemicube
@@ -55,11 +84,39 @@ public:
     ///
     /// @description
     /// 	Position the hemicube over the given patch and trace energy through
-    ///     all faces.
+    ///     all faces. A hemicube keeps scratch state while tracing, so each
+    ///     thread needs its own instance.
     ///
     /// @param patch - the patch indicating where to position the hemicube
+    /// @param viewable - indices of the patches with line of sight to it
+    /// @param row - receives the form factors from the patch to every
+    ///              viewable patch, in the order of the viewable list
+    ///
+    void TraceHemicube(Patch *patch, const std::vector<uint32_t> &viewable,
+                       std::vector<FormFactorMatrix::Entry> &row);
+
+    ///
+    /// @name GetResolution
+    ///
+    /// @description
+    /// 	Accessor for the resolution of the hemicube.
+    ///
+    /// @return - the number of cells across the front face
+    ///
+    int GetResolution() const;
+
     ///
-    void TraceHemicube(Patch *patch);
+    /// @name RoundResolution
+    ///
+    /// @description
+    /// 	Rounds a requested resolution up to one the hemicube supports:
+    ///     an even number, so that the side faces cover exactly half of
+    ///     the front face, and at least two.
+    ///
+    /// @param subdivisions - the requested resolution
+    /// @return - the resolution that will be used
+    ///
+    static int RoundResolution(int subdivisions);
 
 private:
 
@@ -67,64 +124,99 @@ private:
     /// @name BuildMultipliers
     ///
     /// @description
-    /// 	Calculate the energy values for all faces of the hemicube.
+    /// 	Look up the energy values for all faces of the hemicube. The
+    ///     values are normalized so that all faces together add to unity.
     ///
     void BuildMultipliers( void );
 
     ///
-    /// @name NormalizeMultipliers
+    /// @name TraceFace
     ///
     /// @description
-    /// 	Normalizes all multipliers so that the total energy of all faces
-    ///     of the hemicube adds to unity.
+    /// 	Trace a single face of the hemicube. This is a private helper
+    ///     function for the public TraceHemicube function.
     ///
+    /// @param patch - the patch at the origin of the hemicube
+    /// @param startingPoint - the origin of the hemicube
+    /// @param row - a vector that specifies the row
+    /// @param col - a vector that specifies the column
+    /// @param multiplier - the view of the shared table for this face
     ///
-    void NormalizeMultipliers( void );
+    void TraceFace(Patch *patch, Point startingPoint, Vector row, Vector col,
+                   Multiplier *multiplier);
 
     ///
-    /// @name BuildMultiplier
+    /// @name TraceTile
     ///
     /// @description
-    /// 	This is a private helper function for the private function,
-    ///     BuildMultipliers. It builds the multiplier for a single face
-    ///     of the hemicube.
+    /// 	Finds the patch each cell of a tile of the face lands on,
+    ///     recording it in mCellHits. Only the corner rays are traced when
+    ///     they prove the whole tile lands on one patch; otherwise the
+    ///     tile is split in four, down to single rays.
+    ///
+    /// @param patch - the patch at the origin of the hemicube
+    /// @param top - first row of the tile
+    /// @param left - first column of the tile
+    /// @param rows - number of rows in the tile
+    /// @param columns - number of columns in the tile
+    /// @param width - number of columns of cells on the face
+    ///
+    void TraceTile(Patch *patch, unsigned int top, unsigned int left,
+                   unsigned int rows, unsigned int columns,
+                   unsigned int width);
+
     ///
-    /// @param centerPoint - center point of the hemicube
-    /// @param starting point - starting corner of the face for which to build
-    ///                         the multiplier
-    /// @param patchNormal - the normal of the patch located at the center of
-    ///                      the hemicube
-    /// @param faceNormal - the normal of the face for which the multiplier
-    ///                     is being built
-    /// @param row - vector specifying the row direction
-    /// @param col - vector specifying the column direction
-    /// @param numRows - the number of rows on this face
-    /// @param numCols - the number of columns on this face
+    /// @name Interior
     ///
-    /// @return - the multiplier for this face
+    /// @description
+    /// 	Determines if a ray meets a patch clear of its edges.
     ///
-    std::vector< std::vector<float>* > *BuildMultiplier(Point centerPoint,
-        Point startingPoint, Vector patchNormal, Vector faceNormal, Vector row,
-        Vector col, int numRows, int numCols);
+    /// @param other - the patch the ray meets
+    /// @param ray - direction of the ray
+    /// @param origin - origin of the ray
+    /// @param distance - distance along the ray to the patch
+    /// @return - true if the ray lands inside the patch by a margin
+    ///
+    bool Interior(const Patch *other, const Vector &ray,
+                  const Point &origin, float distance) const;
 
     ///
-    /// @name TraceFace
+    /// @name RasterizeFace
     ///
     /// @description
-    /// 	Trace a single face of the hemicube. This is a private helper
-    ///     function for the public TraceHemicube function.
+    /// 	Z-buffer counterpart of TraceFace. Every patch in front of the
+    ///     hemicube is clipped to the near plane, projected onto the face
+    ///     and scan converted; each cell keeps the nearest patch covering
+    ///     its center. The multiplier weights of the cells are then
+    ///     credited to the patches left in the item buffer.
     ///
     /// @param patch - the patch at the origin of the hemicube
-    /// @param startingPoint - the origin of the hemicube
+    /// @param startingPoint - corner of the face where cell (0, 0) lies
     /// @param row - a vector that specifies the row
     /// @param col - a vector that specifies the column
     /// @param multiplier - the precomputed multiplier to use for this face
     ///
-    void TraceFace(Patch *patch, Point startingPoint, Vector row, Vector col,
-                   std::vector< std::vector<float>* > *multiplier);
+    void RasterizeFace(Patch *patch, Point startingPoint, Vector row,
+                       Vector col, Multiplier *multiplier);
 
-    void TraceFace(Patch *patch, Point startingPoint, Vector row, Vector col,
-                   Multiplier *multiplier);
+    ///
+    /// @name FindViewableSlot
+    ///
+    /// @description
+    /// 	Determine which viewable patch a ray leaving the patch at the
+    ///     origin of the hemicube lands on: the patch nearest along the
+    ///     ray, or none if the nearest patch is not viewable. Used when
+    ///     there is no hierarchy; see TraceTile otherwise.
+    ///
+    /// @param patch - the patch at the origin of the hemicube
+    /// @param ray - normalized direction of the ray
+    /// @param origin - the origin of the ray
+    ///
+    /// @return - index of the patch in the viewable list, or -1 if the ray
+    ///           does not land on a viewable patch
+    ///
+    int FindViewableSlot(Patch *patch, const Vector &ray,
+                         const Point &origin);
 
     ///
     /// @name mSubdivisions
@@ -136,6 +228,122 @@ private:
 
     std::vector<Rectangle*> *mShapes;
 
+    ///
+    /// @name mQuadBatch
+    ///
+    /// @description
+    ///		The quads laid out contiguously, for finding the first quad a
+    ///     ray hits without a hierarchy.
+    ///
+    RectangleBatch mQuadBatch;
+
+    const std::vector<Patch*> *mPatches;
+
+    const Bvh *mBvh;
+
+    Backend mBackend;
+
+    ///
+    /// @name mSlots
+    ///
+    /// @description
+    ///		Maps a patch index to its position in the viewable list of the
+    ///     patch being traced, or -1 if it is not viewable. Reset to -1
+    ///     after every trace.
+    ///
+    std::vector<int> mSlots;
+
+    ///
+    /// @name mViewable
+    ///
+    /// @description
+    ///		The viewable list of the patch being traced.
+    ///
+    const std::vector<uint32_t> *mViewable;
+
+    ///
+    /// @name mQuadSlots
+    ///
+    /// @description
+    ///		Positions in the viewable list of the patches cut from each
+    ///     quad, for tracing without a hierarchy.
+    ///
+    std::vector< std::vector<int> > mQuadSlots;
+
+    ///
+    /// @name mByQuad
+    ///
+    /// @description
+    ///		Whether every viewable patch of the patch being traced came
+    ///     from a quad, so rays can find the nearest quad first.
+    ///
+    bool mByQuad;
+
+    ///
+    /// @name mFactors
+    ///
+    /// @description
+    ///		Form factors accumulated for the patch being traced, one per
+    ///     entry of its viewable list.
+    ///
+    std::vector<float> mFactors;
+
+    ///
+    /// @name mRays
+    ///
+    /// @description
+    ///		Normalized ray through each cell of the face being traced, row
+    ///     by row.
+    ///
+    std::vector<Vector> mRays;
+
+    ///
+    /// @name mCellSlots
+    ///
+    /// @description
+    ///		Viewable slot each cell of the face being traced lands on, or
+    ///     -1. The weights are added once all cells are traced, in the
+    ///     same order whichever way the rays were traced.
+    ///
+    std::vector<int> mCellSlots;
+
+    ///
+    /// @name mCellHits, mCellDistances
+    ///
+    /// @description
+    ///		Patch each cell of the face being traced through the hierarchy
+    ///     lands on, or -1, and the distance to it.
+    ///
+    std::vector<int> mCellHits;
+    std::vector<float> mCellDistances;
+
+    ///
+    /// @name mCandidates
+    ///
+    /// @description
+    ///		Patches with at least one corner in front of the patch being
+    ///     traced. Only these can be seen from any face, so the z-buffer
+    ///     gathers them once per hemicube.
+    ///
+    std::vector<const Patch*> mCandidates;
+
+    ///
+    /// @name mDepth
+    ///
+    /// @description
+    ///		Depth buffer of the face being rasterized.
+    ///
+    std::vector<float> mDepth;
+
+    ///
+    /// @name mItems
+    ///
+    /// @description
+    ///		Item buffer of the face being rasterized, holding the index of
+    ///     the nearest patch per cell, or -1.
+    ///
+    std::vector<int> mItems;
+
     Multiplier *m_left_multiplier;
     Multiplier *m_top_multiplier;
     Multiplier *m_right_multiplier;
@@ -144,6 +352,11 @@ private:
 
 };  // class Hemicube
 
+inline int Hemicube::GetResolution() const
+{
+    return mSubdivisions;
+}
+
 }   // namesapce radiosity
 
 #endif
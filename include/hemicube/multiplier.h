@@ -1,45 +1,63 @@
-#ifndef MULTIPLIER_H_INCLUDED
-#define MULTIPLIER_H_INCLUDED
 
-#include <vector>
+#ifndef MULTIPLIER_H_INCLUDED
+#define MULTIPLIER_H_INCLUDED
+
+#include "multipliertable.h"
 
 namespace Radiosity
 {
 
-class Point;
-class Vector;
-
 class Multiplier
 {
 public:
 
-    Multiplier(const Point &centerPoint,
-               const Point &startingPoint,
-               const Vector &patchNormal,
-               const Vector &faceNormal,
-               Vector row,
-               Vector col,
-               int numRows,
-               int numCols);
+    // Which face of the hemicube the multiplier covers. Each face is laid
+    // out the way Hemicube::TraceHemicube walks it.
+    enum Face
+    {
+        LEFT,
+        TOP,
+        RIGHT,
+        BOTTOM,
+        FRONT
+    };
 
-    void normalize(float normalization_factor);
+    Multiplier(const MultiplierTable &table, Face face);
 
-    float weight_at(int row, int column);
+    float weight_at(int row, int column) const;
 
     unsigned int height() const { return m_height; };
     unsigned int width() const { return m_width; };
-    float sum() const { return m_sum; };
 
 private:
 
+    const MultiplierTable &m_table;
+
+    Face m_face;
+
     unsigned int m_height;
     unsigned int m_width;
+};
 
-    float m_sum;
+inline float Multiplier::weight_at(int row, int column) const
+{
+    int last = m_table.GetResolution() / 2 - 1;
+
+    switch (m_face)
+    {
+    case LEFT:
+        return m_table.Side(m_table.Fold(row), column);
+    case TOP:
+        return m_table.Side(m_table.Fold(column), row);
+    case RIGHT:
+        return m_table.Side(m_table.Fold(row), last - column);
+    case BOTTOM:
+        return m_table.Side(m_table.Fold(column), last - row);
+    default:
+        return m_table.Front(m_table.Fold(row), m_table.Fold(column));
+    }
+}
 
-    std::vector<float> *m_weights;
-};
-
 }   // namespace Radiosity
-
-#endif // MULTIPLIER_H_INCLUDED
+
+#endif // MULTIPLIER_H_INCLUDED
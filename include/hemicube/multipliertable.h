@@ -0,0 +1,170 @@
+///
+/// @file MultiplierTable.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Normalized delta form factors of the hemicube cells, shared by every
+///     hemicube of the same resolution.
+///
+
+#ifndef MULTIPLIER_TABLE_H
+#define MULTIPLIER_TABLE_H
+
+#include <vector>
+
+namespace Radiosity
+{
+
+class MultiplierTable
+{
+public:
+
+    ///
+    /// @name ForResolution
+    ///
+    /// @description
+    /// 	Looks up the table for a resolution. Common resolutions are
+    ///     compiled in; others are computed on first use and kept for the
+    ///     rest of the run. Safe to call from several threads.
+    ///
+    /// @param resolution - number of cells across the front face; must be
+    ///                     even (see Hemicube::RoundResolution)
+    /// @return - the shared table, valid until the program exits
+    ///
+    static const MultiplierTable &ForResolution(int resolution);
+
+    ///
+    /// @name Front
+    ///
+    /// @description
+    /// 	Weight of a front face cell. Cells are addressed by their
+    ///     distance from the center of the face, counted in cells, so the
+    ///     four quadrants and the two halves of each quadrant share their
+    ///     values.
+    ///
+    /// @param a - distance from the center along one axis, in [0, N/2)
+    /// @param b - distance from the center along the other axis
+    /// @return - the normalized weight of the cell
+    ///
+    float Front(int a, int b) const;
+
+    ///
+    /// @name Side
+    ///
+    /// @description
+    /// 	Weight of a side face cell. All four side faces and both halves
+    ///     of each face share their values.
+    ///
+    /// @param a - distance from the center of the face along the base,
+    ///            in [0, N/2)
+    /// @param height - row above the base of the face, in [0, N/2)
+    /// @return - the normalized weight of the cell
+    ///
+    float Side(int a, int height) const;
+
+    ///
+    /// @name Fold
+    ///
+    /// @description
+    /// 	Converts a cell index across a face to its distance from the
+    ///     center of the face, as used by Front and Side.
+    ///
+    /// @param index - cell index in [0, N)
+    /// @return - the distance in [0, N/2)
+    ///
+    int Fold(int index) const;
+
+    ///
+    /// @name GetResolution
+    ///
+    /// @description
+    /// 	Accessor for the resolution of the table.
+    ///
+    /// @return - the number of cells across the front face
+    ///
+    int GetResolution() const;
+
+private:
+
+    ///
+    /// @name MultiplierTable
+    ///
+    /// @description
+    /// 	Constructor. Computes the weights of a resolution that is not
+    ///     compiled in.
+    ///
+    /// @param resolution - number of cells across the front face
+    ///
+    explicit MultiplierTable(int resolution);
+
+    ///
+    /// @name MultiplierTable
+    ///
+    /// @description
+    /// 	Constructor. Wraps precomputed weights.
+    ///
+    /// @param resolution - number of cells across the front face
+    /// @param front - one octant of the front face
+    /// @param side - one half of a side face
+    ///
+    MultiplierTable(int resolution, const float *front, const float *side);
+
+    MultiplierTable(const MultiplierTable &);
+    MultiplierTable &operator=(const MultiplierTable &);
+
+    int mResolution;
+    int mHalf;
+
+    ///
+    /// @name mFront
+    ///
+    /// @description
+    ///		One octant of the front face, a <= b stored as a triangle:
+    ///     entry b * (b + 1) / 2 + a.
+    ///
+    const float *mFront;
+
+    ///
+    /// @name mSide
+    ///
+    /// @description
+    ///		One half of a side face: entry height * N/2 + a.
+    ///
+    const float *mSide;
+
+    ///
+    /// @name mStorage
+    ///
+    /// @description
+    ///		Backing store of the weights for tables computed at run time.
+    ///
+    std::vector<float> mStorage;
+
+};  // class MultiplierTable
+
+inline float MultiplierTable::Front(int a, int b) const
+{
+    return (a <= b) ? mFront[b * (b + 1) / 2 + a]
+                    : mFront[a * (a + 1) / 2 + b];
+}
+
+inline float MultiplierTable::Side(int a, int height) const
+{
+    return mSide[height * mHalf + a];
+}
+
+inline int MultiplierTable::Fold(int index) const
+{
+    return (index < mHalf) ? (mHalf - 1 - index) : (index - mHalf);
+}
+
+inline int MultiplierTable::GetResolution() const
+{
+    return mResolution;
+}
+
+}   // namespace Radiosity
+
+#endif
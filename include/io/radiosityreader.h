@@ -16,7 +16,11 @@
 #include "rectangle.h"
 #include "point.h"
 #include "patch.h"
+#include "mesh.h"
+#include "formfactormatrix.h"
+#include "visibilitymatrix.h"
 #include "color.h"
+#include "arena.h"
 
 #include <vector>
 #include <string.h>
@@ -37,9 +41,11 @@ public:
     /// @description
     /// 	Constructor
     ///
+    /// @param arena - holds the quads and patches read, which live until
+    ///                the arena is released
     /// @return - void
     ///
-    RadiosityReader();
+    explicit RadiosityReader(Arena *arena);
 
     ///
     /// @name ~RadiosityReader
@@ -69,9 +75,10 @@ public:
     /// 	Parses a .pat file into a vector of patches.
     ///
     /// @param filename - name of input file
+    /// @param mesh - receives the corners of the patches
     /// @return - vector of patches
     ///
-    std::vector<Patch*> *ParsePat(const char *filename);
+    std::vector<Patch*> *ParsePat(const char *filename, Mesh *mesh);
 
     ///
     /// @name ParseLos
@@ -81,9 +88,12 @@ public:
     ///     information.
     ///
     /// @param filename - name of input file
+    /// @param mesh - receives the corners of the patches
+    /// @param visibility - receives the line of sight between the patches
     /// @return - vector of patches
     ///
-    std::vector<Patch*> *ParseLos(const char *filename);
+    std::vector<Patch*> *ParseLos(const char *filename, Mesh *mesh,
+                                  VisibilityMatrix *visibility);
 
     ///
     /// @name ParseFor
@@ -93,9 +103,18 @@ public:
     ///     information and form factor information.
     ///
     /// @param filename - name of input file
+    /// @param mesh - receives the corners of the patches
+    /// @param visibility - receives the line of sight between the patches
+    /// @param formFactors - receives the form factors between the patches
     /// @return - vector of patches
     ///
-    std::vector<Patch*> *ParseFor(const char *filename);
+    std::vector<Patch*> *ParseFor(const char *filename, Mesh *mesh,
+                                  VisibilityMatrix *visibility,
+                                  FormFactorMatrix *formFactors);
+
+private:
+
+    Arena *mArena;
 
 };  // class RadiosityReader
 
@@ -0,0 +1,262 @@
+///
+/// @file Arena.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	A monotonic allocator for objects that live as long as the scene.
+///     Objects are bumped out of large blocks and all released together,
+///     instead of being allocated and freed one at a time.
+///
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Size of each block objects are carved from, unless another is requested
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+namespace Radiosity
+{
+
+class Arena
+{
+public:
+
+    ///
+    /// @name Arena
+    ///
+    /// @description
+    /// 	Constructor. No block is allocated until the first object is.
+    ///
+    /// @param blockSize - size of each block; larger objects get a block
+    ///                    of their own
+    ///
+    explicit Arena(std::size_t blockSize = ARENA_BLOCK_SIZE);
+
+    ///
+    /// @name ~Arena
+    ///
+    /// @description
+    /// 	Destructor. Releases every object still in the arena.
+    ///
+    ~Arena();
+
+    ///
+    /// @name Allocate
+    ///
+    /// @description
+    /// 	Reserves uninitialized memory. Not safe to call from several
+    ///     threads at once.
+    ///
+    /// @param size - number of bytes
+    /// @param alignment - alignment of the memory, a power of two no
+    ///                    larger than that of std::max_align_t
+    /// @return - the memory, valid until Release
+    ///
+    void *Allocate(std::size_t size, std::size_t alignment);
+
+    ///
+    /// @name New
+    ///
+    /// @description
+    /// 	Constructs an object in the arena. Its destructor runs when the
+    ///     arena is released; the object must not be deleted.
+    ///
+    /// @param args - arguments of the constructor
+    /// @return - the object
+    ///
+    template <typename T, typename... Args>
+    T *New(Args&&... args);
+
+    ///
+    /// @name Array
+    ///
+    /// @description
+    /// 	Reserves contiguous memory for objects that the caller then
+    ///     constructs with placement new, possibly from several threads.
+    ///     Every one of them must be constructed before the arena is
+    ///     released, which destroys them all.
+    ///
+    /// @param count - number of objects
+    /// @return - memory for the first object
+    ///
+    template <typename T>
+    T *Array(std::size_t count);
+
+    ///
+    /// @name Release
+    ///
+    /// @description
+    /// 	Destroys every object, newest first, and frees every block. The
+    ///     arena may be used again afterwards.
+    ///
+    void Release();
+
+    ///
+    /// @name Allocations
+    ///
+    /// @description
+    /// 	Accessor for the number of allocations since the last Release.
+    ///
+    /// @return - the number of allocations
+    ///
+    std::size_t Allocations() const;
+
+    ///
+    /// @name BytesAllocated
+    ///
+    /// @description
+    /// 	Accessor for the bytes handed out since the last Release,
+    ///     padding for alignment included.
+    ///
+    /// @return - the number of bytes
+    ///
+    std::size_t BytesAllocated() const;
+
+    ///
+    /// @name BytesReserved
+    ///
+    /// @description
+    /// 	Accessor for the total size of the blocks.
+    ///
+    /// @return - the number of bytes
+    ///
+    std::size_t BytesReserved() const;
+
+    ///
+    /// @name Blocks
+    ///
+    /// @description
+    /// 	Accessor for the number of blocks, i.e. calls to the heap.
+    ///
+    /// @return - the number of blocks
+    ///
+    std::size_t Blocks() const;
+
+private:
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    ///
+    /// @name Destructor
+    ///
+    /// @description
+    /// 	Objects whose destructors must run on Release: one object, or
+    ///     the objects of an array.
+    ///
+    struct Destructor
+    {
+        void *mObjects;
+        std::size_t mCount;
+        void (*mDestroy)(void *, std::size_t);
+    };
+
+    ///
+    /// @name Destroy
+    ///
+    /// @description
+    /// 	Runs the destructors of consecutive objects of a given type.
+    ///
+    /// @param objects - the first object
+    /// @param count - number of objects
+    ///
+    template <typename T>
+    static void Destroy(void *objects, std::size_t count);
+
+    std::size_t mBlockSize;
+
+    std::vector<char*> mBlocks;
+
+    ///
+    /// @name mCursor
+    ///
+    /// @description
+    ///		Next free byte of the last block, and the end of that block.
+    ///
+    char *mCursor;
+    char *mEnd;
+
+    ///
+    /// @name mDestructors
+    ///
+    /// @description
+    ///		Objects with destructors to run, oldest first. Objects that
+    ///     are trivially destructible are left out.
+    ///
+    std::vector<Destructor> mDestructors;
+
+    std::size_t mAllocations;
+    std::size_t mBytesAllocated;
+    std::size_t mBytesReserved;
+
+};  // class Arena
+
+template <typename T, typename... Args>
+T *Arena::New(Args&&... args)
+{
+    void *memory = Allocate(sizeof(T), alignof(T));
+    T *object = new (memory) T(std::forward<Args>(args)...);
+
+    if (!std::is_trivially_destructible<T>::value)
+    {
+        Destructor destructor = { object, 1, &Destroy<T> };
+        mDestructors.push_back(destructor);
+    }
+
+    return object;
+}
+
+template <typename T>
+T *Arena::Array(std::size_t count)
+{
+    T *objects = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+
+    if (!std::is_trivially_destructible<T>::value && (count > 0))
+    {
+        Destructor destructor = { objects, count, &Destroy<T> };
+        mDestructors.push_back(destructor);
+    }
+
+    return objects;
+}
+
+template <typename T>
+void Arena::Destroy(void *objects, std::size_t count)
+{
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        static_cast<T*>(objects)[index].~T();
+    }
+}
+
+inline std::size_t Arena::Allocations() const
+{
+    return mAllocations;
+}
+
+inline std::size_t Arena::BytesAllocated() const
+{
+    return mBytesAllocated;
+}
+
+inline std::size_t Arena::BytesReserved() const
+{
+    return mBytesReserved;
+}
+
+inline std::size_t Arena::Blocks() const
+{
+    return mBlocks.size();
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -0,0 +1,229 @@
+///
+/// @file ThreadPool.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	A fixed-size pool of worker threads for data-parallel loops.
+///
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace Radiosity
+{
+
+class ThreadPool
+{
+public:
+
+    ///
+    /// @name RangeTask
+    ///
+    /// @description
+    /// 	Work item for ParallelFor. Processes the half-open index range
+    ///     [begin, end). The worker index is in [0, Size()) and is unique
+    ///     among the threads running concurrently, so it may be used to
+    ///     select per-thread scratch state.
+    ///
+    typedef std::function<void (std::size_t begin,
+                                std::size_t end,
+                                unsigned int worker)> RangeTask;
+
+    ///
+    /// @name ThreadPool
+    ///
+    /// @description
+    /// 	Constructor
+    ///
+    /// @param numThreads - total number of threads, including the calling
+    ///                     thread. Zero selects the hardware concurrency.
+    ///
+    explicit ThreadPool(unsigned int numThreads);
+
+    ///
+    /// @name ~ThreadPool
+    ///
+    /// @description
+    /// 	Destructor. Joins all worker threads.
+    ///
+    ~ThreadPool();
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of threads, including the caller.
+    ///
+    /// @return - the number of threads that run a ParallelFor
+    ///
+    unsigned int Size() const;
+
+    ///
+    /// @name ParallelFor
+    ///
+    /// @description
+    /// 	Runs the task over [0, count) and blocks until every index has
+    ///     been processed. Chunks are handed out dynamically: each thread
+    ///     claims a share of the remaining work proportional to what is
+    ///     left, but never less than grain indices, so uneven items
+    ///     balance out near the end of the loop. The calling thread
+    ///     participates as worker 0. Calls must not be nested.
+    ///
+    /// @param count - number of indices to process
+    /// @param grain - minimum number of indices claimed at once
+    /// @param task - the work to run on each claimed range
+    ///
+    void ParallelFor(std::size_t count, std::size_t grain,
+                     const RangeTask &task);
+
+    ///
+    /// @name ParallelForStatic
+    ///
+    /// @description
+    /// 	Runs the task over [0, count) one index at a time and blocks
+    ///     until every index has been processed. Each thread starts with
+    ///     its own contiguous block of indices, so with balanced indices
+    ///     no thread touches another's data. A thread that runs out
+    ///     steals the last index of the block of another thread. The
+    ///     calling thread participates as worker 0. Calls must not be
+    ///     nested.
+    ///
+    /// @param count - number of indices to process
+    /// @param task - the work to run; called with end == begin + 1
+    ///
+    void ParallelForStatic(std::size_t count, const RangeTask &task);
+
+    ///
+    /// @name HardwareThreads
+    ///
+    /// @description
+    /// 	Number of hardware threads, or one if it cannot be determined.
+    ///
+    static unsigned int HardwareThreads();
+
+private:
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    ///
+    /// @name WorkerLoop
+    ///
+    /// @description
+    /// 	Body of each worker thread. Sleeps until a loop is published,
+    ///     then claims chunks until the loop is exhausted.
+    ///
+    /// @param worker - the index of this worker
+    ///
+    void WorkerLoop(unsigned int worker);
+
+    ///
+    /// @name RunChunks
+    ///
+    /// @description
+    /// 	Claims and runs chunks of the current loop until none remain.
+    ///
+    /// @param worker - the index of the thread claiming chunks
+    ///
+    void RunChunks(unsigned int worker);
+
+    ///
+    /// @name RunBlocks
+    ///
+    /// @description
+    /// 	Runs the indices of this thread's block, then steals from the
+    ///     other blocks until none remain.
+    ///
+    /// @param worker - the index of the thread running the block
+    ///
+    void RunBlocks(unsigned int worker);
+
+    ///
+    /// @name Publish
+    ///
+    /// @description
+    /// 	Hands the current loop to the workers, runs the caller's share
+    ///     and waits for the workers to finish.
+    ///
+    void Publish();
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+
+    ///
+    /// @name mTask
+    ///
+    /// @description
+    ///		The loop body currently being run, valid while mActive > 0.
+    ///
+    const RangeTask *mTask;
+
+    std::size_t mCount;
+    std::size_t mGrain;
+
+    ///
+    /// @name mStatic
+    ///
+    /// @description
+    ///		Whether the current loop is run with ParallelForStatic.
+    ///
+    bool mStatic;
+
+    ///
+    /// @name mBlocks
+    ///
+    /// @description
+    ///		Remaining indices of each thread's block in a static loop:
+    ///     the next index to run in the upper 32 bits, one past the last
+    ///     in the lower 32 bits. Owners take from the front and thieves
+    ///     from the back, both with a compare and swap.
+    ///
+    std::unique_ptr< std::atomic<uint64_t>[] > mBlocks;
+
+    ///
+    /// @name mNext
+    ///
+    /// @description
+    ///		First index that has not yet been claimed by any thread.
+    ///
+    std::atomic<std::size_t> mNext;
+
+    ///
+    /// @name mGeneration
+    ///
+    /// @description
+    ///		Incremented each time a loop is published so sleeping workers
+    ///     can tell a new loop from a spurious wakeup.
+    ///
+    unsigned int mGeneration;
+
+    ///
+    /// @name mActive
+    ///
+    /// @description
+    ///		Number of workers still running the current loop.
+    ///
+    unsigned int mActive;
+
+    bool mShutdown;
+
+};  // class ThreadPool
+
+}   // namespace Radiosity
+
+#endif
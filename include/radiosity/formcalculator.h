@@ -13,8 +13,15 @@
 #define FORM_CALCULATOR_H
 
 #include "hemicube.h"
+#include "formfactormatrix.h"
 #include "patch.h"
 #include "rectangle.h"
+#include "threadpool.h"
+#include "bvh.h"
+#include "visibilitymatrix.h"
+
+// Hemicube resolution used unless one is requested
+#define DEFAULT_RESOLUTION 26
 
 namespace Radiosity
 {
@@ -23,13 +30,43 @@ class FormCalculator
 {
 public:
 
+    ///
+    /// @name Reciprocity
+    ///
+    /// @description
+    ///     How CalculateFormFactors uses the reciprocity relation
+    ///     A_i F_ij = A_j F_ji.
+    ///
+    ///     TRACE_ALL - trace a hemicube from every patch
+    ///     DERIVE - trace hemicubes only from enough patches to cover
+    ///              every pair with line of sight, and derive the rows
+    ///              of the others by reciprocity
+    ///     VALIDATE - trace a hemicube from every patch and measure how
+    ///                far the two sides of each pair disagree
+    ///
+    enum Reciprocity
+    {
+        TRACE_ALL,
+        DERIVE,
+        VALIDATE
+    };
+
     ///
     /// @name FormCalculator
     ///
     /// @description
     ///     Constructor
     ///
-    FormCalculator(std::vector<Rectangle*> *quads);
+    /// @param quads - the quads making up the scene
+    /// @param visibility - which patches have line of sight to each other
+    /// @param bvh - hierarchy over the scene's patches, or nullptr to trace
+    ///              without one
+    /// @param backend - how hemicube faces are traced
+    /// @param pool - threads used to trace hemicubes in parallel
+    ///
+    FormCalculator(std::vector<Rectangle*> *quads,
+                   const VisibilityMatrix *visibility, const Bvh *bvh,
+                   Hemicube::Backend backend, ThreadPool *pool);
 
     ///
     /// @name ~FormCalculator
@@ -39,28 +76,324 @@ public:
     ///
     ~FormCalculator();
 
+    ///
+    /// @name SetResolution
+    ///
+    /// @description
+    ///     Set the resolution of the hemicubes, i.e. the number of cells
+    ///     across the front face. Lower resolutions trade accuracy for
+    ///     speed. Odd resolutions are rounded up.
+    ///
+    /// @param resolution - the hemicube resolution
+    ///
+    void SetResolution(int resolution);
+
+    ///
+    /// @name SetAdaptiveResolution
+    ///
+    /// @description
+    ///     Let each patch pick its own hemicube resolution between the
+    ///     resolution set with SetResolution and the given maximum. Patches
+    ///     with geometry close by see it at wide angles, where coarse
+    ///     cells alias the boundaries between neighbouring patches, so the
+    ///     resolution grows as the nearest viewable patch gets closer
+    ///     relative to the size of the patch. Intermediate resolutions
+    ///     double from the base so only a few hemicubes are built.
+    ///
+    /// @param maxResolution - the finest resolution to use, or 0 to use
+    ///                        the base resolution everywhere
+    ///
+    void SetAdaptiveResolution(int maxResolution);
+
+    ///
+    /// @name SetNearField
+    ///
+    /// @description
+    ///     Replace the hemicube form factors of nearby pairs with exact
+    ///     ones. Hemicube cells alias worst on patches that are close, so
+    ///     a pair whose centers are closer than the given number of patch
+    ///     widths, with nothing between the center of the one and the
+    ///     whole of the other, gets the closed-form point-to-polygon form
+    ///     factor instead. Needs the hierarchy to check that nothing is in
+    ///     the way; without one the hemicube values are kept.
+    ///
+    /// @param reach - the distance in widths of the larger patch, or 0 to
+    ///                keep the hemicube form factors everywhere
+    ///
+    void SetNearField(float reach);
+
+    ///
+    /// @name SetReciprocity
+    ///
+    /// @description
+    ///     Set how CalculateFormFactors, ChooseTraced and
+    ///     MeasureReciprocity use reciprocity. CalculateRow always traces.
+    ///
+    /// @param reciprocity - the reciprocity mode
+    ///
+    void SetReciprocity(Reciprocity reciprocity);
+
+    ///
+    /// @name GetTracedRows
+    ///
+    /// @description
+    ///     Accessor for the number of hemicubes traced by the last call to
+    ///     CalculateFormFactors or TraceRows.
+    ///
+    /// @return - the number of rows traced rather than derived
+    ///
+    unsigned int GetTracedRows() const;
+
+    ///
+    /// @name GetReciprocityError
+    ///
+    /// @description
+    ///     Accessor for the discrepancy measured in VALIDATE mode: the sum
+    ///     over all pairs of |A_i F_ij - A_j F_ji|, relative to the sum of
+    ///     A_i F_ij + A_j F_ji.
+    ///
+    /// @return - the relative discrepancy, or zero if not validated
+    ///
+    float GetReciprocityError() const;
+
+    ///
+    /// @name GetMaxReciprocityError
+    ///
+    /// @description
+    ///     Accessor for the largest discrepancy of a single pair measured
+    ///     in VALIDATE mode, relative to the pair's A_i F_ij + A_j F_ji.
+    ///
+    /// @return - the relative discrepancy, or zero if not validated
+    ///
+    float GetMaxReciprocityError() const;
+
     ///
     /// @name CalculateFormFactors
     ///
     /// @description
     ///     Using the hemicube method, this function calculates the form
-    ///     factors between all pairs of patches.
+    ///     factors between all pairs of patches. Hemicubes are traced in
+    ///     parallel; since each trace only writes the form factors of its
+    ///     own patch, the result is identical to a serial run. Depending
+    ///     on SetReciprocity, some rows are derived from the others
+    ///     rather than traced.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param formFactors - receives the form factors, one row per patch
+    ///
+    void CalculateFormFactors(std::vector<Patch*> *patches,
+                              FormFactorMatrix *formFactors);
+
+    ///
+    /// @name TraceRows
+    ///
+    /// @description
+    ///     Traces the hemicubes of some patches in parallel, staging their
+    ///     rows in a matrix that is being built: after Reset and before
+    ///     Compress. The rows of the other patches are left alone.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param indices - indices of the patches to trace
+    /// @param formFactors - receives the rows
+    ///
+    void TraceRows(std::vector<Patch*> *patches,
+                   const std::vector<uint32_t> &indices,
+                   FormFactorMatrix *formFactors);
+
+    ///
+    /// @name ChooseTraced
+    ///
+    /// @description
+    ///     Picks the patches to trace hemicubes from. In DERIVE mode the
+    ///     patches left out form an independent set of the line of sight
+    ///     graph, so every patch they can see has a row. Patches that see
+    ///     few others are left out first, the larger of them first, since
+    ///     a hemicube point-samples a large patch least accurately.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param derivable - whether each patch may be left out; the others
+    ///                    are traced, or have their rows from elsewhere
+    /// @param traced - receives whether each patch keeps its row
+    ///
+    void ChooseTraced(const std::vector<Patch*> *patches,
+                      const std::vector<bool> &derivable,
+                      std::vector<bool> &traced) const;
+
+    ///
+    /// @name DeriveRows
+    ///
+    /// @description
+    ///     Derives the rows of some patches by reciprocity, staging them
+    ///     in a matrix that is being built. Every patch they can see must
+    ///     have its row staged already.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param indices - indices of the patches to derive
+    /// @param formFactors - holds the other rows, and receives these
     ///
-    void CalculateFormFactors(std::vector<Patch*> *patches);
+    void DeriveRows(std::vector<Patch*> *patches,
+                    const std::vector<uint32_t> &indices,
+                    FormFactorMatrix *formFactors);
+
+    ///
+    /// @name MeasureReciprocity
+    ///
+    /// @description
+    ///     In VALIDATE mode, compares the two sides of every pair of a
+    ///     finished matrix, for GetReciprocityError. In the other modes
+    ///     it only clears the errors.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param formFactors - the compressed form factors
+    ///
+    void MeasureReciprocity(const std::vector<Patch*> *patches,
+                            const FormFactorMatrix *formFactors);
+
+    ///
+    /// @name CalculateRow
+    ///
+    /// @description
+    ///     Traces a single hemicube, for solvers that only need the form
+    ///     factors of some patches. Runs on the calling thread. The
+    ///     resolution and scene must not change between calls.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param patch - the patch to trace the hemicube from
+    /// @param row - receives the non-zero form factors from the patch
+    ///
+    void CalculateRow(std::vector<Patch*> *patches, Patch *patch,
+                      std::vector<FormFactorMatrix::Entry> &row);
 
 private:
 
+    std::vector<Rectangle*> *mQuads;
+
+    const VisibilityMatrix *mVisibility;
+
+    const Bvh *mBvh;
+
+    Hemicube::Backend mBackend;
+
+    ///
+    /// @name mPool
+    ///
+    /// @description
+    ///     Threads used to trace the hemicubes.
+    ///
+    ThreadPool *mPool;
+
+    ///
+    /// @name mResolution
+    ///
+    /// @description
+    ///     Resolution of the hemicubes, or the coarsest resolution when
+    ///     adaptive.
+    ///
+    int mResolution;
+
+    ///
+    /// @name mMaxResolution
+    ///
+    /// @description
+    ///     Finest adaptive resolution, or 0 when not adaptive.
+    ///
+    int mMaxResolution;
+
+    ///
+    /// @name mNearField
+    ///
+    /// @description
+    ///     Distance, in patch widths, within which pairs get closed-form
+    ///     form factors, or 0 for none.
+    ///
+    float mNearField;
+
+    Reciprocity mReciprocity;
+
+    unsigned int mTracedRows;
+
+    float mReciprocityError;
+    float mMaxReciprocityError;
+
+    ///
+    /// @name mRowHemicubes
+    ///
+    /// @description
+    ///     Hemicubes used by CalculateRow, one per resolution, created on
+    ///     first use.
+    ///
+    std::vector<Hemicube*> mRowHemicubes;
+
+    ///
+    /// @name mRowViewable
+    ///
+    /// @description
+    ///     Viewable list of the patch traced by CalculateRow.
+    ///
+    std::vector<uint32_t> mRowViewable;
+
+    ///
+    /// @name Levels
+    ///
+    /// @description
+    ///     Resolutions available to the patches: the base resolution,
+    ///     then doublings of it up to the maximum when adaptive.
+    ///
+    /// @return - the resolutions, coarsest first
+    ///
+    std::vector<int> Levels() const;
+
     ///
-    /// @name mHemicube
+    /// @name ChooseLevel
     ///
     /// @description
-    ///     The precomputed hemicube used to calculate form factors for
-    ///     each patch.
+    ///     Picks the hemicube resolution for a patch.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param patch - the patch about to be traced
+    /// @param viewable - indices of the patches it can see
+    /// @param levels - the available resolutions, coarsest first
+    /// @return - index into levels
     ///
-    Hemicube mHemicube;
+    unsigned int ChooseLevel(const std::vector<Patch*> *patches,
+                             const Patch *patch,
+                             const std::vector<uint32_t> &viewable,
+                             const std::vector<int> &levels) const;
+
+    ///
+    /// @name ApplyNearField
+    ///
+    /// @description
+    ///     Replaces the form factors in a traced row of the pairs that are
+    ///     near and unoccluded with closed-form ones. The rest of the row
+    ///     is rescaled so that its sum stays that of the hemicube.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param patch - the patch the row is from
+    /// @param row - the form factors from the patch, one per viewable
+    ///              patch
+    ///
+    void ApplyNearField(const std::vector<Patch*> *patches,
+                        const Patch *patch,
+                        std::vector<FormFactorMatrix::Entry> &row) const;
 
 };  // class FormCalculator
 
+inline unsigned int FormCalculator::GetTracedRows() const
+{
+    return mTracedRows;
+}
+
+inline float FormCalculator::GetReciprocityError() const
+{
+    return mReciprocityError;
+}
+
+inline float FormCalculator::GetMaxReciprocityError() const
+{
+    return mMaxReciprocityError;
+}
+
 }   // namespace Radiosity
 
 #endif
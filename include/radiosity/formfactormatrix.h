@@ -0,0 +1,232 @@
+///
+/// @file FormFactorMatrix.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Sparse matrix of the form factors between all patches of a scene,
+///     stored in compressed sparse row form.
+///
+
+#ifndef FORM_FACTOR_MATRIX_H
+#define FORM_FACTOR_MATRIX_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace Radiosity
+{
+
+class FormFactorMatrix
+{
+public:
+
+    ///
+    /// @name Entry
+    ///
+    /// @description
+    /// 	A single form factor: the index of the patch it leads to and
+    ///     its value.
+    ///
+    typedef std::pair<uint32_t, float> Entry;
+
+    ///
+    /// @name FormFactorMatrix
+    ///
+    /// @description
+    /// 	Constructor. Creates an empty matrix with no rows.
+    ///
+    FormFactorMatrix();
+
+    ///
+    /// @name Reset
+    ///
+    /// @description
+    /// 	Discards the matrix and starts building a new one. Rows are
+    ///     staged with SetRow, in any order, then packed with Compress.
+    ///
+    /// @param numRows - number of patches in the scene
+    ///
+    void Reset(unsigned int numRows);
+
+    ///
+    /// @name SetRow
+    ///
+    /// @description
+    /// 	Stages the form factors from one patch to the others. Zero
+    ///     entries are dropped. Different rows may be staged from
+    ///     different threads at the same time.
+    ///
+    /// @param row - index of the patch the form factors are from
+    /// @param entries - the form factors; emptied by the call
+    ///
+    void SetRow(unsigned int row, std::vector<Entry> &entries);
+
+    ///
+    /// @name GetStaged
+    ///
+    /// @description
+    /// 	Looks up a single form factor in a row that has been staged but
+    ///     not yet packed. Safe to call from several threads as long as
+    ///     the row is not being staged at the same time.
+    ///
+    /// @param row - index of the patch the form factor is from
+    /// @param column - index of the patch the form factor is to
+    /// @return - the form factor, or zero if it is not staged
+    ///
+    float GetStaged(unsigned int row, unsigned int column) const;
+
+    ///
+    /// @name Compress
+    ///
+    /// @description
+    /// 	Packs the staged rows into the compressed arrays and frees the
+    ///     staging storage.
+    ///
+    void Compress();
+
+    ///
+    /// @name Rows
+    ///
+    /// @description
+    /// 	Accessor for the number of rows, i.e. patches.
+    ///
+    /// @return - the number of rows
+    ///
+    unsigned int Rows() const;
+
+    ///
+    /// @name NonZeros
+    ///
+    /// @description
+    /// 	Accessor for the number of stored form factors.
+    ///
+    /// @return - the number of non-zero entries
+    ///
+    std::size_t NonZeros() const;
+
+    ///
+    /// @name MemoryUsage
+    ///
+    /// @description
+    /// 	Size of the compressed arrays.
+    ///
+    /// @return - the number of bytes used by the matrix
+    ///
+    std::size_t MemoryUsage() const;
+
+    ///
+    /// @name RowBegin
+    ///
+    /// @description
+    /// 	Position of the first entry of a row in Columns and Values.
+    ///
+    /// @param row - the row
+    /// @return - offset of the first entry of the row
+    ///
+    uint32_t RowBegin(unsigned int row) const;
+
+    ///
+    /// @name RowEnd
+    ///
+    /// @description
+    /// 	Position one past the last entry of a row in Columns and Values.
+    ///
+    /// @param row - the row
+    /// @return - offset one past the last entry of the row
+    ///
+    uint32_t RowEnd(unsigned int row) const;
+
+    ///
+    /// @name Columns
+    ///
+    /// @description
+    /// 	Accessor for the column, i.e. patch index, of every entry. The
+    ///     columns of each row are in increasing order.
+    ///
+    /// @return - the column array
+    ///
+    const uint32_t *Columns() const;
+
+    ///
+    /// @name Values
+    ///
+    /// @description
+    /// 	Accessor for the value of every entry.
+    ///
+    /// @return - the value array
+    ///
+    const float *Values() const;
+
+    ///
+    /// @name Get
+    ///
+    /// @description
+    /// 	Looks up a single form factor.
+    ///
+    /// @param row - index of the patch the form factor is from
+    /// @param column - index of the patch the form factor is to
+    /// @return - the form factor, or zero if it is not stored
+    ///
+    float Get(unsigned int row, unsigned int column) const;
+
+private:
+
+    ///
+    /// @name mOffsets
+    ///
+    /// @description
+    ///		Start of each row in mColumns and mValues, followed by the
+    ///     total number of entries.
+    ///
+    std::vector<uint32_t> mOffsets;
+
+    std::vector<uint32_t> mColumns;
+    std::vector<float> mValues;
+
+    ///
+    /// @name mStaged
+    ///
+    /// @description
+    ///		Rows waiting to be packed by Compress.
+    ///
+    std::vector< std::vector<Entry> > mStaged;
+
+};  // class FormFactorMatrix
+
+inline unsigned int FormFactorMatrix::Rows() const
+{
+    return mOffsets.empty() ? 0 : mOffsets.size() - 1;
+}
+
+inline std::size_t FormFactorMatrix::NonZeros() const
+{
+    return mValues.size();
+}
+
+inline uint32_t FormFactorMatrix::RowBegin(unsigned int row) const
+{
+    return mOffsets[row];
+}
+
+inline uint32_t FormFactorMatrix::RowEnd(unsigned int row) const
+{
+    return mOffsets[row + 1];
+}
+
+inline const uint32_t *FormFactorMatrix::Columns() const
+{
+    return mColumns.data();
+}
+
+inline const float *FormFactorMatrix::Values() const
+{
+    return mValues.data();
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -0,0 +1,398 @@
+///
+/// @file HierarchicalSolver.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Hierarchical radiosity: every quad of the scene becomes the root of
+///     a quadtree of elements, and pairs of elements are linked at the
+///     coarsest level at which their form factor is small enough, so the
+///     number of links grows linearly with the number of elements.
+///
+
+#ifndef HIERARCHICAL_SOLVER_H
+#define HIERARCHICAL_SOLVER_H
+
+#include "patch.h"
+#include "patchstore.h"
+#include "rectangle.h"
+#include "residual.h"
+#include "threadpool.h"
+#include "bvh.h"
+#include "mesh.h"
+#include "arena.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+// Form factor above which a link is refined, unless one is requested
+#define DEFAULT_LINK_THRESHOLD 0.02f
+
+namespace Radiosity
+{
+
+class HierarchicalSolver
+{
+public:
+
+    ///
+    /// @name HierarchicalSolver
+    ///
+    /// @description
+    /// 	Constructor. Makes one root element per quad; no links exist
+    ///     until Refine is called.
+    ///
+    /// @param quads - the quads making up the scene
+    /// @param mesh - receives the corners of the elements, and must
+    ///               outlive the solver
+    /// @param arena - holds the patches of the elements, which live until
+    ///                the arena is released
+    ///
+    HierarchicalSolver(std::vector<Rectangle*> *quads, Mesh *mesh,
+                       Arena *arena);
+
+    ///
+    /// @name ~HierarchicalSolver
+    ///
+    /// @description
+    /// 	Destructor. The patches of the elements, including the leaves
+    ///     handed out by Refine, stay in the arena, and their corners in
+    ///     the mesh.
+    ///
+    ~HierarchicalSolver();
+
+    ///
+    /// @name SetThreshold
+    ///
+    /// @description
+    /// 	Set the largest form factor, in either direction, that a link
+    ///     may carry. Pairs that exceed it are linked through smaller
+    ///     elements instead.
+    ///
+    /// @param threshold - the form factor threshold
+    ///
+    void SetThreshold(float threshold);
+
+    ///
+    /// @name SetMinimumSize
+    ///
+    /// @description
+    /// 	Set the size below which elements are not subdivided, however
+    ///     large their form factors.
+    ///
+    /// @param size - the smallest edge an element is split across
+    ///
+    void SetMinimumSize(float size);
+
+    ///
+    /// @name SetThreadPool
+    ///
+    /// @description
+    /// 	Set the threads used to gather across the links. Without a
+    ///     pool, links are gathered on the calling thread.
+    ///
+    /// @param pool - the thread pool
+    ///
+    void SetThreadPool(ThreadPool *pool);
+
+    ///
+    /// @name SetTolerance
+    ///
+    /// @description
+    /// 	Stop iterating once the relative residual drops below the given
+    ///     tolerance. Zero runs every iteration.
+    ///
+    /// @param tolerance - the relative residual to stop at
+    ///
+    void SetTolerance(float tolerance);
+
+    ///
+    /// @name SetNorm
+    ///
+    /// @description
+    /// 	Set the norm used to measure the residual.
+    ///
+    /// @param norm - the norm
+    ///
+    void SetNorm(Residual::Norm norm);
+
+    ///
+    /// @name Refine
+    ///
+    /// @description
+    /// 	Links every pair of quads that can see each other, subdividing
+    ///     whichever element of a pair looks larger from the other until
+    ///     the form factors of the link fall below the threshold. The
+    ///     visibility of each link is estimated with a few rays.
+    ///
+    /// @param leaves - receives the elements left undivided, which are
+    ///                 the patches of the solution; still owned by the
+    ///                 solver
+    ///
+    void Refine(std::vector<Patch*> *leaves);
+
+    ///
+    /// @name CalculateRadiosity
+    ///
+    /// @description
+    /// 	Solves for the radiosity of every leaf. Each iteration gathers
+    ///     light across every link, then pushes what each element gathered
+    ///     down to its leaves and pulls the area-weighted exidence of the
+    ///     leaves back up. The residual of every iteration is reported on
+    ///     standard output.
+    ///
+    /// @param store - radiometric state of the leaves returned by Refine,
+    ///                updated in place
+    /// @param numIterations - largest number of iterations to run
+    /// @return - the number of iterations run
+    ///
+    int CalculateRadiosity(PatchStore *store, int numIterations);
+
+    ///
+    /// @name Elements
+    ///
+    /// @description
+    /// 	Accessor for the number of elements at every level.
+    ///
+    /// @return - the number of elements
+    ///
+    unsigned int Elements() const;
+
+    ///
+    /// @name Links
+    ///
+    /// @description
+    /// 	Accessor for the number of links, each direction counted once.
+    ///
+    /// @return - the number of links
+    ///
+    std::size_t Links() const;
+
+private:
+
+    HierarchicalSolver(const HierarchicalSolver &);
+    HierarchicalSolver &operator=(const HierarchicalSolver &);
+
+    ///
+    /// @name Link
+    ///
+    /// @description
+    /// 	Light gathered by an element from another: the element it comes
+    ///     from and the form factor to it, visibility included.
+    ///
+    struct Link
+    {
+        uint32_t mSource;
+        float mFactor;
+    };
+
+    ///
+    /// @name Element
+    ///
+    /// @description
+    /// 	A node of the quadtree of a quad.
+    ///
+    struct Element
+    {
+        Patch *mPatch;
+
+        ///
+        /// @name mCorners
+        ///
+        /// @description
+        ///		Indices of corners A to D of the patch in the mesh, which
+        ///     children share.
+        ///
+        uint32_t mCorners[4];
+
+        ///
+        /// @name mQuad
+        ///
+        /// @description
+        ///		Index of the quad at the root of the tree.
+        ///
+        uint32_t mQuad;
+
+        ///
+        /// @name mChildren
+        ///
+        /// @description
+        ///		Index of the first of four consecutive children, or -1 for
+        ///     a leaf.
+        ///
+        int32_t mChildren;
+
+        ///
+        /// @name mLeaf
+        ///
+        /// @description
+        ///		Index of a leaf among the patches given out by Refine, or
+        ///     -1 for an inner element.
+        ///
+        int32_t mLeaf;
+
+        std::vector<Link> mLinks;
+    };
+
+    ///
+    /// @name RefinePair
+    ///
+    /// @description
+    /// 	Links two elements, or subdivides one of them and refines its
+    ///     children against the other.
+    ///
+    /// @param a - index of one element
+    /// @param b - index of the other element
+    ///
+    void RefinePair(uint32_t a, uint32_t b);
+
+    ///
+    /// @name Estimate
+    ///
+    /// @description
+    /// 	Estimates the unoccluded form factors between two elements, from
+    ///     the center of each to the whole of the other. Elements partly
+    ///     behind each other fall back to the differential form factor
+    ///     between their centers.
+    ///
+    /// @param a - one element
+    /// @param b - the other element
+    /// @param ab - receives the form factor from a to b
+    /// @param ba - receives the form factor from b to a
+    /// @param behindA - receives whether part of a is behind b
+    /// @param behindB - receives whether part of b is behind a
+    /// @return - false if the elements cannot see each other at all
+    ///
+    bool Estimate(const Patch *a, const Patch *b, float &ab, float &ba,
+                  bool &behindA, bool &behindB) const;
+
+    ///
+    /// @name Visibility
+    ///
+    /// @description
+    /// 	Fraction of the rays between matching points of two elements
+    ///     that nothing blocks.
+    ///
+    /// @param a - index of one element
+    /// @param b - index of the other element
+    /// @return - the visible fraction, from 0 to 1
+    ///
+    float Visibility(uint32_t a, uint32_t b) const;
+
+    ///
+    /// @name CanSubdivide
+    ///
+    /// @description
+    /// 	Determines if an element is still larger than the minimum size.
+    ///
+    /// @param element - index of the element
+    /// @return - true if the element may be split
+    ///
+    bool CanSubdivide(uint32_t element) const;
+
+    ///
+    /// @name Subdivide
+    ///
+    /// @description
+    /// 	Splits an element into four at the midpoints of its edges,
+    ///     unless it has been split already.
+    ///
+    /// @param element - index of the element
+    ///
+    void Subdivide(uint32_t element);
+
+    ///
+    /// @name Midpoint
+    ///
+    /// @description
+    /// 	Finds the corner halfway between two others, adding it to the
+    ///     mesh unless a neighbouring element has already.
+    ///
+    /// @param p - index of one corner
+    /// @param q - index of the other corner
+    /// @return - index of the corner between them
+    ///
+    uint32_t Midpoint(uint32_t p, uint32_t q);
+
+    ///
+    /// @name Gather
+    ///
+    /// @description
+    /// 	Sums the light arriving at every element across its links.
+    ///
+    void Gather();
+
+    ///
+    /// @name PushPull
+    ///
+    /// @description
+    /// 	Adds the light gathered by an element to what arrived at its
+    ///     ancestors and hands it down to the leaves, which reflect it,
+    ///     then averages the exidence of the children back up.
+    ///
+    /// @param element - index of the element
+    /// @param above - light arriving at the ancestors of the element, one
+    ///                value per color channel
+    /// @param store - radiometric state of the leaves
+    /// @param residual - accumulates the change in exidence of the leaves
+    ///
+    void PushPull(uint32_t element, const float above[3], PatchStore *store,
+                  Residual &residual);
+
+    std::vector<Rectangle*> *mQuads;
+
+    Mesh *mMesh;
+
+    Arena *mArena;
+
+    ///
+    /// @name mRoots
+    ///
+    /// @description
+    ///		The patches of the root elements, one per quad in the order of
+    ///     the quads, for the hierarchy used to test visibility.
+    ///
+    std::vector<Patch*> mRoots;
+
+    Bvh *mBvh;
+
+    std::vector<Element> mElements;
+
+    ///
+    /// @name mExidence
+    ///
+    /// @description
+    ///		Exidence of every element in each color channel. Inner
+    ///     elements hold the area-weighted average of their leaves.
+    ///
+    std::vector<float> mExidence[3];
+
+    ///
+    /// @name mGathered
+    ///
+    /// @description
+    ///		Light arriving at every element across its own links in each
+    ///     color channel.
+    ///
+    std::vector<float> mGathered[3];
+
+    float mThreshold;
+    float mMinimumSize;
+
+    ThreadPool *mPool;
+
+    float mTolerance;
+    Residual::Norm mNorm;
+
+};  // class HierarchicalSolver
+
+inline unsigned int HierarchicalSolver::Elements() const
+{
+    return mElements.size();
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -0,0 +1,280 @@
+///
+/// @file MeshRefiner.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Adapts the patches of a solved scene to its lighting: patches whose
+///     exidence differs strongly from a neighbour are split, and flat
+///     blocks of patches are merged, reusing as many form factors of the
+///     old patches as the new geometry allows.
+///
+
+#ifndef MESH_REFINER_H
+#define MESH_REFINER_H
+
+#include "patch.h"
+#include "patchstore.h"
+#include "rectangle.h"
+#include "formcalculator.h"
+#include "formfactormatrix.h"
+#include "mesh.h"
+#include "arena.h"
+#include "visibilitymatrix.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Relative difference in exidence between neighbouring patches above which
+// they are split, unless one is requested
+#define DEFAULT_GRADIENT 0.2f
+
+namespace Radiosity
+{
+
+class MeshRefiner
+{
+public:
+
+    ///
+    /// @name MeshRefiner
+    ///
+    /// @description
+    /// 	Constructor
+    ///
+    /// @param quads - the quads the patches were cut from
+    /// @param mesh - holds the corners of the patches, and receives the
+    ///               corners of new ones
+    /// @param arena - holds the new patches, which live until the arena
+    ///                is released
+    ///
+    MeshRefiner(std::vector<Rectangle*> *quads, Mesh *mesh, Arena *arena);
+
+    ///
+    /// @name ~MeshRefiner
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~MeshRefiner();
+
+    ///
+    /// @name SetThreshold
+    ///
+    /// @description
+    /// 	Set the difference in exidence between neighbouring patches,
+    ///     relative to the brighter of the two, above which a patch is
+    ///     split. Blocks whose differences all stay below a quarter of it
+    ///     are merged.
+    ///
+    /// @param threshold - the relative difference
+    ///
+    void SetThreshold(float threshold);
+
+    ///
+    /// @name Refine
+    ///
+    /// @description
+    /// 	Splits every patch that differs too much from a neighbour in the
+    ///     same quad into four, and merges square blocks of four equal,
+    ///     flat patches into one. The other patches are carried over as
+    ///     they are, in order, and renumbered.
+    ///
+    /// @param patches - the patches of the solved scene
+    /// @param store - the solution
+    /// @param refined - receives the new patches, which reuse the ones
+    ///                  carried over
+    /// @return - false if no patch was split or merged
+    ///
+    bool Refine(const std::vector<Patch*> *patches, const PatchStore *store,
+                std::vector<Patch*> *refined);
+
+    ///
+    /// @name CarryFormFactors
+    ///
+    /// @description
+    /// 	Builds the form factors of the refined patches. Hemicubes are
+    ///     only traced from the new patches, and with the calculator in
+    ///     DERIVE mode some merged patches derive theirs by reciprocity
+    ///     instead. In VALIDATE mode the result is measured as
+    ///     CalculateFormFactors would. A patch carried over keeps
+    ///     its row: form factors to merged patches are the sums of those
+    ///     to the patches they replace, and form factors to split patches
+    ///     are shared among the quarters in proportion to how much each
+    ///     quarter sees of the patch, by reciprocity.
+    ///
+    /// @param formFactors - form factors of the patches before Refine
+    /// @param refined - the patches made by Refine
+    /// @param calculator - traces hemicubes among the refined patches
+    /// @param result - receives the form factors of the refined patches
+    ///
+    void CarryFormFactors(const FormFactorMatrix &formFactors,
+                          std::vector<Patch*> *refined,
+                          FormCalculator *calculator,
+                          FormFactorMatrix *result) const;
+
+    ///
+    /// @name CarryVisibility
+    ///
+    /// @description
+    /// 	Finds the old patch each refined patch was carried over from
+    ///     unchanged, so that the pairs of those patches can keep their
+    ///     line of sight.
+    ///
+    /// @param previous - receives, for every refined patch, the index of
+    ///                   the old patch, or NO_PREVIOUS_ROW for a patch
+    ///                   split or merged by Refine
+    ///
+    void CarryVisibility(std::vector<uint32_t> &previous) const;
+
+    ///
+    /// @name CarryExidence
+    ///
+    /// @description
+    /// 	Starts the refined patches from the old solution, so that the
+    ///     solver only has to correct it: quarters take the exidence of
+    ///     the patch they were cut from, merged patches the area-weighted
+    ///     average of theirs.
+    ///
+    /// @param store - the solution before Refine
+    /// @param refined - radiometric state of the refined patches
+    ///
+    void CarryExidence(const PatchStore &store, PatchStore *refined) const;
+
+    ///
+    /// @name GetSplit
+    ///
+    /// @description
+    /// 	Accessor for the number of patches split by the last Refine.
+    ///
+    /// @return - the number of split patches
+    ///
+    unsigned int GetSplit() const;
+
+    ///
+    /// @name GetMerged
+    ///
+    /// @description
+    /// 	Accessor for the number of blocks merged by the last Refine.
+    ///
+    /// @return - the number of merged blocks
+    ///
+    unsigned int GetMerged() const;
+
+private:
+
+    MeshRefiner(const MeshRefiner &);
+    MeshRefiner &operator=(const MeshRefiner &);
+
+    ///
+    /// @name Extent
+    ///
+    /// @description
+    /// 	Where a patch lies within its quad, measured along the edges AB
+    ///     (u) and AD (v) of the quad.
+    ///
+    struct Extent
+    {
+        float mU0;
+        float mU1;
+        float mV0;
+        float mV1;
+    };
+
+    ///
+    /// @name Origin
+    ///
+    /// @description
+    /// 	What a refined patch was made from: the one old patch it was
+    ///     carried over from or cut from, or the four it merges.
+    ///
+    struct Origin
+    {
+        uint32_t mOld[4];
+        unsigned int mCount;
+        bool mKept;
+    };
+
+    ///
+    /// @name FindNeighbours
+    ///
+    /// @description
+    /// 	Finds the patches sharing an edge with each patch, in the
+    ///     direction of u or of v.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param extents - where each patch lies within its quad
+    /// @param alongU - true for the neighbours past the u1 side, false
+    ///                 for those past the v1 side
+    /// @param neighbours - receives the neighbours of each patch
+    ///
+    void FindNeighbours(const std::vector<Patch*> *patches,
+                        const std::vector<Extent> &extents, bool alongU,
+                        std::vector< std::vector<uint32_t> > &neighbours)
+                        const;
+
+    ///
+    /// @name Split
+    ///
+    /// @description
+    /// 	Cuts a patch into four at the midpoints of its edges, welding
+    ///     the midpoints into the mesh.
+    ///
+    /// @param patch - the patch
+    /// @param refined - receives the quarters
+    ///
+    void Split(const Patch *patch, std::vector<Patch*> *refined) const;
+
+    std::vector<Rectangle*> *mQuads;
+
+    Mesh *mMesh;
+
+    Arena *mArena;
+
+    float mThreshold;
+
+    ///
+    /// @name mOrigins
+    ///
+    /// @description
+    ///		Origin of every refined patch.
+    ///
+    std::vector<Origin> mOrigins;
+
+    ///
+    /// @name mSuccessor
+    ///
+    /// @description
+    ///		First refined patch made from every old patch; the quarters of
+    ///     a split patch follow it.
+    ///
+    std::vector<uint32_t> mSuccessor;
+
+    ///
+    /// @name mSuccessors
+    ///
+    /// @description
+    ///		Number of refined patches made from every old patch: four if
+    ///     it was split, one otherwise.
+    ///
+    std::vector<unsigned int> mSuccessors;
+
+    unsigned int mSplit;
+    unsigned int mMerged;
+
+};  // class MeshRefiner
+
+inline unsigned int MeshRefiner::GetSplit() const
+{
+    return mSplit;
+}
+
+inline unsigned int MeshRefiner::GetMerged() const
+{
+    return mMerged;
+}
+
+}   // namespace Radiosity
+
+#endif
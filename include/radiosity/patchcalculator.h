@@ -15,6 +15,9 @@
 #include "vector.h"
 #include "patch.h"
 #include "rectangle.h"
+#include "mesh.h"
+#include "arena.h"
+#include "threadpool.h"
 
 #include <vector>
 #include <cstdlib>
@@ -34,8 +37,10 @@ public:
     /// 	Constructor
     ///
     /// @param patchSize - the size to make patches
+    /// @param arena - holds the patches made, which live until the arena
+    ///                is released
     ///
-    PatchCalculator(float patchSize);
+    PatchCalculator(float patchSize, Arena *arena);
 
     ///
     /// @name ~PatchCalculator
@@ -45,19 +50,75 @@ public:
     ///
     ~PatchCalculator();
 
+    ///
+    /// @name SetThreadPool
+    ///
+    /// @description
+    /// 	Sets the threads the corners and patches are made on.
+    ///
+    /// @param pool - the threads to use, or nullptr to run on the calling
+    ///               thread
+    ///
+    void SetThreadPool(ThreadPool *pool);
+
     ///
     /// @name Subdivide
     ///
     /// @description
-    /// 	Performs the patch subdivision algorithm.
+    /// 	Performs the patch subdivision algorithm. The patches of every
+    ///     quad are counted first, so that the corners and the patches of
+    ///     all quads can be made in parallel, straight into one array
+    ///     each. Corners are shared within a quad, and those on the edge
+    ///     of a quad are welded into the mesh, so that patches also share
+    ///     them across the edges between quads.
     ///
     /// @param quads - vector of quadrilaterals to divide
     /// @param patchs - the patches resulting from the subdivision
+    /// @param mesh - receives the corners of the patches
     ///
-    void Subdivide(std::vector<Rectangle*> *quads, std::vector<Patch*> *patches);
+    void Subdivide(std::vector<Rectangle*> *quads, std::vector<Patch*> *patches,
+                   Mesh *mesh);
 
 private:
 
+    ///
+    /// @name Layout
+    ///
+    /// @description
+    /// 	How a quad is divided, and where its corners, rows and patches
+    ///     start in the arrays shared by all quads. The corners of a quad
+    ///     are stored row by row, rows running along AB.
+    ///
+    struct Layout
+    {
+        int mSizeI;
+        int mSizeJ;
+
+        Vector mAB;
+        float mLengthAB;
+        Vector mNormal;
+
+        std::size_t mFirstCorner;
+        std::size_t mFirstRow;
+        std::size_t mFirstPatch;
+    };
+
+    ///
+    /// @name Plan
+    ///
+    /// @description
+    /// 	Counts the patches along each edge of every quad, and lays the
+    ///     quads out one after another.
+    ///
+    /// @param quads - the quads to divide
+    /// @param layouts - receives the layout of every quad
+    /// @param rowStarts - receives the first corner of every row
+    /// @param rowQuads - receives the quad of every row
+    ///
+    void Plan(std::vector<Rectangle*> *quads, std::vector<Layout> &layouts,
+              std::vector<Point> &rowStarts,
+              std::vector<uint32_t> &rowQuads) const;
+
     ///
     /// @name mPatchSize
     ///
@@ -66,6 +127,10 @@ private:
     ///
     float mPatchSize;
 
+    Arena *mArena;
+
+    ThreadPool *mPool;
+
 };  // class PatchCalculator
 
 }   // namesapce Radiosity
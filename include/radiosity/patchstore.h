@@ -0,0 +1,257 @@
+///
+/// @file PatchStore.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Radiometric state of all patches in a scene, laid out as one array
+///     per quantity so the solver streams through contiguous memory.
+///
+
+#ifndef PATCH_STORE_H
+#define PATCH_STORE_H
+
+#include "patch.h"
+#include "color.h"
+
+#include <vector>
+
+namespace Radiosity
+{
+
+class PatchStore
+{
+public:
+
+    ///
+    /// @name PatchStore
+    ///
+    /// @description
+    /// 	Constructor. Copies the material of every patch into the store
+    ///     and binds the patches to it, so their exidence is read from
+    ///     here from then on. Exidence starts out at the emission.
+    ///
+    /// @param patches - the patches of the scene, by index
+    ///
+    explicit PatchStore(std::vector<Patch*> *patches);
+
+    ///
+    /// @name ~PatchStore
+    ///
+    /// @description
+    /// 	Destructor. The patches stay bound, so they must not be asked
+    ///     for their exidence afterwards.
+    ///
+    ~PatchStore();
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of patches in the store.
+    ///
+    /// @return - the number of patches
+    ///
+    unsigned int Size() const;
+
+    ///
+    /// @name GetExidence
+    ///
+    /// @description
+    /// 	Gathers the exidence of one patch.
+    ///
+    /// @param index - index of the patch
+    /// @return - the light leaving the patch
+    ///
+    Color GetExidence(unsigned int index) const;
+
+    ///
+    /// @name GetIncidence
+    ///
+    /// @description
+    /// 	Gathers the incidence of one patch.
+    ///
+    /// @param index - index of the patch
+    /// @return - the light arriving at the patch
+    ///
+    Color GetIncidence(unsigned int index) const;
+
+    ///
+    /// @name Exidence
+    ///
+    /// @description
+    /// 	Accessor for the exidence of every patch in one color channel.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the exidence array
+    ///
+    float *Exidence(unsigned int channel);
+    const float *Exidence(unsigned int channel) const;
+
+    ///
+    /// @name NextExidence
+    ///
+    /// @description
+    /// 	Accessor for the back buffer of the exidence in one color
+    ///     channel. A Jacobi iteration writes the updated exidence here
+    ///     while other threads still read the current exidence, then
+    ///     calls SwapExidence.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the back buffer
+    ///
+    float *NextExidence(unsigned int channel);
+
+    ///
+    /// @name SwapExidence
+    ///
+    /// @description
+    /// 	Makes the back buffer the current exidence in every channel.
+    ///
+    void SwapExidence();
+
+    ///
+    /// @name Incidence
+    ///
+    /// @description
+    /// 	Accessor for the incidence of every patch in one color channel.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the incidence array
+    ///
+    float *Incidence(unsigned int channel);
+    const float *Incidence(unsigned int channel) const;
+
+    ///
+    /// @name Unshot
+    ///
+    /// @description
+    /// 	Accessor for the exidence every patch has received but not yet
+    ///     passed on, in one color channel. Used by shooting solvers;
+    ///     starts out at the emission.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the unshot exidence array
+    ///
+    float *Unshot(unsigned int channel);
+    const float *Unshot(unsigned int channel) const;
+
+    ///
+    /// @name Reflectance
+    ///
+    /// @description
+    /// 	Accessor for the fraction of incident light every patch
+    ///     reflects in one color channel.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the reflectance array
+    ///
+    const float *Reflectance(unsigned int channel) const;
+
+    ///
+    /// @name Emission
+    ///
+    /// @description
+    /// 	Accessor for the emission of every patch in one color channel.
+    ///
+    /// @param channel - 0 for red, 1 for green, 2 for blue
+    /// @return - the emission array
+    ///
+    const float *Emission(unsigned int channel) const;
+
+    ///
+    /// @name Area
+    ///
+    /// @description
+    /// 	Accessor for the area of every patch.
+    ///
+    /// @return - the area array
+    ///
+    const float *Area() const;
+
+private:
+
+    PatchStore(const PatchStore &);
+    PatchStore &operator=(const PatchStore &);
+
+    std::vector<float> mExidence[3];
+    std::vector<float> mNextExidence[3];
+    std::vector<float> mIncidence[3];
+    std::vector<float> mUnshot[3];
+    std::vector<float> mReflectance[3];
+    std::vector<float> mEmission[3];
+    std::vector<float> mArea;
+
+};  // class PatchStore
+
+inline unsigned int PatchStore::Size() const
+{
+    return mArea.size();
+}
+
+inline Color PatchStore::GetExidence(unsigned int index) const
+{
+    return Color(mExidence[0][index], mExidence[1][index],
+                 mExidence[2][index]);
+}
+
+inline Color PatchStore::GetIncidence(unsigned int index) const
+{
+    return Color(mIncidence[0][index], mIncidence[1][index],
+                 mIncidence[2][index]);
+}
+
+inline float *PatchStore::Exidence(unsigned int channel)
+{
+    return mExidence[channel].data();
+}
+
+inline const float *PatchStore::Exidence(unsigned int channel) const
+{
+    return mExidence[channel].data();
+}
+
+inline float *PatchStore::NextExidence(unsigned int channel)
+{
+    return mNextExidence[channel].data();
+}
+
+inline float *PatchStore::Incidence(unsigned int channel)
+{
+    return mIncidence[channel].data();
+}
+
+inline const float *PatchStore::Incidence(unsigned int channel) const
+{
+    return mIncidence[channel].data();
+}
+
+inline float *PatchStore::Unshot(unsigned int channel)
+{
+    return mUnshot[channel].data();
+}
+
+inline const float *PatchStore::Unshot(unsigned int channel) const
+{
+    return mUnshot[channel].data();
+}
+
+inline const float *PatchStore::Reflectance(unsigned int channel) const
+{
+    return mReflectance[channel].data();
+}
+
+inline const float *PatchStore::Emission(unsigned int channel) const
+{
+    return mEmission[channel].data();
+}
+
+inline const float *PatchStore::Area() const
+{
+    return mArea.data();
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -0,0 +1,146 @@
+///
+/// @file ProgressiveSolver.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Progressive refinement radiosity: repeatedly shoots the unshot light
+///     of the brightest patch into the scene.
+///
+
+#ifndef PROGRESSIVE_SOLVER_H
+#define PROGRESSIVE_SOLVER_H
+
+#include "patch.h"
+#include "patchstore.h"
+#include "formcalculator.h"
+#include "formfactormatrix.h"
+#include "shooterqueue.h"
+
+#include <vector>
+
+namespace Radiosity
+{
+
+class ProgressiveSolver
+{
+public:
+
+    ///
+    /// @name ProgressiveSolver
+    ///
+    /// @description
+    /// 	Constructor. No form factors are needed up front; the hemicube
+    ///     of a patch is traced the first time it shoots.
+    ///
+    /// @param patches - the patches of the scene
+    /// @param store - radiometric state of the patches, updated in place
+    /// @param formCalculator - traces the hemicubes of the shooters
+    ///
+    ProgressiveSolver(std::vector<Patch*> *patches, PatchStore *store,
+                      FormCalculator *formCalculator);
+
+    ///
+    /// @name ~ProgressiveSolver
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~ProgressiveSolver();
+
+    ///
+    /// @name Shoot
+    ///
+    /// @description
+    /// 	Picks the patch with the most unshot power and distributes its
+    ///     unshot light to every patch it sees. Each receiver reflects its
+    ///     share, which becomes unshot light of its own.
+    ///
+    /// @return - false if there was no unshot light left to shoot
+    ///
+    bool Shoot();
+
+    ///
+    /// @name GetShots
+    ///
+    /// @description
+    /// 	Accessor for the number of shots taken so far.
+    ///
+    /// @return - the number of shots
+    ///
+    unsigned int GetShots() const;
+
+    ///
+    /// @name UnshotPower
+    ///
+    /// @description
+    /// 	Total unshot power in the scene, summed over the color
+    ///     channels. Falls towards zero as the solution converges.
+    ///
+    /// @return - the unshot power
+    ///
+    float UnshotPower() const;
+
+    ///
+    /// @name RelativeUnshotPower
+    ///
+    /// @description
+    /// 	Unshot power as a fraction of the power the scene emits, the
+    ///     residual of the shooting solver.
+    ///
+    /// @return - the relative unshot power, zero for a dark scene
+    ///
+    float RelativeUnshotPower() const;
+
+private:
+
+    ProgressiveSolver(const ProgressiveSolver &);
+    ProgressiveSolver &operator=(const ProgressiveSolver &);
+
+    ///
+    /// @name UpdateKey
+    ///
+    /// @description
+    /// 	Recomputes the unshot power of a patch in the queue.
+    ///
+    /// @param index - index of the patch
+    ///
+    void UpdateKey(unsigned int index);
+
+    std::vector<Patch*> *mPatches;
+    PatchStore *mStore;
+    FormCalculator *mFormCalculator;
+
+    ShooterQueue mQueue;
+
+    ///
+    /// @name mRows
+    ///
+    /// @description
+    ///		Form factors of every patch that has shot, kept for when it
+    ///     shoots again.
+    ///
+    std::vector< std::vector<FormFactorMatrix::Entry> > mRows;
+    std::vector<bool> mTraced;
+
+    unsigned int mShots;
+
+    ///
+    /// @name mEmittedPower
+    ///
+    /// @description
+    ///		Unshot power before the first shot.
+    ///
+    float mEmittedPower;
+
+};  // class ProgressiveSolver
+
+inline unsigned int ProgressiveSolver::GetShots() const
+{
+    return mShots;
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -5,7 +5,7 @@
 /// @date 2 February 2012
 ///
 /// @description
-/// 	Implements a progressive radiosity algorithm.
+/// 	Implements a gathering radiosity algorithm.
 ///
 
 #ifndef RADIOSITY_CALCULATOR_H
@@ -14,11 +14,22 @@
 #include "point.h"
 #include "vector.h"
 #include "patch.h"
+#include "formfactormatrix.h"
+#include "patchstore.h"
+#include "residual.h"
+#include "threadpool.h"
 
 #include <vector>
 #include <cstdlib>
 #include <iostream>
 
+///
+/// Number of pieces a Jacobi iteration is split into. Fixed rather than
+/// derived from the number of threads so that the residual is summed in
+/// the same order however many threads run.
+///
+#define JACOBI_PARTITIONS 64
+
 namespace Radiosity
 {
 
@@ -26,17 +37,218 @@ class RadiosityCalculator
 {
 public:
 
+    ///
+    /// @name Method
+    ///
+    /// @description
+    /// 	How each iteration updates the exidence.
+    ///
+    ///     JACOBI - gather every patch from the previous iteration, then
+    ///              update them all at once
+    ///     GAUSS_SEIDEL - update each patch as soon as it is gathered, so
+    ///                    later patches already see the new value
+    ///     SOR - Gauss-Seidel, moving each patch past its gathered value
+    ///           by the relaxation factor
+    ///
+    enum Method
+    {
+        JACOBI,
+        GAUSS_SEIDEL,
+        SOR
+    };
+
+    ///
+    /// @name RadiosityCalculator
+    ///
+    /// @description
+    /// 	Constructor. Defaults to Jacobi iteration on the calling thread,
+    ///     and without a tolerance runs every iteration it is given.
+    ///
+    RadiosityCalculator();
+
+    ///
+    /// @name SetMethod
+    ///
+    /// @description
+    /// 	Choose how each iteration updates the exidence.
+    ///
+    /// @param method - the iteration method
+    ///
+    void SetMethod(Method method);
+
+    ///
+    /// @name SetRelaxation
+    ///
+    /// @description
+    /// 	Set the relaxation factor, omega, used by SOR. Values between
+    ///     1 and 2 over-relax and usually converge in fewer iterations.
+    ///
+    /// @param omega - the relaxation factor
+    ///
+    void SetRelaxation(float omega);
+
+    ///
+    /// @name SetColoredOrdering
+    ///
+    /// @description
+    /// 	Sweep Gauss-Seidel and SOR color by color. Patches are colored
+    ///     so that no two patches of a color exchange light, which lets
+    ///     each color be updated in parallel with the same result on any
+    ///     number of threads. Patches on a common plane never see each
+    ///     other, so closed interiors need few colors.
+    ///
+    /// @param colored - true to sweep by color, false to sweep in index
+    ///                  order
+    ///
+    void SetColoredOrdering(bool colored);
+
+    ///
+    /// @name SetThreadPool
+    ///
+    /// @description
+    /// 	Threads used by the parallel parts of the solver.
+    ///
+    /// @param pool - the threads, or nullptr to run on the calling thread
+    ///
+    void SetThreadPool(ThreadPool *pool);
+
+    ///
+    /// @name SetTolerance
+    ///
+    /// @description
+    /// 	Stop iterating once the residual of an iteration drops below
+    ///     the given tolerance.
+    ///
+    /// @param tolerance - the relative residual to stop at, or 0 to run
+    ///                    every iteration
+    ///
+    void SetTolerance(float tolerance);
+
+    ///
+    /// @name SetNorm
+    ///
+    /// @description
+    /// 	Choose how the residual of an iteration is measured.
+    ///
+    /// @param norm - the norm of the change in exidence
+    ///
+    void SetNorm(Residual::Norm norm);
+
     ///
     /// @name CalculateRadiosity
     ///
     /// @description
-    /// 	Implements a progressive radiosity solution.
+    /// 	Solves for the radiosity of every patch by repeatedly gathering
+    ///     light from the whole scene. The residual of every iteration is
+    ///     reported on standard output.
+    ///
+    /// @param store - radiometric state of the patches in the scene,
+    ///                updated in place
+    /// @param formFactors - form factors between the patches
+    /// @param numIterations - largest number of iterations to run
+    /// @return - the number of iterations run
+    ///
+    int CalculateRadiosity(PatchStore *store,
+                           const FormFactorMatrix &formFactors,
+                           int numIterations);
+
+private:
+
+    ///
+    /// @name JacobiStep
+    ///
+    /// @description
+    /// 	Runs one Jacobi iteration. Every patch gathers from the current
+    ///     exidence and writes to the back buffer, so the partitions can
+    ///     run in parallel without racing.
+    ///
+    /// @param store - radiometric state of the patches
+    /// @param formFactors - form factors between the patches
+    /// @param residual - receives the change of every patch
+    ///
+    void JacobiStep(PatchStore *store, const FormFactorMatrix &formFactors,
+                    Residual &residual);
+
+    ///
+    /// @name PartitionRows
+    ///
+    /// @description
+    /// 	Splits the patches into JACOBI_PARTITIONS contiguous ranges of
+    ///     about the same number of form factors, so that patches that
+    ///     see much of the scene do not leave one thread straggling.
+    ///
+    /// @param formFactors - form factors between the patches
+    ///
+    void PartitionRows(const FormFactorMatrix &formFactors);
+
+    ///
+    /// @name GaussSeidelStep
+    ///
+    /// @description
+    /// 	Runs one Gauss-Seidel or SOR iteration, sweeping the colors in
+    ///     order and the patches of each color in parallel.
+    ///
+    /// @param store - radiometric state of the patches
+    /// @param formFactors - form factors between the patches
+    /// @param colors - the patches of each color; a single color holding
+    ///                 every patch sweeps them in order on one thread
+    /// @param residual - receives the change of every patch
+    ///
+    void GaussSeidelStep(PatchStore *store,
+                         const FormFactorMatrix &formFactors,
+                         const std::vector< std::vector<uint32_t> > &colors,
+                         Residual &residual);
+
+    ///
+    /// @name ColorPatches
+    ///
+    /// @description
+    /// 	Greedily colors the patches so that no two patches linked by a
+    ///     form factor, in either direction, share a color.
+    ///
+    /// @param formFactors - form factors between the patches
+    /// @param colors - receives the patches of each color
+    ///
+    void ColorPatches(const FormFactorMatrix &formFactors,
+                      std::vector< std::vector<uint32_t> > &colors);
+
+    float mTolerance;
+
+    Residual::Norm mNorm;
+
+    Method mMethod;
+
+    float mRelaxation;
+
+    bool mColored;
+
+    ThreadPool *mPool;
+
+    ///
+    /// @name mPrevious
+    ///
+    /// @description
+    ///		Exidence of the patches of a color before they are updated,
+    ///     used to measure the residual in a fixed order.
+    ///
+    std::vector<float> mPrevious;
+
+    ///
+    /// @name mPartitions
+    ///
+    /// @description
+    ///		First patch of each Jacobi partition, followed by the number of
+    ///     patches.
+    ///
+    std::vector<uint32_t> mPartitions;
+
+    ///
+    /// @name mPartials
     ///
-    /// @param patches - vector containing patches in the scene
-    /// @param numIterations - number of iterations to run through the
-    ///                        progressive solution
+    /// @description
+    ///		Residual of each Jacobi partition, merged in partition order.
     ///
-    void CalculateRadiosity(std::vector<Patch*> *patches, int numIterations);
+    std::vector<Residual> mPartials;
 
 };  // class RadiosityCalculator
 
@@ -0,0 +1,104 @@
+///
+/// @file Residual.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Measures how much a solver iteration changed the exidence, to
+///     decide when the solution has converged.
+///
+
+#ifndef RESIDUAL_H
+#define RESIDUAL_H
+
+namespace Radiosity
+{
+
+class Residual
+{
+public:
+
+    ///
+    /// @name Norm
+    ///
+    /// @description
+    /// 	How the changes of the individual patches are combined.
+    ///
+    ///     L1 - sum of the absolute changes over the sum of the exidences
+    ///     L_INFINITY - largest absolute change over the largest exidence
+    ///
+    enum Norm
+    {
+        L1,
+        L_INFINITY
+    };
+
+    ///
+    /// @name Residual
+    ///
+    /// @description
+    /// 	Constructor. Starts out with no change recorded.
+    ///
+    /// @param norm - how to combine the changes
+    ///
+    explicit Residual(Norm norm);
+
+    ///
+    /// @name Add
+    ///
+    /// @description
+    /// 	Records the change of one patch in one color channel.
+    ///
+    /// @param old - the exidence before the update
+    /// @param updated - the exidence after the update
+    ///
+    void Add(float old, float updated);
+
+    ///
+    /// @name Merge
+    ///
+    /// @description
+    /// 	Combines the changes recorded by another residual, such as one
+    ///     kept by another thread.
+    ///
+    /// @param other - the residual to fold in; must use the same norm
+    ///
+    void Merge(const Residual &other);
+
+    ///
+    /// @name Value
+    ///
+    /// @description
+    /// 	The change relative to the size of the solution, so that one
+    ///     tolerance suits scenes of any brightness.
+    ///
+    /// @return - the relative residual, zero for a dark scene
+    ///
+    float Value() const;
+
+private:
+
+    Norm mNorm;
+
+    ///
+    /// @name mChange
+    ///
+    /// @description
+    ///		Sum or maximum of the absolute changes.
+    ///
+    double mChange;
+
+    ///
+    /// @name mMagnitude
+    ///
+    /// @description
+    ///		Sum or maximum of the updated exidences.
+    ///
+    double mMagnitude;
+
+};  // class Residual
+
+}   // namespace Radiosity
+
+#endif
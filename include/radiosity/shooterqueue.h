@@ -0,0 +1,107 @@
+///
+/// @file ShooterQueue.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Indexed max-heap of patches keyed by their unshot power, used to
+///     pick the next patch to shoot from.
+///
+
+#ifndef SHOOTER_QUEUE_H
+#define SHOOTER_QUEUE_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace Radiosity
+{
+
+class ShooterQueue
+{
+public:
+
+    ///
+    /// @name ShooterQueue
+    ///
+    /// @description
+    /// 	Constructor. Every patch starts out in the queue with a key of
+    ///     zero.
+    ///
+    /// @param size - number of patches
+    ///
+    explicit ShooterQueue(unsigned int size);
+
+    ///
+    /// @name Update
+    ///
+    /// @description
+    /// 	Changes the key of a patch and restores the heap order, in
+    ///     logarithmic time.
+    ///
+    /// @param index - index of the patch
+    /// @param key - the new key
+    ///
+    void Update(unsigned int index, float key);
+
+    ///
+    /// @name Top
+    ///
+    /// @description
+    /// 	Finds the patch with the largest key.
+    ///
+    /// @return - index of the patch
+    ///
+    unsigned int Top() const;
+
+    ///
+    /// @name Key
+    ///
+    /// @description
+    /// 	Accessor for the key of a patch.
+    ///
+    /// @param index - index of the patch
+    /// @return - the key
+    ///
+    float Key(unsigned int index) const;
+
+private:
+
+    void SiftUp(unsigned int position);
+    void SiftDown(unsigned int position);
+    void Swap(unsigned int first, unsigned int second);
+
+    ///
+    /// @name mHeap
+    ///
+    /// @description
+    ///		Patch indices in heap order.
+    ///
+    std::vector<uint32_t> mHeap;
+
+    ///
+    /// @name mPositions
+    ///
+    /// @description
+    ///		Position of every patch in mHeap.
+    ///
+    std::vector<uint32_t> mPositions;
+
+    std::vector<float> mKeys;
+
+};  // class ShooterQueue
+
+inline unsigned int ShooterQueue::Top() const
+{
+    return mHeap.front();
+}
+
+inline float ShooterQueue::Key(unsigned int index) const
+{
+    return mKeys[index];
+}
+
+}   // namespace Radiosity
+
+#endif
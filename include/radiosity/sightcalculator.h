@@ -12,6 +12,46 @@
 #define SIGHT_CALCULATOR_H
 
 #include "patch.h"
+#include "bvh.h"
+#include "threadpool.h"
+#include "visibilitymatrix.h"
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+///
+/// Patches whose centers are within this fraction of the scene size of
+/// another patch's plane cannot be culled as a group and are tested one
+/// pair at a time.
+///
+#define PLANE_TOLERANCE 1e-5f
+
+///
+/// Patches whose normals differ by less than this along every axis share
+/// a cluster, so rounding noise does not split a wall into many.
+///
+#define NORMAL_TOLERANCE 1e-5f
+
+///
+/// Largest number of clusters kept. Patches outside the largest clusters
+/// get the full per-pair test, which bounds the side table at this many
+/// bytes per patch on curved or finely faceted scenes.
+///
+#define MAX_CLUSTERS 128
+
+///
+/// Fraction of the way from a corner to the center of a patch at which
+/// the occlusion test samples the corner, keeping the rays clear of the
+/// edges shared with neighbouring patches.
+///
+#define OCCLUSION_INSET 0.05f
+
+///
+/// Number of points sampled on each patch by the occlusion test: the
+/// center and the four corners.
+///
+#define OCCLUSION_SAMPLES 5
 
 namespace Radiosity
 {
@@ -43,8 +83,60 @@ public:
     /// 	Calculates los between all pairs of patches
     ///
     /// @param patches - vector of patches
+    /// @param bvh - hierarchy over the patches for the occlusion test, or
+    ///              nullptr to build one when it is needed
+    /// @param visibility - receives the pairs with line of sight
+    ///
+    void CalculateLOS(std::vector<Patch*> *patches, const Bvh *bvh,
+                      VisibilityMatrix *visibility);
+
+    ///
+    /// @name UpdateLOS
+    ///
+    /// @description
+    /// 	Calculates los between all pairs of patches of a refined scene.
+    ///     Facing is found again for every pair, but only the pairs with
+    ///     a patch split or merged since the previous scene get the
+    ///     occlusion test. Pairs of patches carried over unchanged keep
+    ///     their line of sight from the previous matrix: the surfaces
+    ///     between them are the same, only cut differently.
+    ///
+    /// @param patches - vector of patches
+    /// @param bvh - hierarchy over the patches for the occlusion test, or
+    ///              nullptr to build one when it is needed
+    /// @param previous - line of sight of the previous scene
+    /// @param rows - for every patch, its row in the previous matrix, or
+    ///               NO_PREVIOUS_ROW for a new patch
+    /// @param visibility - receives the pairs with line of sight
+    ///
+    void UpdateLOS(std::vector<Patch*> *patches, const Bvh *bvh,
+                   const VisibilityMatrix &previous,
+                   const std::vector<uint32_t> &rows,
+                   VisibilityMatrix *visibility);
+
+    ///
+    /// @name SetThreadPool
+    ///
+    /// @description
+    /// 	Sets the threads the occlusion test runs on.
+    ///
+    /// @param pool - the threads to use, or nullptr to run on the calling
+    ///               thread
+    ///
+    void SetThreadPool(ThreadPool *pool);
+
+    ///
+    /// @name SetOcclusionTest
+    ///
+    /// @description
+    /// 	Sets whether CalculateLOS removes the pairs of patches hidden
+    ///     from each other. Off by default: the ray cast and z-buffer
+    ///     hemicubes resolve occlusion themselves, and the test only pays
+    ///     off where the line of sight vectors drive the work.
+    ///
+    /// @param occlusion - true to run the occlusion test
     ///
-    void CalculateLOS(std::vector<Patch*> *patches);
+    void SetOcclusionTest(bool occlusion);
 
 private:
 
@@ -52,21 +144,148 @@ private:
     /// @name RunQuickElimination
     ///
     /// @description
-    /// 	Runs quick normal-based LOS elimination
+    /// 	Runs quick normal-based LOS elimination. Patches are grouped
+    ///     into clusters sharing a normal and a plane. Two patches face
+    ///     each other when each lies in front of the plane of the other's
+    ///     cluster, so the sides are found once per patch and cluster and
+    ///     looked up per pair. Only patches too close to a plane to tell,
+    ///     or outside the largest clusters, get the full per-pair test.
+    ///     Rows of the matrix are filled in parallel.
     ///
     /// @param patches - vector of patches
+    /// @param visibility - receives the facing pairs
+    ///
+    void RunQuickElimination(std::vector<Patch*> *patches,
+                             VisibilityMatrix *visibility);
+
+    ///
+    /// @name Cluster
+    ///
+    /// @description
+    /// 	Patches with about the same normal whose centers lie on about
+    ///     the same plane, such as the patches of one wall.
     ///
-    void RunQuickElimination(std::vector<Patch*> *patches);
+    struct Cluster
+    {
+        Vector normal;
+        float minOffset;
+        float maxOffset;
+        std::vector<uint32_t> members;
+    };
+
+    ///
+    /// @name PlaneKey
+    ///
+    /// @description
+    /// 	A plane with its normal and offset rounded to the tolerances,
+    ///     which keys the clusters.
+    ///
+    struct PlaneKey
+    {
+        int64_t mX;
+        int64_t mY;
+        int64_t mZ;
+        int64_t mOffset;
+
+        bool operator==(const PlaneKey &other) const;
+    };
+
+    struct PlaneKeyHash
+    {
+        std::size_t operator()(const PlaneKey &key) const;
+    };
+
+    ///
+    /// @name BuildClusters
+    ///
+    /// @description
+    /// 	Groups the patches into clusters by their rounded planes, and
+    ///     keeps the MAX_CLUSTERS largest.
+    ///
+    /// @param patches - vector of patches
+    /// @param tolerance - size of the steps plane offsets are rounded to
+    /// @param clusters - receives the clusters, largest first
+    ///
+    void BuildClusters(const std::vector<Patch*> *patches, float tolerance,
+                       std::vector<Cluster> &clusters);
+
+    ///
+    /// @name Side
+    ///
+    /// @description
+    /// 	Where a patch lies relative to the plane of a cluster.
+    ///
+    enum Side
+    {
+        BEHIND,
+        IN_FRONT,
+        UNSURE
+    };
+
+    ///
+    /// @name Classify
+    ///
+    /// @description
+    /// 	Finds which side of the plane of a cluster the center of a patch
+    ///     lies on.
+    ///
+    /// @param patch - the patch
+    /// @param cluster - the cluster whose plane it is tested against
+    /// @param tolerance - distance from the plane within which the side
+    ///                    is unsure
+    /// @return - the side, as a Side
+    ///
+    char Classify(const Patch *patch, const Cluster &cluster,
+                  float tolerance);
+
+    ThreadPool *mPool;
+
+    bool mOcclusion;
 
     ///
     /// @name RunInterceptTest
     ///
     /// @description
-    /// 	Calculates los between all pairs of patches using intercept tests
+    /// 	Clears the pairs of patches that are hidden from each other.
+    ///     Each pair is tested once, in the row of the patch with the
+    ///     lower index, with the rows in parallel.
     ///
     /// @param patches - vector of patches
+    /// @param bvh - hierarchy used to look for patches between two patches
+    /// @param visibility - the pairs to test, updated in place
+    ///
+    void RunInterceptTest(std::vector<Patch*> *patches, const Bvh *bvh,
+                          VisibilityMatrix *visibility);
+
+    ///
+    /// @name IsOccluded
+    ///
+    /// @description
+    /// 	Determines if two patches are hidden from each other. The hemicube
+    ///     still resolves partial occlusion, so a pair only counts as
+    ///     hidden when every ray between the sample points of the two
+    ///     patches is blocked.
+    ///
+    /// @param patch1 - one patch
+    /// @param patch2 - the other patch
+    /// @param bvh - hierarchy used to look for patches between them
+    /// @return - true if no sampled ray gets through
+    ///
+    bool IsOccluded(const Patch *patch1, const Patch *patch2,
+                    const Bvh *bvh) const;
+
+    ///
+    /// @name SamplePoint
+    ///
+    /// @description
+    /// 	Finds one of the points on a patch the occlusion test fires rays
+    ///     between.
+    ///
+    /// @param patch - the patch
+    /// @param sample - 0 for the center, 1 to 4 for the corners
+    /// @return - the sample point
     ///
-    void RunInterceptTest(std::vector<Patch*> *patches);
+    Point SamplePoint(const Patch *patch, int sample) const;
 
 
 };  // class SightCalculator
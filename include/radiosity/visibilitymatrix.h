@@ -0,0 +1,304 @@
+///
+/// @file VisibilityMatrix.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Packed, symmetric bit matrix recording which pairs of patches have
+///     line of sight to each other.
+///
+
+#ifndef VISIBILITY_MATRIX_H
+#define VISIBILITY_MATRIX_H
+
+#include <cstddef>
+#include <cstdio>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Marks a patch that has no row in an earlier matrix, such as a patch
+// new to a refined scene
+#define NO_PREVIOUS_ROW 0xFFFFFFFFu
+
+namespace Radiosity
+{
+
+class VisibilityMatrix
+{
+public:
+
+    ///
+    /// @name VisibilityMatrix
+    ///
+    /// @description
+    /// 	Constructor. Creates an empty matrix; call Reset before use.
+    ///
+    VisibilityMatrix();
+
+    ///
+    /// @name ~VisibilityMatrix
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~VisibilityMatrix();
+
+    ///
+    /// @name Reset
+    ///
+    /// @description
+    /// 	Resizes the matrix and clears every pair. Only the pairs above
+    ///     the diagonal are stored, each row starting on a fresh word so
+    ///     that rows can be filled by different threads.
+    ///
+    /// @param size - number of patches
+    ///
+    void Reset(unsigned int size);
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of patches.
+    ///
+    /// @return - the number of patches
+    ///
+    unsigned int Size() const;
+
+    ///
+    /// @name Set
+    ///
+    /// @description
+    /// 	Records that two patches can see each other. Writes the row of
+    ///     the lower index.
+    ///
+    /// @param a - index of one patch
+    /// @param b - index of the other patch; must differ from a
+    ///
+    void Set(uint32_t a, uint32_t b);
+
+    ///
+    /// @name Clear
+    ///
+    /// @description
+    /// 	Records that two patches cannot see each other. Writes the row
+    ///     of the lower index.
+    ///
+    /// @param a - index of one patch
+    /// @param b - index of the other patch; must differ from a
+    ///
+    void Clear(uint32_t a, uint32_t b);
+
+    ///
+    /// @name Get
+    ///
+    /// @description
+    /// 	Determines if two patches can see each other.
+    ///
+    /// @param a - index of one patch
+    /// @param b - index of the other patch
+    /// @return - true if they can; a patch never sees itself
+    ///
+    bool Get(uint32_t a, uint32_t b) const;
+
+    ///
+    /// @name RowWords
+    ///
+    /// @description
+    /// 	Accessor for the packed pairs of a patch with every patch of
+    ///     higher index: bit k of the row is the pair with patch
+    ///     row + 1 + k. Unused bits of the last word stay zero.
+    ///
+    /// @param row - index of the patch
+    /// @return - the words of the row
+    ///
+    uint64_t *RowWords(uint32_t row);
+    const uint64_t *RowWords(uint32_t row) const;
+
+    ///
+    /// @name RowWordCount
+    ///
+    /// @description
+    /// 	Accessor for the number of words in a row.
+    ///
+    /// @param row - index of the patch
+    /// @return - the number of words
+    ///
+    unsigned int RowWordCount(uint32_t row) const;
+
+    ///
+    /// @name Count
+    ///
+    /// @description
+    /// 	Counts the patches one patch can see. The pairs with patches of
+    ///     lower index are stored in other rows; they are read by
+    ///     transposing, 64 by 64 bits at a time, the blocks holding them.
+    ///
+    /// @param row - index of the patch
+    /// @return - the number of patches it can see
+    ///
+    std::size_t Count(uint32_t row) const;
+
+    ///
+    /// @name Pairs
+    ///
+    /// @description
+    /// 	Counts the pairs of patches that can see each other.
+    ///
+    /// @return - the number of pairs, each counted once
+    ///
+    std::size_t Pairs() const;
+
+    ///
+    /// @name Row
+    ///
+    /// @description
+    /// 	Lists the patches one patch can see, reading the pairs with
+    ///     patches of lower index as Count does.
+    ///
+    /// @param row - index of the patch
+    /// @param indices - receives the indices of the patches, in order
+    ///
+    void Row(uint32_t row, std::vector<uint32_t> &indices) const;
+
+    ///
+    /// @name MemoryUsage
+    ///
+    /// @description
+    /// 	Accessor for the bytes held by the matrix.
+    ///
+    /// @return - the number of bytes
+    ///
+    std::size_t MemoryUsage() const;
+
+    ///
+    /// @name Validate
+    ///
+    /// @description
+    /// 	Checks Row and Count of every patch against Get, pair by pair.
+    ///
+    /// @return - the number of patches whose row or count differs
+    ///
+    std::size_t Validate() const;
+
+    ///
+    /// @name Write
+    ///
+    /// @description
+    /// 	Writes the matrix to a binary file: the number of patches, then
+    ///     every word in a single write.
+    ///
+    /// @param file - the file to write to
+    /// @return - true on success
+    ///
+    bool Write(FILE *file) const;
+
+    ///
+    /// @name Read
+    ///
+    /// @description
+    /// 	Reads a matrix written by Write, replacing this one.
+    ///
+    /// @param file - the file to read from
+    /// @return - true on success
+    ///
+    bool Read(FILE *file);
+
+private:
+
+    VisibilityMatrix(const VisibilityMatrix &);
+    VisibilityMatrix &operator=(const VisibilityMatrix &);
+
+    ///
+    /// @name Columns
+    ///
+    /// @description
+    /// 	Reads 64 consecutive pairs of a row above the diagonal. Columns
+    ///     on or below the diagonal, or past the end, read as zero.
+    ///
+    /// @param row - index of the patch
+    /// @param first - the first column
+    /// @return - bit k is the pair with patch first + k
+    ///
+    uint64_t Columns(uint32_t row, uint32_t first) const;
+
+    ///
+    /// @name LowerColumns
+    ///
+    /// @description
+    /// 	Reads 64 consecutive pairs of a row below the diagonal by
+    ///     transposing the block of 64 rows above the diagonal that holds
+    ///     them. Rows on or past the diagonal read as zero.
+    ///
+    /// @param row - index of the patch
+    /// @param first - the first column; a multiple of 64 below row
+    /// @return - bit k is the pair with patch first + k
+    ///
+    uint64_t LowerColumns(uint32_t row, uint32_t first) const;
+
+    ///
+    /// @name Transpose
+    ///
+    /// @description
+    /// 	Transposes a 64 by 64 bit block in place: bit j of word i
+    ///     swaps with bit i of word j.
+    ///
+    /// @param block - the block, one word per row
+    ///
+    static void Transpose(uint64_t block[64]);
+
+    unsigned int mSize;
+
+    ///
+    /// @name mOffsets
+    ///
+    /// @description
+    ///		First word of each row, followed by the total number of words.
+    ///
+    std::vector<std::size_t> mOffsets;
+
+    std::vector<uint64_t> mWords;
+
+};  // class VisibilityMatrix
+
+inline unsigned int VisibilityMatrix::Size() const
+{
+    return mSize;
+}
+
+inline bool VisibilityMatrix::Get(uint32_t a, uint32_t b) const
+{
+    if (a == b)
+    {
+        return false;
+    }
+
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+
+    uint32_t bit = b - a - 1;
+    return (mWords[mOffsets[a] + bit / 64] >> (bit % 64)) & 1;
+}
+
+inline uint64_t *VisibilityMatrix::RowWords(uint32_t row)
+{
+    return &mWords[0] + mOffsets[row];
+}
+
+inline const uint64_t *VisibilityMatrix::RowWords(uint32_t row) const
+{
+    return &mWords[0] + mOffsets[row];
+}
+
+inline unsigned int VisibilityMatrix::RowWordCount(uint32_t row) const
+{
+    return mOffsets[row + 1] - mOffsets[row];
+}
+
+}   // namespace Radiosity
+
+#endif
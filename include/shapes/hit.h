@@ -0,0 +1,82 @@
+///
+/// @file Hit.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Where a ray meets a shape, returned by value from the intersection
+///     tests.
+///
+
+#ifndef HIT_H
+#define HIT_H
+
+namespace Radiosity
+{
+
+struct Hit
+{
+    ///
+    /// @name Hit
+    ///
+    /// @description
+    /// 	Constructor. Creates a miss.
+    ///
+    Hit();
+
+    ///
+    /// @name IsHit
+    ///
+    /// @description
+    /// 	Determines if the ray met the shape.
+    ///
+    /// @return - true for a hit
+    ///
+    bool IsHit() const;
+
+    ///
+    /// @name t
+    ///
+    /// @description
+    ///		Distance along the ray in units of its direction vector, or -1
+    ///     for a miss.
+    ///
+    float t;
+
+    ///
+    /// @name u, v
+    ///
+    /// @description
+    ///		Position of the hit on the shape, from 0 to 1 along each of its
+    ///     two edges.
+    ///
+    float u;
+    float v;
+
+    ///
+    /// @name shape
+    ///
+    /// @description
+    ///		Index of the shape hit when testing several at once, or -1.
+    ///
+    int shape;
+
+};  // struct Hit
+
+inline Hit::Hit():
+    t(-1),
+    u(0),
+    v(0),
+    shape(-1)
+{
+}
+
+inline bool Hit::IsHit() const
+{
+    return t > 0;
+}
+
+}   // namespace Radiosity
+
+#endif
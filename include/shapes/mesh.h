@@ -0,0 +1,250 @@
+///
+/// @file Mesh.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	The corners of every patch of a scene, held in one array. Patches
+///     refer to their corners by index, and corners that coincide on the
+///     same plane, such as those along the edge between two quads of one
+///     wall, are welded into one.
+///
+
+#ifndef MESH_H
+#define MESH_H
+
+#include "point.h"
+#include "vector.h"
+#include "color.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// Distance along each axis, relative to the size of a patch, within which
+// two corners are welded
+#define WELD_TOLERANCE 1e-3f
+
+// Cosine of the angle between their normals above which two coinciding
+// corners are welded; corners on either side of a crease stay apart
+#define WELD_COSINE 0.9999f
+
+namespace Radiosity
+{
+
+class Patch;
+
+class Mesh
+{
+public:
+
+    ///
+    /// @name Mesh
+    ///
+    /// @description
+    /// 	Constructor. Holds no vertices until some are welded in.
+    ///
+    /// @param tolerance - distance along each axis within which two
+    ///                    corners are the same vertex, such as the patch
+    ///                    size times WELD_TOLERANCE
+    ///
+    explicit Mesh(float tolerance);
+
+    ///
+    /// @name ~Mesh
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~Mesh();
+
+    ///
+    /// @name Weld
+    ///
+    /// @description
+    /// 	Finds the vertex a corner coincides with, adding the corner as a
+    ///     new vertex if there is none. Only a vertex of a patch facing the
+    ///     same way counts, so the corners of the walls meeting at a crease
+    ///     stay apart and keep their own colors. Adding vertices moves the
+    ///     others, so references to vertices do not outlive a call to Weld.
+    ///
+    /// @param point - position of the corner
+    /// @param normal - normal of the patches the corner belongs to
+    /// @return - index of the vertex
+    ///
+    uint32_t Weld(const Point &point, const Vector &normal);
+
+    ///
+    /// @name Add
+    ///
+    /// @description
+    /// 	Adds a vertex without looking for one it coincides with, for
+    ///     corners known to be new, such as those inside a quad. Later
+    ///     calls to Weld still find it.
+    ///
+    /// @param point - position of the corner
+    /// @param normal - normal of the patches the corner belongs to
+    /// @return - index of the vertex
+    ///
+    uint32_t Add(const Point &point, const Vector &normal);
+
+    ///
+    /// @name GetVertex
+    ///
+    /// @description
+    /// 	Accessor for the position of a vertex.
+    ///
+    /// @param index - index of the vertex
+    /// @return - the position
+    ///
+    const Point &GetVertex(uint32_t index) const;
+
+    ///
+    /// @name GetNormal
+    ///
+    /// @description
+    /// 	Accessor for the normal a vertex was welded with.
+    ///
+    /// @param index - index of the vertex
+    /// @return - the unit normal
+    ///
+    const Vector &GetNormal(uint32_t index) const;
+
+    ///
+    /// @name GetColor
+    ///
+    /// @description
+    /// 	Accessor for the color of a vertex, as of the last call to
+    ///     UpdateColors.
+    ///
+    /// @param index - index of the vertex
+    /// @return - the color
+    ///
+    const Color &GetColor(uint32_t index) const;
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of vertices.
+    ///
+    /// @return - the number of vertices
+    ///
+    unsigned int Size() const;
+
+    ///
+    /// @name MemoryUsage
+    ///
+    /// @description
+    /// 	Size of the vertex, normal, color and chain arrays.
+    ///
+    /// @return - the number of bytes used by the mesh
+    ///
+    std::size_t MemoryUsage() const;
+
+    ///
+    /// @name UpdateColors
+    ///
+    /// @description
+    /// 	Colors every vertex with the average color of the lit patches
+    ///     around it, in one pass over the patches. As with the per-point
+    ///     averages this replaces, unlit patches are left out, so a dark
+    ///     patch does not darken the corners it shares with lit ones, and
+    ///     vertices of unlit patches only are black.
+    ///
+    /// @param patches - the patches, all with corners in this mesh
+    ///
+    void UpdateColors(const std::vector<Patch*> *patches);
+
+private:
+
+    Mesh(const Mesh &);
+    Mesh &operator=(const Mesh &);
+
+    ///
+    /// @name Cell
+    ///
+    /// @description
+    /// 	A cube of twice the tolerance on a side. Corners within the
+    ///     tolerance of each other share a cell or lie in neighbouring
+    ///     ones.
+    ///
+    struct Cell
+    {
+        int64_t mX;
+        int64_t mY;
+        int64_t mZ;
+
+        bool operator==(const Cell &other) const;
+    };
+
+    struct CellHash
+    {
+        std::size_t operator()(const Cell &cell) const;
+    };
+
+    ///
+    /// @name Insert
+    ///
+    /// @description
+    /// 	Appends a vertex and chains it into its cell.
+    ///
+    /// @param point - position of the vertex
+    /// @param normal - unit normal of the vertex
+    /// @param cell - the cell the vertex lies in
+    /// @return - index of the vertex
+    ///
+    uint32_t Insert(const Point &point, const Vector &normal,
+                    const Cell &cell);
+
+    float mTolerance;
+
+    std::vector<Point> mVertices;
+
+    std::vector<Vector> mNormals;
+
+    std::vector<Color> mColors;
+
+    ///
+    /// @name mCells
+    ///
+    /// @description
+    ///		The newest vertex in every occupied cell.
+    ///
+    std::unordered_map<Cell, uint32_t, CellHash> mCells;
+
+    ///
+    /// @name mNext
+    ///
+    /// @description
+    ///		The vertex added to the same cell before each vertex, if any.
+    ///
+    std::vector<uint32_t> mNext;
+
+};  // class Mesh
+
+inline const Point &Mesh::GetVertex(uint32_t index) const
+{
+    return mVertices[index];
+}
+
+inline const Vector &Mesh::GetNormal(uint32_t index) const
+{
+    return mNormals[index];
+}
+
+inline const Color &Mesh::GetColor(uint32_t index) const
+{
+    return mColors[index];
+}
+
+inline unsigned int Mesh::Size() const
+{
+    return mVertices.size();
+}
+
+}   // namespace Radiosity
+
+#endif
@@ -13,7 +13,9 @@
 
 #include "point.h"
 #include "vector.h"
+#include "mesh.h"
 
+#include <stdint.h>
 #include <vector>
 #include <map>
 
@@ -21,6 +23,8 @@ namespace Radiosity
 {
 
 class Patch;
+class FormFactorMatrix;
+class PatchStore;
 typedef std::map< Patch*, std::vector< std::pair< Patch*, float > > > FormFactorMap;
 
 class Patch
@@ -33,15 +37,17 @@ public:
     /// @description
     /// 	Constructor
     ///
-    /// @param a - point A in patch ABCD
-    /// @param b - point B in patch ABCD
-    /// @param c - point C in patch ABCD
-    /// @param d - point D in patch ABCD
+    /// @param mesh - the mesh holding the corners
+    /// @param a - index of point A in patch ABCD
+    /// @param b - index of point B in patch ABCD
+    /// @param c - index of point C in patch ABCD
+    /// @param d - index of point D in patch ABCD
     /// @param color - base color of the patch
     /// @param Emission - total emission of this patch
     /// @return - void
     ///
-    Patch(Point *a, Point *b, Point *c, Point *d, Color col, float emission);
+    Patch(const Mesh *mesh, uint32_t a, uint32_t b, uint32_t c, uint32_t d,
+          Color col, float emission);
 
     ///
     /// @name ~Patch
@@ -63,86 +69,140 @@ public:
     /// @param o - origin of the ray
     /// @return - distance to intersection point.
     ///
-    float Intersect(Vector v, Point o);
+    float Intersect(const Vector &v, const Point &o) const;
+
+    void Draw();
+    void DrawOutline();
+    void DrawNormal();
+
+    // Accessors
+    const Vector& GetNormal() const;
+    const Point& GetCenter() const;
+    float GetArea() const;
+    const Color& GetColor() const;
+    const Color& GetEmission() const;
+    float GetReflectance() const;
 
     ///
-    /// @name AddViewablePatch
+    /// @name GetExidence
     ///
     /// @description
-    /// 	Record a patch with line of sight to this patch.
+    /// 	Accessor for the light leaving this patch, as held by the patch
+    ///     store the patch is bound to.
     ///
-    /// @param patch - the patch with LOS
+    /// @return - the exidence, or the emission if the patch is not bound
+    ///           to a store
     ///
-    void AddViewablePatch(Patch *patch);
+    Color GetExidence() const;
 
     ///
-    /// @name RemoveViewablePatch
+    /// @name SetStore
     ///
     /// @description
-    /// 	Remove a patch from the line of sight vector.
+    /// 	Bind this patch to the store holding its radiometric state.
     ///
-    /// @param patch - the patch to remove
+    /// @param store - the store, which keeps this patch at GetIndex()
     ///
-    void RemoveViewablePatch(Patch *patch);
+    void SetStore(const PatchStore *store);
+
+    const Point* GetA() const;
+    const Point* GetB() const;
+    const Point* GetC() const;
+    const Point* GetD() const;
 
     ///
-    /// @name UpdateFormFactor
+    /// @name GetCorners
     ///
     /// @description
-    /// 	Update the form factor between this patch and one of the patches
-    ///     with line of sight. The value is added to the current form factor
-    ///     value for the given patch.
+    /// 	Accessor for the indices of corners A to D in the mesh.
     ///
-    /// @param index - the index of the second patch into the los vector
+    /// @return - the four indices
     ///
-    void UpdateFormFactor(int index, float formFactor);
+    const uint32_t* GetCorners() const;
 
     ///
-    /// @name UpdateIncidence
+    /// @name GetMesh
     ///
     /// @description
-    /// 	Update the incidence value of this patch.
+    /// 	Accessor for the mesh holding the corners.
+    ///
+    /// @return - the mesh
     ///
-    void UpdateIncidence();
+    const Mesh* GetMesh() const;
 
     ///
-    /// @name UpdateExidence
+    /// @name GetIndex
     ///
     /// @description
-    /// 	Update the exidence value of this patch.
+    /// 	Accessor for the position of this patch in the scene's patch
+    ///     vector.
     ///
-    void UpdateExidence();
+    /// @return - the index of this patch
+    ///
+    unsigned int GetIndex() const;
 
-    /// @name UpdateCornerColors
+    ///
+    /// @name SetIndex
     ///
     /// @description
-    /// 	Update the vertex colors for this patch
+    /// 	Record the position of this patch in the scene's patch vector.
     ///
-    void UpdateCornerColors();
-
-    void Draw();
-    void DrawOutline();
-    void DrawNormal();
-
-    // Accessors
-    const Vector& GetNormal() const;
-    const Point& GetCenter() const;
+    /// @param index - the index of this patch
+    ///
+    void SetIndex(unsigned int index);
 
-    const Point* GetA() const;
+    ///
+    /// @name GetParent
+    ///
+    /// @description
+    /// 	Accessor for the quad this patch was cut from.
+    ///
+    /// @return - the index of the quad in the scene's quad vector, or -1
+    ///           if the patch did not come from a quad
+    ///
+    int GetParent() const;
 
-    std::vector<Patch*> *GetViewablePatches() const;
-    std::vector<float> *GetFormFactors() const;
+    ///
+    /// @name SetParent
+    ///
+    /// @description
+    /// 	Record the quad this patch was cut from.
+    ///
+    /// @param parent - the index of the quad
+    ///
+    void SetParent(int parent);
 
     bool Contains(Point p) const;
 
     bool IsFacing(const Patch *other) const;
 
+    ///
+    /// @name PointFormFactor
+    ///
+    /// @description
+    /// 	Form factor from a differential area to this patch, in closed
+    ///     form: the sum over the edges of the angle each edge subtends,
+    ///     weighted by how much the plane through the edge faces the area.
+    ///     Assumes nothing lies between them and the whole patch is on
+    ///     the front side of the area.
+    ///
+    /// @param point - position of the differential area
+    /// @param normal - unit normal of the differential area
+    /// @return - the form factor
+    ///
+    float PointFormFactor(const Point &point, const Vector &normal) const;
+
 private:
 
-    Point *mA;
-    Point *mB;
-    Point *mC;
-    Point *mD;
+    const Mesh *mMesh;
+
+    ///
+    /// @name mCorners
+    ///
+    /// @description
+    ///		Indices of corners A to D in the mesh.
+    ///
+    uint32_t mCorners[4];
 
     Color mColor;
 
@@ -152,17 +212,18 @@ private:
 
     static int mNumPatches;
 
+    unsigned int mIndex;
+
+    int mParent;
+
     static Radiosity::FormFactorMap formFactorMap;
 
     float mArea;
 
     float mReflectance;
     Color mEmission;
-    Color mIncidence;
-    Color mExidence;
 
-    std::vector<Patch*> *mViewablePatches;
-    std::vector<float> *mFormFactors;
+    const PatchStore *mStore;
 
 };  // class Patch
 
@@ -176,19 +237,79 @@ inline const Point& Patch::GetCenter() const
     return mCenterPoint;
 }
 
+inline float Patch::GetArea() const
+{
+    return mArea;
+}
+
+inline const Color& Patch::GetColor() const
+{
+    return mColor;
+}
+
+inline const Color& Patch::GetEmission() const
+{
+    return mEmission;
+}
+
+inline float Patch::GetReflectance() const
+{
+    return mReflectance;
+}
+
+inline void Patch::SetStore(const PatchStore *store)
+{
+    mStore = store;
+}
+
 inline const Point* Patch::GetA() const
 {
-    return mA;
+    return &mMesh->GetVertex(mCorners[0]);
+}
+
+inline const Point* Patch::GetB() const
+{
+    return &mMesh->GetVertex(mCorners[1]);
+}
+
+inline const Point* Patch::GetC() const
+{
+    return &mMesh->GetVertex(mCorners[2]);
+}
+
+inline const Point* Patch::GetD() const
+{
+    return &mMesh->GetVertex(mCorners[3]);
+}
+
+inline const uint32_t* Patch::GetCorners() const
+{
+    return mCorners;
+}
+
+inline const Mesh* Patch::GetMesh() const
+{
+    return mMesh;
+}
+
+inline unsigned int Patch::GetIndex() const
+{
+    return mIndex;
+}
+
+inline void Patch::SetIndex(unsigned int index)
+{
+    mIndex = index;
 }
 
-inline std::vector<Patch*> *Patch::GetViewablePatches() const
+inline int Patch::GetParent() const
 {
-    return mViewablePatches;
+    return mParent;
 }
 
-inline std::vector<float> *Patch::GetFormFactors() const
+inline void Patch::SetParent(int parent)
 {
-    return mFormFactors;
+    mParent = parent;
 }
 
 }   // namespace Radiosity
@@ -53,16 +53,16 @@ public:
     /// @name Intersect
     ///
     /// @description
-    /// 	Determines if a ray intersects the rectangle.
+    /// 	Determines if a ray intersects the rectangle. To test a ray
+    ///     against many rectangles, see RectangleBatch.
     ///
     /// @param v - direction vector of the ray
     /// @param o - origin of the ray
-    /// @return - intersection point closest to ray origin, nullptr if no
-    ///           intersection occurs
+    /// @param limit - only hits closer than this count
+    /// @return - the hit, with u running from C to B and v from C to D,
+    ///           or a miss
     ///
-    Point* Intersect(Vector v, Point o);
-
-    void Subdivide(float patchSize);
+    Hit Intersect(const Vector &v, const Point &o, float limit) const;
 
     ///
     /// @name A
@@ -104,6 +104,16 @@ public:
     ///
     Point D() const;
 
+    ///
+    /// @name Normal
+    ///
+    /// @description
+    /// 	Accessor for _normal member variable.
+    ///
+    /// @return - vector normal to the ABCD rectangle, not normalized
+    ///
+    Vector Normal() const;
+
     float emission;
 
 private:
@@ -148,8 +158,6 @@ private:
     ///
     Vector _normal;
 
-    std::vector<Patch*> *mPatches;
-
 };  // class Rectangle
 
 }   // namespace Radiosity
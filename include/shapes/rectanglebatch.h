@@ -0,0 +1,114 @@
+///
+/// @file RectangleBatch.h
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Rectangles stored contiguously, one array per coordinate, so that a
+///     ray can be tested against all of them in one tight loop.
+///
+
+#ifndef RECTANGLE_BATCH_H
+#define RECTANGLE_BATCH_H
+
+#include "rectangle.h"
+#include "hit.h"
+
+#include <vector>
+
+namespace Radiosity
+{
+
+class RectangleBatch
+{
+public:
+
+    ///
+    /// @name RectangleBatch
+    ///
+    /// @description
+    /// 	Constructor. Copies the geometry of the rectangles; later
+    ///     changes to them are not seen.
+    ///
+    /// @param rectangles - the rectangles, identified by their index
+    ///
+    explicit RectangleBatch(const std::vector<Rectangle*> *rectangles);
+
+    ///
+    /// @name ~RectangleBatch
+    ///
+    /// @description
+    /// 	Destructor
+    ///
+    ~RectangleBatch();
+
+    ///
+    /// @name Intersect
+    ///
+    /// @description
+    /// 	Finds the nearest rectangle in front of the ray origin.
+    ///
+    /// @param v - direction vector of the ray
+    /// @param o - origin of the ray
+    /// @param limit - only hits closer than this count
+    /// @param skip - index of a rectangle to leave out, or -1
+    /// @return - the nearest hit, with the index of the rectangle, or a
+    ///           miss
+    ///
+    Hit Intersect(const Vector &v, const Point &o, float limit,
+                  int skip) const;
+
+    ///
+    /// @name Size
+    ///
+    /// @description
+    /// 	Accessor for the number of rectangles.
+    ///
+    /// @return - the number of rectangles
+    ///
+    unsigned int Size() const;
+
+private:
+
+    ///
+    /// @name mPlane
+    ///
+    /// @description
+    ///		Corner A of each rectangle, which anchors its plane.
+    ///
+    std::vector<float> mPlane[3];
+
+    ///
+    /// @name mCorner
+    ///
+    /// @description
+    ///		Corner C of each rectangle, which the edges start from.
+    ///
+    std::vector<float> mCorner[3];
+
+    ///
+    /// @name mEdge1, mEdge2
+    ///
+    /// @description
+    ///		Edges CB and CD of each rectangle, with their squared lengths.
+    ///     The arithmetic follows Rectangle::Intersect step for step, so
+    ///     both give the same hits.
+    ///
+    std::vector<float> mEdge1[3];
+    std::vector<float> mEdge2[3];
+    std::vector<float> mLength1;
+    std::vector<float> mLength2;
+
+    std::vector<float> mNormal[3];
+
+};  // class RectangleBatch
+
+inline unsigned int RectangleBatch::Size() const
+{
+    return mCorner[0].size();
+}
+
+}   // namespace Radiosity
+
+#endif
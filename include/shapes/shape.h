@@ -14,6 +14,7 @@
 #include "point.h"
 #include "color.h"
 #include "vector.h"
+#include "hit.h"
 
 #include <cstdlib>
 
@@ -59,14 +60,18 @@ public:
     /// @name Intersect
     ///
     /// @description
-    /// 	Determines if a ray intersects the shape.
+    /// 	Determines if a ray intersects the shape. Hits at or beyond the
+    ///     limit are rejected before testing whether they fall inside the
+    ///     shape.
     ///
     /// @param v - direction vector of the ray
     /// @param o - origin of the ray
-    /// @return - intersection point closest to ray origin, nullptr if no
-    ///           intersection occurs
+    /// @param limit - only hits closer than this count
+    /// @return - the hit closest to the ray origin, or a miss if there is
+    ///           none in front of the origin and closer than the limit
     ///
-    virtual Point* Intersect(Vector v, Point o) = 0;
+    virtual Hit Intersect(const Vector &v, const Point &o,
+                          float limit) const = 0;
 
 private:
 
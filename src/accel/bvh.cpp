@@ -0,0 +1,809 @@
+///
+/// @file Bvh.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Bounding volume hierarchy over the patches of a scene, used to find
+///     the nearest patch along a ray in logarithmic time.
+///
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Patches per leaf below which a node is never split
+#define BVH_MIN_SPLIT 2
+
+// Largest leaf the builder will create, one packet of patches
+#define BVH_MAX_LEAF PACKET_WIDTH
+
+// Number of bins used to evaluate the surface area heuristic
+#define BVH_BINS 16
+
+// Cost of visiting an interior node relative to testing one patch
+#define BVH_TRAVERSAL_COST 1.0f
+
+// Cost of testing a packet of patches relative to testing one patch; the
+// patches of a leaf are tested together, so up to a packet costs the same
+#define BVH_PACKET_COST 2.0f
+
+// Deepest node the builder creates; past this budget it splits at the
+// median, whose subtrees are balanced
+#define BVH_MAX_DEPTH 48
+
+// Depth of the traversal stack. Each level leaves at most one sibling
+// waiting, so the stack needs one entry more than the tree has levels.
+#define BVH_STACK_SIZE 64
+
+static_assert(BVH_MAX_DEPTH < BVH_STACK_SIZE,
+              "the traversal stack must hold the deepest tree");
+static_assert(BVH_MAX_LEAF <= 0xFFFF, "leaf counts are stored in 16 bits");
+
+// Slack given to frustum tests, as a fraction of the size of the scene
+#define BVH_FRUSTUM_MARGIN 1e-6f
+
+// Most vertices a patch can have once clipped by the planes of a frustum
+#define BVH_CLIP_VERTICES 9
+
+// Rays cast by ValidateKernel, each against every patch
+#define BVH_VALIDATE_RAYS 4096
+
+namespace Radiosity
+{
+
+Bvh::Bounds::Bounds()
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mMin[axis] = std::numeric_limits<float>::max();
+        mMax[axis] = -std::numeric_limits<float>::max();
+    }
+}
+
+void Bvh::Bounds::Grow(const Bounds &other)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mMin[axis] = std::min(mMin[axis], other.mMin[axis]);
+        mMax[axis] = std::max(mMax[axis], other.mMax[axis]);
+    }
+}
+
+void Bvh::Bounds::Grow(const float p[3])
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mMin[axis] = std::min(mMin[axis], p[axis]);
+        mMax[axis] = std::max(mMax[axis], p[axis]);
+    }
+}
+
+float Bvh::Bounds::Area() const
+{
+    float dx = mMax[0] - mMin[0];
+    float dy = mMax[1] - mMin[1];
+    float dz = mMax[2] - mMin[2];
+
+    if ((dx < 0) || (dy < 0) || (dz < 0))
+    {
+        return 0;
+    }
+
+    return 2 * (dx * dy + dy * dz + dz * dx);
+}
+
+void Frustum::Set(const Point &origin, const Vector corners[4])
+{
+    mOrigin[0] = origin.X();
+    mOrigin[1] = origin.Y();
+    mOrigin[2] = origin.Z();
+
+    Vector center = add(add(corners[0], corners[1]),
+                        add(corners[2], corners[3]));
+
+    for (int side = 0; side < 4; ++side)
+    {
+        Vector normal = crossProduct(corners[side], corners[(side + 1) % 4]);
+        float length = std::sqrt(dotProduct(normal, normal));
+        float scale = 0;
+
+        if (length > 0)
+        {
+            scale = (dotProduct(normal, center) < 0) ? -1 / length :
+                                                       1 / length;
+        }
+
+        float *plane = mPlanes[side];
+
+        plane[0] = normal.X() * scale;
+        plane[1] = normal.Y() * scale;
+        plane[2] = normal.Z() * scale;
+        plane[3] = -(plane[0] * mOrigin[0] + plane[1] * mOrigin[1] +
+                     plane[2] * mOrigin[2]);
+    }
+
+    mCount = 4;
+}
+
+void Frustum::SetFar(const Point &point, const Vector &normal)
+{
+    float length = std::sqrt(dotProduct(normal, normal));
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    float *plane = mPlanes[4];
+
+    plane[0] = normal.X() / length;
+    plane[1] = normal.Y() / length;
+    plane[2] = normal.Z() / length;
+    plane[3] = -(plane[0] * point.X() + plane[1] * point.Y() +
+                 plane[2] * point.Z());
+
+    // Keep the side of the origin
+    if (plane[0] * mOrigin[0] + plane[1] * mOrigin[1] +
+        plane[2] * mOrigin[2] + plane[3] < 0)
+    {
+        for (int term = 0; term < 4; ++term)
+        {
+            plane[term] = -plane[term];
+        }
+    }
+
+    mCount = 5;
+}
+
+Bvh::Bvh(const std::vector<Patch*> *patches):
+    mPatches(patches),
+    mMargin(0)
+{
+    unsigned int count = patches->size();
+
+    std::vector<Bounds> bounds(count);
+    std::vector<float> centroids(3 * count);
+
+    for (unsigned int index = 0; index < count; ++index)
+    {
+        const Patch *patch = patches->at(index);
+        const Point *corners[4] =
+            { patch->GetA(), patch->GetB(), patch->GetC(), patch->GetD() };
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            float p[3] = { corners[corner]->X(),
+                           corners[corner]->Y(),
+                           corners[corner]->Z() };
+            bounds.at(index).Grow(p);
+        }
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centroids.at(3 * index + axis) =
+                0.5f * (bounds.at(index).mMin[axis] +
+                        bounds.at(index).mMax[axis]);
+        }
+
+        mPrimitives.push_back(index);
+    }
+
+    if (count > 0)
+    {
+        // A binary tree has fewer than twice as many nodes as leaves.
+        mNodes.reserve(2 * count);
+        Build(0, count, 0, bounds, centroids);
+
+        const Node &root = mNodes.front();
+        float diagonal = 0;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = root.mMax[axis] - root.mMin[axis];
+            diagonal += extent * extent;
+        }
+
+        mMargin = BVH_FRUSTUM_MARGIN * std::sqrt(diagonal);
+    }
+
+    mBounds.swap(bounds);
+
+    mPacket.Reset(patches, mPrimitives);
+}
+
+Bvh::~Bvh()
+{
+}
+
+unsigned int Bvh::NodeCount() const
+{
+    return mNodes.size();
+}
+
+void Bvh::SetKernel(PatchPacket::Kernel kernel)
+{
+    mPacket.SetKernel(kernel);
+}
+
+PatchPacket::Kernel Bvh::GetKernel() const
+{
+    return mPacket.GetKernel();
+}
+
+std::size_t Bvh::ValidateKernel(std::size_t &tested) const
+{
+    std::size_t differ = 0;
+    unsigned int count = mPrimitives.size();
+
+    tested = 0;
+
+    if (count < 2)
+    {
+        return 0;
+    }
+
+    // Step through the pairs of patches with strides coprime to most
+    // counts, aiming at corners as well as centers so that rays graze
+    // the edges the kernels must agree on
+    for (unsigned int ray = 0; ray < BVH_VALIDATE_RAYS; ++ray)
+    {
+        const Patch *from = mPatches->at((ray * 7919u) % count);
+        const Patch *to = mPatches->at((ray * 104729u + 1) % count);
+
+        if (from == to)
+        {
+            continue;
+        }
+
+        const Point *corners[5] = { &to->GetCenter(), to->GetA(),
+                                    to->GetB(), to->GetC(), to->GetD() };
+        const Point &target = *corners[ray % 5];
+
+        Vector v(target, from->GetCenter());
+        normalize(v);
+
+        const Point &o = from->GetCenter();
+        const float origin[3] = { o.X(), o.Y(), o.Z() };
+        const float direction[3] = { v.X(), v.Y(), v.Z() };
+
+        for (unsigned int first = 0; first < count; first += PACKET_WIDTH)
+        {
+            float distances[PACKET_WIDTH];
+            mPacket.Intersect(origin, direction, first, distances);
+
+            unsigned int last = std::min(first + PACKET_WIDTH, count);
+
+            for (unsigned int index = first; index < last; ++index)
+            {
+                float expected =
+                    mPatches->at(mPrimitives[index])->Intersect(v, o);
+
+                if (std::memcmp(&expected, &distances[index - first],
+                                sizeof(float)) != 0)
+                {
+                    ++differ;
+                }
+
+                ++tested;
+            }
+        }
+    }
+
+    return differ;
+}
+
+void Bvh::Build(unsigned int begin, unsigned int end, unsigned int depth,
+                const std::vector<Bounds> &bounds,
+                const std::vector<float> &centroids)
+{
+    unsigned int node_index = mNodes.size();
+    mNodes.push_back(Node());
+
+    // Bound the primitives and their centroids
+    Bounds node_bounds;
+    Bounds centroid_bounds;
+
+    for (unsigned int index = begin; index < end; ++index)
+    {
+        uint32_t primitive = mPrimitives.at(index);
+        node_bounds.Grow(bounds.at(primitive));
+        centroid_bounds.Grow(&centroids.at(3 * primitive));
+    }
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mNodes.at(node_index).mMin[axis] = node_bounds.mMin[axis];
+        mNodes.at(node_index).mMax[axis] = node_bounds.mMax[axis];
+    }
+
+    unsigned int count = end - begin;
+
+    // Levels a median split would still need to bring every leaf down to
+    // a packet
+    unsigned int levels = 0;
+
+    for (unsigned int leaves = (count + BVH_MAX_LEAF - 1) / BVH_MAX_LEAF;
+         leaves > 1; leaves = (leaves + 1) / 2)
+    {
+        ++levels;
+    }
+
+    bool median = (depth + levels >= BVH_MAX_DEPTH);
+
+    // Find the cheapest split according to the surface area heuristic,
+    // evaluated at the boundaries of equally sized centroid bins.
+    int best_axis = -1;
+    int best_bin = 0;
+    float best_cost = std::numeric_limits<float>::max();
+
+    if ((count >= BVH_MIN_SPLIT) && !median)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = centroid_bounds.mMax[axis] -
+                           centroid_bounds.mMin[axis];
+
+            if (extent <= 0)
+            {
+                continue;
+            }
+
+            Bounds bin_bounds[BVH_BINS];
+            unsigned int bin_counts[BVH_BINS] = { 0 };
+            float scale = BVH_BINS / extent;
+
+            for (unsigned int index = begin; index < end; ++index)
+            {
+                uint32_t primitive = mPrimitives.at(index);
+                int bin = int((centroids.at(3 * primitive + axis) -
+                               centroid_bounds.mMin[axis]) * scale);
+                bin = std::min(bin, BVH_BINS - 1);
+
+                bin_bounds[bin].Grow(bounds.at(primitive));
+                ++bin_counts[bin];
+            }
+
+            // Sweep from the right to record the cost of every suffix
+            float right_area[BVH_BINS];
+            unsigned int right_count[BVH_BINS];
+            Bounds accumulated;
+            unsigned int accumulated_count = 0;
+
+            for (int bin = BVH_BINS - 1; bin > 0; --bin)
+            {
+                accumulated.Grow(bin_bounds[bin]);
+                accumulated_count += bin_counts[bin];
+                right_area[bin] = accumulated.Area();
+                right_count[bin] = accumulated_count;
+            }
+
+            // Sweep from the left, combining with the suffixes
+            accumulated = Bounds();
+            accumulated_count = 0;
+
+            for (int bin = 0; bin < BVH_BINS - 1; ++bin)
+            {
+                accumulated.Grow(bin_bounds[bin]);
+                accumulated_count += bin_counts[bin];
+
+                if ((accumulated_count == 0) || (right_count[bin + 1] == 0))
+                {
+                    continue;
+                }
+
+                float cost = accumulated_count * accumulated.Area() +
+                             right_count[bin + 1] * right_area[bin + 1];
+
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = bin;
+                }
+            }
+        }
+    }
+
+    // Compare the split against testing every primitive in a leaf
+    float area = node_bounds.Area();
+    float leaf_cost = BVH_PACKET_COST *
+                      ((count + PACKET_WIDTH - 1) / PACKET_WIDTH);
+
+    if (area > 0)
+    {
+        best_cost = BVH_TRAVERSAL_COST + best_cost / area;
+    }
+
+    if ((count <= BVH_MAX_LEAF) &&
+        ((best_axis < 0) || (leaf_cost <= best_cost)))
+    {
+        mNodes.at(node_index).mOffset = begin;
+        mNodes.at(node_index).mCount = count;
+        mNodes.at(node_index).mAxis = 0;
+        return;
+    }
+
+    unsigned int split;
+
+    if (best_axis >= 0)
+    {
+        // Partition the primitives about the chosen bin boundary
+        float extent = centroid_bounds.mMax[best_axis] -
+                       centroid_bounds.mMin[best_axis];
+        float scale = BVH_BINS / extent;
+        float minimum = centroid_bounds.mMin[best_axis];
+
+        std::vector<uint32_t>::iterator middle = std::partition(
+            mPrimitives.begin() + begin,
+            mPrimitives.begin() + end,
+            [&](uint32_t primitive)
+            {
+                int bin = int((centroids.at(3 * primitive + best_axis) -
+                               minimum) * scale);
+                return std::min(bin, BVH_BINS - 1) <= best_bin;
+            });
+
+        split = middle - mPrimitives.begin();
+    }
+    else
+    {
+        // Halve the primitives along the widest spread of centroids. When
+        // the centroids all coincide any halving will do.
+        best_axis = 0;
+
+        for (int axis = 1; axis < 3; ++axis)
+        {
+            if (centroid_bounds.mMax[axis] - centroid_bounds.mMin[axis] >
+                centroid_bounds.mMax[best_axis] -
+                centroid_bounds.mMin[best_axis])
+            {
+                best_axis = axis;
+            }
+        }
+
+        split = begin + count / 2;
+
+        std::nth_element(
+            mPrimitives.begin() + begin,
+            mPrimitives.begin() + split,
+            mPrimitives.begin() + end,
+            [&](uint32_t first, uint32_t second)
+            {
+                return centroids.at(3 * first + best_axis) <
+                       centroids.at(3 * second + best_axis);
+            });
+    }
+
+    Build(begin, split, depth + 1, bounds, centroids);
+
+    mNodes.at(node_index).mOffset = mNodes.size();
+    mNodes.at(node_index).mCount = 0;
+    mNodes.at(node_index).mAxis = best_axis;
+
+    Build(split, end, depth + 1, bounds, centroids);
+}
+
+int Bvh::Intersect(const Vector &v, const Point &o, int ignore,
+                   float &distance) const
+{
+    if (mNodes.empty())
+    {
+        return -1;
+    }
+
+    const float origin[3] = { o.X(), o.Y(), o.Z() };
+    const float direction[3] = { v.X(), v.Y(), v.Z() };
+    float inverse[3];
+    int negative[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        inverse[axis] = 1.0f / direction[axis];
+        negative[axis] = direction[axis] < 0;
+    }
+
+    int nearest = -1;
+    float nearest_distance = std::numeric_limits<float>::max();
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = mNodes[stack[--top]];
+
+        // Slab test against the node bounds, clipped to the nearest hit
+        float t_near = 0;
+        float t_far = nearest_distance;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t1 = (node.mMin[axis] - origin[axis]) * inverse[axis];
+            float t2 = (node.mMax[axis] - origin[axis]) * inverse[axis];
+
+            t_near = std::max(t_near, std::min(t1, t2));
+            t_far = std::min(t_far, std::max(t1, t2));
+        }
+
+        if (t_near > t_far)
+        {
+            continue;
+        }
+
+        if (node.mCount > 0)
+        {
+            // Leaves only outgrow a packet when their patches cannot be
+            // split apart
+            for (uint32_t first = node.mOffset;
+                 first < node.mOffset + node.mCount; first += PACKET_WIDTH)
+            {
+                float distances[PACKET_WIDTH];
+                mPacket.Intersect(origin, direction, first, distances);
+
+                uint32_t last = std::min(first + PACKET_WIDTH,
+                                         node.mOffset + node.mCount);
+
+                for (uint32_t index = first; index < last; ++index)
+                {
+                    uint32_t primitive = mPrimitives[index];
+                    float t = distances[index - first];
+
+                    if ((int(primitive) != ignore) && (t > 0) &&
+                        (t < nearest_distance))
+                    {
+                        nearest_distance = t;
+                        nearest = primitive;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // Visit the child on the near side of the split first, so the
+            // far child can be rejected against a closer hit.
+            uint32_t first = uint32_t(&node - &mNodes[0]) + 1;
+            uint32_t second = node.mOffset;
+
+            if (negative[node.mAxis])
+            {
+                std::swap(first, second);
+            }
+
+            assert(top + 2 <= BVH_STACK_SIZE);
+            stack[top++] = second;
+            stack[top++] = first;
+        }
+    }
+
+    distance = nearest_distance;
+    return nearest;
+}
+
+bool Bvh::Occluded(const Vector &v, const Point &o, float distance,
+                   int ignore1, int ignore2) const
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    const float origin[3] = { o.X(), o.Y(), o.Z() };
+    const float direction[3] = { v.X(), v.Y(), v.Z() };
+    float inverse[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        inverse[axis] = 1.0f / direction[axis];
+    }
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = mNodes[stack[--top]];
+
+        // Slab test against the node bounds, clipped to the distance
+        float t_near = 0;
+        float t_far = distance;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t1 = (node.mMin[axis] - origin[axis]) * inverse[axis];
+            float t2 = (node.mMax[axis] - origin[axis]) * inverse[axis];
+
+            t_near = std::max(t_near, std::min(t1, t2));
+            t_far = std::min(t_far, std::max(t1, t2));
+        }
+
+        if (t_near > t_far)
+        {
+            continue;
+        }
+
+        if (node.mCount > 0)
+        {
+            for (uint32_t first = node.mOffset;
+                 first < node.mOffset + node.mCount; first += PACKET_WIDTH)
+            {
+                float distances[PACKET_WIDTH];
+                mPacket.Intersect(origin, direction, first, distances);
+
+                uint32_t last = std::min(first + PACKET_WIDTH,
+                                         node.mOffset + node.mCount);
+
+                for (uint32_t index = first; index < last; ++index)
+                {
+                    int primitive = mPrimitives[index];
+                    float t = distances[index - first];
+
+                    // Any hit will do
+                    if ((primitive != ignore1) && (primitive != ignore2) &&
+                        (t > 0) && (t < distance))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            assert(top + 2 <= BVH_STACK_SIZE);
+            stack[top++] = node.mOffset;
+            stack[top++] = uint32_t(&node - &mNodes[0]) + 1;
+        }
+    }
+
+    return false;
+}
+
+bool Bvh::Occupied(const Frustum &frustum, int ignore1, int ignore2) const
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = mNodes[stack[--top]];
+
+        if (Outside(node.mMin, node.mMax, frustum))
+        {
+            continue;
+        }
+
+        if (node.mCount > 0)
+        {
+            for (uint32_t index = node.mOffset;
+                 index < node.mOffset + node.mCount; ++index)
+            {
+                int primitive = mPrimitives[index];
+
+                if ((primitive == ignore1) || (primitive == ignore2))
+                {
+                    continue;
+                }
+
+                const Bounds &bounds = mBounds[primitive];
+
+                if (!Outside(bounds.mMin, bounds.mMax, frustum) &&
+                    !Outside(mPatches->at(primitive), frustum))
+                {
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            assert(top + 2 <= BVH_STACK_SIZE);
+            stack[top++] = node.mOffset;
+            stack[top++] = uint32_t(&node - &mNodes[0]) + 1;
+        }
+    }
+
+    return false;
+}
+
+bool Bvh::Outside(const float min[3], const float max[3],
+                  const Frustum &frustum) const
+{
+    for (unsigned int side = 0; side < frustum.mCount; ++side)
+    {
+        const float *plane = frustum.mPlanes[side];
+
+        // The corner of the box furthest along the plane normal
+        float along = plane[3];
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            along += plane[axis] * ((plane[axis] >= 0) ? max[axis] :
+                                                         min[axis]);
+        }
+
+        if (along < -mMargin)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Bvh::Outside(const Patch *patch, const Frustum &frustum) const
+{
+    const Point *corners[4] =
+        { patch->GetA(), patch->GetB(), patch->GetC(), patch->GetD() };
+
+    float polygon[2][BVH_CLIP_VERTICES][3];
+    int count = 4;
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        polygon[0][corner][0] = corners[corner]->X();
+        polygon[0][corner][1] = corners[corner]->Y();
+        polygon[0][corner][2] = corners[corner]->Z();
+    }
+
+    // Clip the patch by each plane in turn; it is outside if nothing
+    // remains
+    for (unsigned int side = 0; side < frustum.mCount; ++side)
+    {
+        const float *plane = frustum.mPlanes[side];
+        float (*in)[3] = polygon[side % 2];
+        float (*out)[3] = polygon[(side + 1) % 2];
+        int kept = 0;
+
+        for (int vertex = 0; vertex < count; ++vertex)
+        {
+            const float *current = in[vertex];
+            const float *next = in[(vertex + 1) % count];
+
+            float d_current = plane[0] * current[0] + plane[1] * current[1] +
+                              plane[2] * current[2] + plane[3] + mMargin;
+            float d_next = plane[0] * next[0] + plane[1] * next[1] +
+                           plane[2] * next[2] + plane[3] + mMargin;
+
+            if (d_current >= 0)
+            {
+                std::copy(current, current + 3, out[kept++]);
+            }
+
+            if ((d_current >= 0) != (d_next >= 0))
+            {
+                float fraction = d_current / (d_current - d_next);
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    out[kept][axis] = current[axis] +
+                                      (next[axis] - current[axis]) * fraction;
+                }
+
+                ++kept;
+            }
+        }
+
+        if (kept == 0)
+        {
+            return true;
+        }
+
+        count = kept;
+    }
+
+    return false;
+}
+
+}   // namespace Radiosity
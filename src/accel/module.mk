@@ -0,0 +1,2 @@
+SOURCE += bvh.cpp
+SOURCE += patchpacket.cpp
@@ -0,0 +1,352 @@
+///
+/// @file PatchPacket.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Patches laid out as structure-of-arrays floats, for intersecting
+///     a ray with up to eight patches at once using SSE or AVX2 when the
+///     processor supports them.
+///
+
+#include "patchpacket.h"
+
+// The vector kernels are compiled for their instruction sets function by
+// function, so the rest of the program still runs on any processor.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PACKET_SIMD
+#include <immintrin.h>
+#endif
+
+namespace Radiosity
+{
+
+namespace
+{
+
+// Each kernel repeats the arithmetic of Patch::Intersect operation for
+// operation, so that all of them give the same distances.
+
+float ScalarDistance(const float o[3], const float v[3],
+                     const float p[PatchPacket::FIELD_COUNT])
+{
+    float facing = v[0] * p[PatchPacket::NORMAL_X] +
+                   v[1] * p[PatchPacket::NORMAL_Y] +
+                   v[2] * p[PatchPacket::NORMAL_Z];
+
+    // Check if vector is parallel to plane (no intercept)
+    if (facing == 0)
+    {
+        return -1;
+    }
+
+    float distance = ((p[PatchPacket::A_X] - o[0]) * p[PatchPacket::NORMAL_X] +
+                      (p[PatchPacket::A_Y] - o[1]) * p[PatchPacket::NORMAL_Y] +
+                      (p[PatchPacket::A_Z] - o[2]) * p[PatchPacket::NORMAL_Z]) /
+                     facing;
+
+    // Position of the intersect point relative to corner C
+    float ci[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        ci[axis] = (o[axis] + v[axis] * distance) - p[PatchPacket::C_X + axis];
+    }
+
+    float along_bc = ci[0] * p[PatchPacket::BC_X] +
+                     ci[1] * p[PatchPacket::BC_Y] +
+                     ci[2] * p[PatchPacket::BC_Z];
+    float along_cd = ci[0] * p[PatchPacket::CD_X] +
+                     ci[1] * p[PatchPacket::CD_Y] +
+                     ci[2] * p[PatchPacket::CD_Z];
+
+    if ((0 <= along_bc) && (along_bc < p[PatchPacket::BC_LENGTH]) &&
+        (0 <= along_cd) && (along_cd < p[PatchPacket::CD_LENGTH]))
+    {
+        return distance;
+    }
+
+    return 0;
+}
+
+#ifdef PACKET_SIMD
+
+__attribute__((target("sse2")))
+inline __m128 SseDistances(const __m128 o[3], const __m128 v[3],
+                           const __m128 p[PatchPacket::FIELD_COUNT])
+{
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 facing = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(v[0], p[PatchPacket::NORMAL_X]),
+                   _mm_mul_ps(v[1], p[PatchPacket::NORMAL_Y])),
+        _mm_mul_ps(v[2], p[PatchPacket::NORMAL_Z]));
+
+    __m128 distance = _mm_div_ps(
+        _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(_mm_sub_ps(p[PatchPacket::A_X], o[0]),
+                           p[PatchPacket::NORMAL_X]),
+                _mm_mul_ps(_mm_sub_ps(p[PatchPacket::A_Y], o[1]),
+                           p[PatchPacket::NORMAL_Y])),
+            _mm_mul_ps(_mm_sub_ps(p[PatchPacket::A_Z], o[2]),
+                       p[PatchPacket::NORMAL_Z])),
+        facing);
+
+    __m128 ci[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        ci[axis] = _mm_sub_ps(
+            _mm_add_ps(o[axis], _mm_mul_ps(v[axis], distance)),
+            p[PatchPacket::C_X + axis]);
+    }
+
+    __m128 along_bc = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ci[0], p[PatchPacket::BC_X]),
+                   _mm_mul_ps(ci[1], p[PatchPacket::BC_Y])),
+        _mm_mul_ps(ci[2], p[PatchPacket::BC_Z]));
+    __m128 along_cd = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ci[0], p[PatchPacket::CD_X]),
+                   _mm_mul_ps(ci[1], p[PatchPacket::CD_Y])),
+        _mm_mul_ps(ci[2], p[PatchPacket::CD_Z]));
+
+    __m128 inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(along_bc, zero),
+                   _mm_cmplt_ps(along_bc, p[PatchPacket::BC_LENGTH])),
+        _mm_and_ps(_mm_cmpge_ps(along_cd, zero),
+                   _mm_cmplt_ps(along_cd, p[PatchPacket::CD_LENGTH])));
+
+    // Outside the patch gives zero, parallel to its plane gives -1
+    __m128 parallel = _mm_cmpeq_ps(facing, zero);
+    __m128 result = _mm_and_ps(inside, distance);
+
+    return _mm_or_ps(_mm_and_ps(parallel, _mm_set1_ps(-1)),
+                     _mm_andnot_ps(parallel, result));
+}
+
+__attribute__((target("avx2")))
+inline __m256 Avx2Distances(const __m256 o[3], const __m256 v[3],
+                            const __m256 p[PatchPacket::FIELD_COUNT])
+{
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 facing = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(v[0], p[PatchPacket::NORMAL_X]),
+                      _mm256_mul_ps(v[1], p[PatchPacket::NORMAL_Y])),
+        _mm256_mul_ps(v[2], p[PatchPacket::NORMAL_Z]));
+
+    __m256 distance = _mm256_div_ps(
+        _mm256_add_ps(
+            _mm256_add_ps(
+                _mm256_mul_ps(_mm256_sub_ps(p[PatchPacket::A_X], o[0]),
+                              p[PatchPacket::NORMAL_X]),
+                _mm256_mul_ps(_mm256_sub_ps(p[PatchPacket::A_Y], o[1]),
+                              p[PatchPacket::NORMAL_Y])),
+            _mm256_mul_ps(_mm256_sub_ps(p[PatchPacket::A_Z], o[2]),
+                          p[PatchPacket::NORMAL_Z])),
+        facing);
+
+    __m256 ci[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        ci[axis] = _mm256_sub_ps(
+            _mm256_add_ps(o[axis], _mm256_mul_ps(v[axis], distance)),
+            p[PatchPacket::C_X + axis]);
+    }
+
+    __m256 along_bc = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ci[0], p[PatchPacket::BC_X]),
+                      _mm256_mul_ps(ci[1], p[PatchPacket::BC_Y])),
+        _mm256_mul_ps(ci[2], p[PatchPacket::BC_Z]));
+    __m256 along_cd = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ci[0], p[PatchPacket::CD_X]),
+                      _mm256_mul_ps(ci[1], p[PatchPacket::CD_Y])),
+        _mm256_mul_ps(ci[2], p[PatchPacket::CD_Z]));
+
+    __m256 inside = _mm256_and_ps(
+        _mm256_and_ps(
+            _mm256_cmp_ps(along_bc, zero, _CMP_GE_OQ),
+            _mm256_cmp_ps(along_bc, p[PatchPacket::BC_LENGTH], _CMP_LT_OQ)),
+        _mm256_and_ps(
+            _mm256_cmp_ps(along_cd, zero, _CMP_GE_OQ),
+            _mm256_cmp_ps(along_cd, p[PatchPacket::CD_LENGTH], _CMP_LT_OQ)));
+
+    // Outside the patch gives zero, parallel to its plane gives -1
+    __m256 parallel = _mm256_cmp_ps(facing, zero, _CMP_EQ_OQ);
+    __m256 result = _mm256_and_ps(inside, distance);
+
+    return _mm256_blendv_ps(result, _mm256_set1_ps(-1), parallel);
+}
+
+__attribute__((target("sse2")))
+void SseIntersect(const float origin[3], const float direction[3],
+                  const float *data, unsigned int stride,
+                  float distances[PACKET_WIDTH])
+{
+    __m128 o[3];
+    __m128 v[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        o[axis] = _mm_set1_ps(origin[axis]);
+        v[axis] = _mm_set1_ps(direction[axis]);
+    }
+
+    for (int half = 0; half < PACKET_WIDTH; half += 4)
+    {
+        __m128 p[PatchPacket::FIELD_COUNT];
+
+        for (int field = 0; field < PatchPacket::FIELD_COUNT; ++field)
+        {
+            p[field] = _mm_loadu_ps(data + field * stride + half);
+        }
+
+        _mm_storeu_ps(distances + half, SseDistances(o, v, p));
+    }
+}
+
+__attribute__((target("avx2")))
+void Avx2Intersect(const float origin[3], const float direction[3],
+                   const float *data, unsigned int stride,
+                   float distances[PACKET_WIDTH])
+{
+    __m256 o[3];
+    __m256 v[3];
+    __m256 p[PatchPacket::FIELD_COUNT];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        o[axis] = _mm256_set1_ps(origin[axis]);
+        v[axis] = _mm256_set1_ps(direction[axis]);
+    }
+
+    for (int field = 0; field < PatchPacket::FIELD_COUNT; ++field)
+    {
+        p[field] = _mm256_loadu_ps(data + field * stride);
+    }
+
+    _mm256_storeu_ps(distances, Avx2Distances(o, v, p));
+}
+
+#endif  // PACKET_SIMD
+
+}   // namespace
+
+PatchPacket::PatchPacket():
+    mSize(0),
+    mStride(PACKET_WIDTH),
+    mData(FIELD_COUNT * PACKET_WIDTH, 0),
+    mKernel(Supported())
+{
+}
+
+PatchPacket::~PatchPacket()
+{
+}
+
+void PatchPacket::Reset(const std::vector<Patch*> *patches,
+                        const std::vector<uint32_t> &order)
+{
+    mSize = order.size();
+    mStride = mSize + PACKET_WIDTH;
+    mData.assign(FIELD_COUNT * mStride, 0);
+
+    for (unsigned int position = 0; position < mSize; ++position)
+    {
+        const Patch *patch = patches->at(order[position]);
+
+        Vector bc(*patch->GetB(), *patch->GetC());
+        Vector cd(*patch->GetD(), *patch->GetC());
+        const Vector &normal = patch->GetNormal();
+
+        const float values[FIELD_COUNT] =
+        {
+            patch->GetA()->X(), patch->GetA()->Y(), patch->GetA()->Z(),
+            patch->GetC()->X(), patch->GetC()->Y(), patch->GetC()->Z(),
+            bc.X(), bc.Y(), bc.Z(),
+            cd.X(), cd.Y(), cd.Z(),
+            normal.X(), normal.Y(), normal.Z(),
+            dotProduct(bc, bc),
+            dotProduct(cd, cd)
+        };
+
+        for (int field = 0; field < FIELD_COUNT; ++field)
+        {
+            mData[field * mStride + position] = values[field];
+        }
+    }
+}
+
+void PatchPacket::Intersect(const float origin[3], const float direction[3],
+                            unsigned int position,
+                            float distances[PACKET_WIDTH]) const
+{
+    const float *data = &mData[position];
+
+#ifdef PACKET_SIMD
+    if (mKernel == AVX2)
+    {
+        Avx2Intersect(origin, direction, data, mStride, distances);
+        return;
+    }
+
+    if (mKernel == SSE)
+    {
+        SseIntersect(origin, direction, data, mStride, distances);
+        return;
+    }
+#endif
+
+    for (int lane = 0; lane < PACKET_WIDTH; ++lane)
+    {
+        float p[FIELD_COUNT];
+
+        for (int field = 0; field < FIELD_COUNT; ++field)
+        {
+            p[field] = data[field * mStride + lane];
+        }
+
+        distances[lane] = ScalarDistance(origin, direction, p);
+    }
+}
+
+void PatchPacket::SetKernel(Kernel kernel)
+{
+    Kernel supported = Supported();
+    mKernel = (kernel <= supported) ? kernel : supported;
+}
+
+PatchPacket::Kernel PatchPacket::Supported()
+{
+#ifdef PACKET_SIMD
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SSE;
+    }
+#endif
+
+    return SCALAR;
+}
+
+const char* PatchPacket::KernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case AVX2:
+        return "AVX2";
+    case SSE:
+        return "SSE";
+    default:
+        return "scalar";
+    }
+}
+
+}   // namespace Radiosity
@@ -18,16 +18,14 @@ Point::Point(float x, float y, float z, Color c):
     x(x),
     y(y),
     z(z),
-    mColor(c),
-    mCount(1)
+    mColor(c)
 {
 }
 
 Point::Point(float x, float y, float z):
     x(x),
     y(y),
-    z(z),
-    mCount(1)
+    z(z)
 {
 }
 
@@ -35,16 +33,14 @@ Point::Point(const Point& other):
     x(other.x),
     y(other.y),
     z(other.z),
-    mColor(other.mColor),
-    mCount(other.mCount)
+    mColor(other.mColor)
 {
 }
 
 Point::Point():
     x(0),
     y(0),
-    z(0),
-    mCount(1)
+    z(0)
 {
 }
 
@@ -63,17 +59,4 @@ void Point::DrawNoColor()
     glVertex3f(x, y, z);
 }
 
-void Point::UpdateColor(const Color& color)
-{
-    float reciprocal = 1.0 / mCount;
-
-    if (!(color == Color()))
-    {
-        Color weighted_color = (mColor * mCount) + color;
-
-        mColor = weighted_color * reciprocal;
-        ++mCount;
-    }
-}
-
 }   // namespace Radiosity
@@ -14,15 +14,55 @@
 #include "hemicube.h"
 #include "multiplier.h"
 
+#include <algorithm>
+#include <limits>
+
+// Near clipping distance of the z-buffer, as a fraction of the distance
+// from the hemicube center to a face
+#define Z_BUFFER_NEAR 1e-3f
+
+// Largest number of vertices a quad can have after clipping to the near
+// plane
+#define MAX_CLIPPED_VERTICES 8
+
+// Side of the square tiles of cells traced together
+#define HEMICUBE_TILE 8
+
+// How far inside a patch, as a fraction of its sides, the corner rays of a
+// tile must land for the whole tile to be credited to it
+#define TILE_INTERIOR 1e-3f
+
+// Marks a cell whose ray has not been traced yet
+#define UNTRACED -2
+
 namespace Radiosity
 {
 
-Hemicube::Hemicube(int subdivisions, std::vector<Rectangle*> *quads) :
-    mSubdivisions(subdivisions),
-    mShapes(quads)
+Hemicube::Hemicube(int subdivisions, std::vector<Rectangle*> *quads,
+                   const std::vector<Patch*> *patches, const Bvh *bvh,
+                   Backend backend) :
+    mSubdivisions(RoundResolution(subdivisions)),
+    mShapes(quads),
+    mQuadBatch(quads),
+    mPatches(patches),
+    mBvh(bvh),
+    mBackend(backend),
+    mViewable(nullptr),
+    mByQuad(false)
 {
     BuildMultipliers();
-    NormalizeMultipliers();
+}
+
+int Hemicube::RoundResolution(int subdivisions)
+{
+    // The side faces are half as tall as the front face is wide, so an
+    // odd resolution would leave a sliver of the hemisphere uncovered.
+    if (subdivisions < 2)
+    {
+        return 2;
+    }
+
+    return subdivisions + (subdivisions % 2);
 }
 
 Hemicube::~Hemicube()
@@ -34,8 +74,79 @@ Hemicube::~Hemicube()
     delete m_front_multiplier;
 }
 
-void Hemicube::TraceHemicube(Patch *patch)
+void Hemicube::TraceHemicube(Patch *patch,
+                             const std::vector<uint32_t> &viewable,
+                             std::vector<FormFactorMatrix::Entry> &row)
 {
+    mViewable = &viewable;
+    mFactors.assign(viewable.size(), 0);
+
+    // Record where each viewable patch sits in the viewable list, so that
+    // a patch found by index can be credited to the right form factor.
+    for (unsigned int slot = 0; slot < viewable.size(); ++slot)
+    {
+        unsigned int index = viewable[slot];
+
+        if (index >= mSlots.size())
+        {
+            mSlots.resize(index + 1, -1);
+        }
+
+        mSlots.at(index) = slot;
+    }
+
+    // Without a hierarchy, group the viewable patches by the quad they
+    // were cut from
+    if ((mBvh == nullptr) && (mBackend == RAY_CAST))
+    {
+        mQuadSlots.resize(mShapes->size());
+        mByQuad = (patch->GetParent() >= 0);
+
+        for (unsigned int slot = 0; slot < viewable.size(); ++slot)
+        {
+            int parent = mPatches->at(viewable[slot])->GetParent();
+
+            if (parent < 0)
+            {
+                mByQuad = false;
+                break;
+            }
+
+            mQuadSlots.at(parent).push_back(slot);
+        }
+    }
+
+    // Only patches reaching above the plane of this patch can show up on
+    // any face of the hemicube.
+    if (mBackend == Z_BUFFER)
+    {
+        mCandidates.clear();
+
+        const Vector &n = patch->GetNormal();
+        const Point &c = patch->GetCenter();
+
+        for (unsigned int index = 0; index < mPatches->size(); ++index)
+        {
+            const Patch *other = mPatches->at(index);
+            const Point *corners[4] =
+                { other->GetA(), other->GetB(), other->GetC(), other->GetD() };
+
+            if (other == patch)
+            {
+                continue;
+            }
+
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                if (dotProduct(Vector(*corners[corner], c), n) > 0)
+                {
+                    mCandidates.push_back(other);
+                    break;
+                }
+            }
+        }
+    }
+
     // For the multipliers, we can just put the hemicube at the origin
     Point origin = patch->GetCenter();
 
@@ -109,130 +220,36 @@ void Hemicube::TraceHemicube(Patch *patch)
 
     // Trace front face
     TraceFace(patch, p5, bottom_normal, right_normal, m_front_multiplier);
-}
 
-void Hemicube::BuildMultipliers()
-{
-    // For the multipliers, we can just put the hemicube at the origin
-    Point origin(0.0, 0.0, 0.0);
+    // Hand the form factors back and reset the slots
+    row.clear();
 
-    // The normal is the look-at for the camera. We'll use the -z-axis.
-    Vector normal(0.0, 0.0, -1.0);
-
-    // Define one of the corners
-    Point corner(-WIDTH/2, WIDTH/2, 0);
-
-    // Vector vN goes from the center point to corner N
-    Vector v1(corner, origin);
-    Vector v2 = crossProduct(normal, v1);
-
-    normalize(v1);
-    normalize(v2);
-
-    Vector v3 = negateVector(v1);
-    Vector v4 = negateVector(v2);
-
-    // The distance from the center to the corners on the same plane is equal
-    // to the square root of one-half the width of the hemicube.
-    float distance = sqrt(WIDTH/2);
-
-    // Create the 8 points that define the cube.
-    Point p1 = scalarMultiply(v1, distance).Translate(origin);
-	Point p2 = scalarMultiply(v2, distance).Translate(origin);
-	Point p3 = scalarMultiply(v1, -distance).Translate(origin);
-	Point p4 = scalarMultiply(v2, -distance).Translate(origin);
-	Point p5 = scalarMultiply(normal, (WIDTH/2)).Translate(p1);
-	Point p6 = scalarMultiply(normal, (WIDTH/2)).Translate(p2);
-	Point p7 = scalarMultiply(normal, (WIDTH/2)).Translate(p3);
-	Point p8 = scalarMultiply(normal, (WIDTH/2)).Translate(p4);
-
-    // The vector that is normal to the left face is the sum of the vectors
-    // that extend from the center point to the two corners of the left face.
-    Vector left_normal = add(v1, v4);
-    normalize(left_normal);
-
-    // The vector that is normal to the top face is the sum of the vectors
-    // that extend from the center point to the two corners of the top face.
-    Vector top_normal = add(v1, v2);
-    normalize(top_normal);
-
-    // The vector that is normal to the right face is the sum of the vectors
-    // that extend from the center point to the two corners of the right face.
-    Vector right_normal = add(v2, v3);
-    normalize(right_normal);
-
-    // The vector that is normal to the bottom face is the sum of the vectors
-    // that extend from the center point to the two corners of the bottom face.
-    Vector bottom_normal = add(v3, v4);
-    normalize(bottom_normal);
+    for (unsigned int slot = 0; slot < viewable.size(); ++slot)
+    {
+        unsigned int index = viewable[slot];
 
-    // The vector that is normal to the front face is equal to the normal
-    // vector of the patch. In this case, the patch is the x-y plane.
-    Vector front_normal = normal;
+        row.push_back(FormFactorMatrix::Entry(index, mFactors.at(slot)));
+        mSlots.at(index) = -1;
+    }
 
-    m_left_multiplier = new Multiplier(origin,
-                                      p1,
-                                      normal,
-                                      left_normal,
-                                      bottom_normal,
-                                      front_normal,
-                                      mSubdivisions,
-                                      mSubdivisions/2);
-
-    // Build the top multiplier
-    m_top_multiplier = new Multiplier(origin,
-                                     p1,
-                                     normal,
-                                     top_normal,
-                                     front_normal,
-                                     right_normal,
-                                     mSubdivisions/2,
-                                     mSubdivisions);
-
-    // Build the right multiplier
-    m_right_multiplier = new Multiplier(origin,
-                                       p6,
-                                       normal,
-                                       right_normal,
-                                       bottom_normal,
-                                       negateVector(front_normal),
-                                       mSubdivisions,
-                                       mSubdivisions/2);
-
-    // Build the bottom multiplier
-    m_bottom_multiplier = new Multiplier(origin,
-                                        p8,
-                                        normal,
-                                        bottom_normal,
-                                        negateVector(front_normal),
-                                        right_normal,
-                                        mSubdivisions/2,
-                                        mSubdivisions);
-
-    // Build the front multiplier
-    m_front_multiplier = new Multiplier(origin,
-                                       p5,
-                                       normal,
-                                       front_normal,
-                                       bottom_normal,
-                                       right_normal,
-                                       mSubdivisions,
-                                       mSubdivisions);
+    for (unsigned int quad = 0; quad < mQuadSlots.size(); ++quad)
+    {
+        mQuadSlots[quad].clear();
+    }
 }
 
-void Hemicube::NormalizeMultipliers()
+void Hemicube::BuildMultipliers()
 {
-    float normalization_factor = m_left_multiplier->sum() +
-                                 m_top_multiplier->sum() +
-                                 m_right_multiplier->sum() +
-                                 m_bottom_multiplier->sum() +
-                                 m_front_multiplier->sum();
-
-    m_left_multiplier->normalize(normalization_factor);
-    m_top_multiplier->normalize(normalization_factor);
-    m_right_multiplier->normalize(normalization_factor);
-    m_bottom_multiplier->normalize(normalization_factor);
-    m_front_multiplier->normalize(normalization_factor);
+    // The weights only depend on the resolution, so every hemicube of the
+    // same resolution shares one table and just views it face by face.
+    const MultiplierTable &table =
+        MultiplierTable::ForResolution(mSubdivisions);
+
+    m_left_multiplier = new Multiplier(table, Multiplier::LEFT);
+    m_top_multiplier = new Multiplier(table, Multiplier::TOP);
+    m_right_multiplier = new Multiplier(table, Multiplier::RIGHT);
+    m_bottom_multiplier = new Multiplier(table, Multiplier::BOTTOM);
+    m_front_multiplier = new Multiplier(table, Multiplier::FRONT);
 }
 
 void Hemicube::TraceFace(Patch *patch,
@@ -241,12 +258,18 @@ void Hemicube::TraceFace(Patch *patch,
                          Vector col,
                          Multiplier *multiplier)
 {
+    if (mBackend == Z_BUFFER)
+    {
+        RasterizeFace(patch, startingPoint, row, col, multiplier);
+        return;
+    }
+
     // The origin of the ray is the center point of the patch.
     Point origin = patch->GetCenter();
 
     // This algorithm fires rays through the surface pixels of the hemicube.
     // The pixel width is defined by 1/N.
-    float dp = 1.0 / mSubdivisions;
+    float dp = WIDTH / mSubdivisions;
 
     // Make sure the row and column vectors are normalized. Then weight them
     // by dp.
@@ -260,84 +283,463 @@ void Hemicube::TraceFace(Patch *patch,
     // index of the multiplier table.
     Point e = scalarMultiply(add(row, col), 0.5).Translate(startingPoint);
 
-    std::vector<Patch*>::const_iterator iter;
+    unsigned int height = multiplier->height();
+    unsigned int width = multiplier->width();
+
+    mRays.resize(height * width);
+    mCellSlots.resize(height * width);
 
-    for (unsigned int r(0); r < multiplier->height(); ++r)
+    for (unsigned int r(0); r < height; ++r)
     {
         Point f = e;
 
-        for (unsigned int c(0); c < multiplier->width(); ++c)
+        for (unsigned int c(0); c < width; ++c)
         {
             // Create the ray, which depends on the face you are dealing with.
             Vector ray(f, origin);
             normalize(ray);
 
-            int index = 0;
+            mRays[r * width + c] = ray;
+
+            // Update f
+            f = col.Translate(f);
+
+        } // loop over column index
+
+        // Update e
+        e = row.Translate(e);
+
+    } // loop over row index
+
+    if (mBvh != nullptr)
+    {
+        // Trace coherent tiles of cells through the hierarchy together
+        mCellHits.assign(height * width, UNTRACED);
+        mCellDistances.resize(height * width);
+
+        for (unsigned int top = 0; top < height; top += HEMICUBE_TILE)
+        {
+            for (unsigned int left = 0; left < width; left += HEMICUBE_TILE)
+            {
+                TraceTile(patch, top, left,
+                          std::min(height - top, (unsigned int)HEMICUBE_TILE),
+                          std::min(width - left, (unsigned int)HEMICUBE_TILE),
+                          width);
+            }
+        }
+
+        for (unsigned int cell = 0; cell < height * width; ++cell)
+        {
+            int hit = mCellHits[cell];
+
+            mCellSlots[cell] = ((hit < 0) || (hit >= int(mSlots.size()))) ?
+                               -1 : mSlots[hit];
+        }
+    }
+    else
+    {
+        for (unsigned int cell = 0; cell < height * width; ++cell)
+        {
+            mCellSlots[cell] = FindViewableSlot(patch, mRays[cell], origin);
+        }
+    }
+
+    // Update the form factors, cell by cell
+    for (unsigned int r(0); r < height; ++r)
+    {
+        for (unsigned int c(0); c < width; ++c)
+        {
+            int slot = mCellSlots[r * width + c];
+
+            if (slot >= 0)
+            {
+                mFactors[slot] += multiplier->weight_at(r, c);
+            }
+        }
+    }
+}
+
+void Hemicube::TraceTile(Patch *patch, unsigned int top, unsigned int left,
+                         unsigned int rows, unsigned int columns,
+                         unsigned int width)
+{
+    const Point &origin = patch->GetCenter();
+
+    const unsigned int corners[4] =
+    {
+        top * width + left,
+        top * width + left + columns - 1,
+        (top + rows - 1) * width + left + columns - 1,
+        (top + rows - 1) * width + left
+    };
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        unsigned int cell = corners[corner];
 
-            // Determine the shape that this ray intersects. Knowing the shape
-            // eliminates the patches from all other objects (a significant
-            // improvement).
-            Point *closest = nullptr;
+        if (mCellHits[cell] == UNTRACED)
+        {
+            mCellHits[cell] = mBvh->Intersect(mRays[cell], origin,
+                                              patch->GetIndex(),
+                                              mCellDistances[cell]);
+        }
+    }
+
+    // Every cell of a small tile is a corner
+    if ((rows <= 2) && (columns <= 2))
+    {
+        return;
+    }
+
+    // If the corner rays all land inside one patch, so do the rays in
+    // between, unless something else lies in the way.
+    int hit = mCellHits[corners[0]];
+    bool coherent = true;
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        unsigned int cell = corners[corner];
+
+        coherent = coherent && (mCellHits[cell] == hit) &&
+                   ((hit < 0) || Interior(mPatches->at(hit), mRays[cell],
+                                          origin, mCellDistances[cell]));
+    }
+
+    if (coherent)
+    {
+        const Vector rays[4] = { mRays[corners[0]], mRays[corners[1]],
+                                 mRays[corners[2]], mRays[corners[3]] };
+        Frustum frustum;
+        frustum.Set(origin, rays);
 
-            // find the closest intersection
-            //int shape2 = 0;
-            for (unsigned int shape = 0; shape < mShapes->size(); ++shape)
+        // Nothing behind the patch can come before it
+        if (hit >= 0)
+        {
+            const Patch *other = mPatches->at(hit);
+            frustum.SetFar(*other->GetA(), other->GetNormal());
+        }
+
+        coherent = !mBvh->Occupied(frustum, patch->GetIndex(), hit);
+    }
+
+    if (coherent)
+    {
+        for (unsigned int r = top; r < top + rows; ++r)
+        {
+            for (unsigned int c = left; c < left + columns; ++c)
             {
+                mCellHits[r * width + c] = hit;
+            }
+        }
+
+        return;
+    }
 
-                // Get the intersection point
-                Point *p = (mShapes->at(shape))->Intersect(ray, origin);
+    // Otherwise the tile straddles a silhouette: split it in four, down
+    // to single rays
+    unsigned int top_rows = (rows + 1) / 2;
+    unsigned int left_columns = (columns + 1) / 2;
+
+    TraceTile(patch, top, left, top_rows, left_columns, width);
+
+    if (columns > left_columns)
+    {
+        TraceTile(patch, top, left + left_columns, top_rows,
+                  columns - left_columns, width);
+    }
+
+    if (rows > top_rows)
+    {
+        TraceTile(patch, top + top_rows, left, rows - top_rows,
+                  left_columns, width);
+
+        if (columns > left_columns)
+        {
+            TraceTile(patch, top + top_rows, left + left_columns,
+                      rows - top_rows, columns - left_columns, width);
+        }
+    }
+}
+
+bool Hemicube::Interior(const Patch *other, const Vector &ray,
+                        const Point &origin, float distance) const
+{
+    Point intersect = scalarMultiply(ray, distance).Translate(origin);
+
+    Vector ci(intersect, *other->GetC());
+    Vector bc(*other->GetB(), *other->GetC());
+    Vector cd(*other->GetD(), *other->GetC());
+
+    float u = dotProduct(ci, bc) / dotProduct(bc, bc);
+    float v = dotProduct(ci, cd) / dotProduct(cd, cd);
+
+    return (u > TILE_INTERIOR) && (u < 1 - TILE_INTERIOR) &&
+           (v > TILE_INTERIOR) && (v < 1 - TILE_INTERIOR);
+}
+
+void Hemicube::RasterizeFace(Patch *patch,
+                             Point startingPoint,
+                             Vector row,
+                             Vector col,
+                             Multiplier *multiplier)
+{
+    Point origin = patch->GetCenter();
+
+    // Build an orthonormal frame for the face: rows, columns, and the
+    // outward normal of the face.
+    normalize(row);
+    normalize(col);
+
+    Vector normal = crossProduct(row, col);
+    normalize(normal);
+
+    Vector to_start(startingPoint, origin);
+
+    if (dotProduct(normal, to_start) < 0)
+    {
+        normal = negateVector(normal);
+    }
+
+    // Distance from the hemicube center to the face, and the face
+    // coordinates of the corner where cell (0, 0) lies.
+    float h = dotProduct(normal, to_start);
+    float u0 = dotProduct(row, to_start);
+    float v0 = dotProduct(col, to_start);
+
+    float dp = WIDTH / mSubdivisions;
+    float near = h * Z_BUFFER_NEAR;
+
+    int height = multiplier->height();
+    int width = multiplier->width();
+    unsigned int cells = height * width;
+
+    if (mDepth.size() < cells)
+    {
+        mDepth.resize(cells);
+        mItems.resize(cells);
+    }
 
-                if (p != nullptr)
+    std::fill(mDepth.begin(), mDepth.begin() + cells,
+              std::numeric_limits<float>::max());
+    std::fill(mItems.begin(), mItems.begin() + cells, -1);
+
+    for (unsigned int candidate = 0; candidate < mCandidates.size();
+         ++candidate)
+    {
+        const Patch *other = mCandidates[candidate];
+        const Point *corners[4] =
+            { other->GetA(), other->GetB(), other->GetC(), other->GetD() };
+
+        // Transform the corners into face space: u along the rows, v along
+        // the columns, and d towards the face.
+        float u[4];
+        float v[4];
+        float d[4];
+        bool visible = false;
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            Vector p(*corners[corner], origin);
+            u[corner] = dotProduct(p, row);
+            v[corner] = dotProduct(p, col);
+            d[corner] = dotProduct(p, normal);
+            visible = visible || (d[corner] > near);
+        }
+
+        if (!visible)
+        {
+            continue;
+        }
+
+        // Clip against the near plane, then project onto the face and
+        // convert to cell units.
+        float x[MAX_CLIPPED_VERTICES];
+        float y[MAX_CLIPPED_VERTICES];
+        int count = 0;
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            int next = (corner + 1) % 4;
+            bool inside = d[corner] > near;
+
+            if (inside)
+            {
+                x[count] = (u[corner] * h / d[corner] - u0) / dp;
+                y[count] = (v[corner] * h / d[corner] - v0) / dp;
+                ++count;
+            }
+
+            if (inside != (d[next] > near))
+            {
+                float s = (near - d[corner]) / (d[next] - d[corner]);
+                float uc = u[corner] + s * (u[next] - u[corner]);
+                float vc = v[corner] + s * (v[next] - v[corner]);
+
+                x[count] = (uc * h / near - u0) / dp;
+                y[count] = (vc * h / near - v0) / dp;
+                ++count;
+            }
+        }
+
+        // Signed area tells the winding; edge-on patches cover nothing.
+        float area = 0;
+        float min_x = x[0];
+        float max_x = x[0];
+        float min_y = y[0];
+        float max_y = y[0];
+
+        for (int vertex = 0; vertex < count; ++vertex)
+        {
+            int next = (vertex + 1) % count;
+            area += x[vertex] * y[next] - x[next] * y[vertex];
+
+            min_x = std::min(min_x, x[vertex]);
+            max_x = std::max(max_x, x[vertex]);
+            min_y = std::min(min_y, y[vertex]);
+            max_y = std::max(max_y, y[vertex]);
+        }
+
+        if (area == 0)
+        {
+            continue;
+        }
+
+        float winding = (area > 0) ? 1.0f : -1.0f;
+
+        // Cells whose centers fall inside the bounding box
+        int first_row = std::max(0, int(std::ceil(min_x - 0.5f)));
+        int last_row = std::min(height - 1, int(std::floor(max_x - 0.5f)));
+        int first_col = std::max(0, int(std::ceil(min_y - 0.5f)));
+        int last_col = std::min(width - 1, int(std::floor(max_y - 0.5f)));
+
+        if ((first_row > last_row) || (first_col > last_col))
+        {
+            continue;
+        }
+
+        // The depth of a cell is the distance along its ray, measured in
+        // units of the (unnormalized) ray through the cell center, to the
+        // plane of the patch. This is exact, unlike interpolating depth.
+        const Vector &plane_normal = other->GetNormal();
+        float plane_distance =
+            dotProduct(Vector(*corners[0], origin), plane_normal);
+        float nu = dotProduct(plane_normal, row);
+        float nv = dotProduct(plane_normal, col);
+        float nd = dotProduct(plane_normal, normal);
+
+        for (int r = first_row; r <= last_row; ++r)
+        {
+            float cx = r + 0.5f;
+
+            for (int c = first_col; c <= last_col; ++c)
+            {
+                float cy = c + 0.5f;
+                bool inside = true;
+
+                for (int vertex = 0; inside && (vertex < count); ++vertex)
+                {
+                    int next = (vertex + 1) % count;
+                    float edge = (x[next] - x[vertex]) * (cy - y[vertex]) -
+                                 (y[next] - y[vertex]) * (cx - x[vertex]);
+                    inside = (edge * winding >= 0);
+                }
+
+                if (!inside)
+                {
+                    continue;
+                }
+
+                float denominator = nu * (u0 + cx * dp) +
+                                    nv * (v0 + cy * dp) +
+                                    nd * h;
+
+                if (denominator == 0)
                 {
-                    // There was an intersection
-                    if (closest == nullptr)
-                    {
-                        // p is closest, by default
-                        closest = p;
-                        //shape2 = shape;
-                    }
-                    else if (origin.DistanceTo(*p) < origin.DistanceTo(*closest))
-                    {
-                        // p is closer
-                        closest = p;
-                        //shape2 = shape;
-                    }
+                    continue;
+                }
+
+                float depth = plane_distance / denominator;
+                unsigned int cell = r * width + c;
+
+                if ((depth > 0) && (depth < mDepth[cell]))
+                {
+                    mDepth[cell] = depth;
+                    mItems[cell] = other->GetIndex();
                 }
             }
+        }
+    }
 
-            //cout << endl << "looking for id: " << shape2 << endl;
+    // Credit every cell to the patch left in the item buffer
+    for (int r = 0; r < height; ++r)
+    {
+        for (int c = 0; c < width; ++c)
+        {
+            int item = mItems[r * width + c];
 
-            // Fire the ray at every patch with line of sight
-            for (iter = patch->GetViewablePatches()->begin();
-                 iter != patch->GetViewablePatches()->end(); ++iter)
+            if ((item >= 0) && (item < int(mSlots.size())) &&
+                (mSlots[item] >= 0))
             {
+                mFactors[mSlots[item]] += multiplier->weight_at(r, c);
+            }
+        }
+    }
+}
 
-                //cout << "parent id: " << (*iter)->GetParentId() << endl;
+int Hemicube::FindViewableSlot(Patch *patch, const Vector &ray,
+                               const Point &origin)
+{
+    if (mByQuad)
+    {
+        // Determine the quad that this ray hits first, skipping the one
+        // the ray leaves from. Knowing the quad eliminates the patches
+        // from all other quads (a significant improvement).
+        Hit hit = mQuadBatch.Intersect(ray, origin,
+                                       std::numeric_limits<float>::max(),
+                                       patch->GetParent());
+
+        if (!hit.IsHit())
+        {
+            return -1;
+        }
 
-                //if ((*iter)->GetParentId() == shape2) {
+        int nearest = hit.shape;
 
-                    // If the ray intersects this patch
-                    if ((*iter)->Intersect(ray, origin) > 0)
-                    {
-                    //if (closest != nullptr && (*iter)->Contains(*closest)) {
-                        // Update the form factor for this patch
-                        patch->UpdateFormFactor(index, multiplier->weight_at(r, c));
-                        break;
-                    }
-                //}
+        // The patches of a quad tile it without overlapping, so the first
+        // one hit is the only one
+        const std::vector<int> &slots = mQuadSlots.at(nearest);
+
+        for (unsigned int entry = 0; entry < slots.size(); ++entry)
+        {
+            const Patch *other = mPatches->at(mViewable->at(slots[entry]));
 
-                ++index;
+            if (other->Intersect(ray, origin) > 0)
+            {
+                return slots[entry];
             }
+        }
 
-            // Update f
-            f = col.Translate(f);
+        return -1;
+    }
 
-        } // loop over column index
+    // Fire the ray at every patch with line of sight and keep the
+    // nearest hit
+    int nearest = -1;
+    float limit = std::numeric_limits<float>::max();
 
-        // Update e
-        e = row.Translate(e);
+    for (int index = 0; index < int(mViewable->size()); ++index)
+    {
+        const Patch *other = mPatches->at(mViewable->at(index));
+        float distance = other->Intersect(ray, origin);
 
-    } // loop over row index
+        if ((distance > 0) && (distance < limit))
+        {
+            limit = distance;
+            nearest = index;
+        }
+    }
+
+    return nearest;
 }
 
 }   // namespace Radiosity
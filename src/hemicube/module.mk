@@ -1,2 +1,3 @@
 SOURCE += hemicube.cpp
 SOURCE += multiplier.cpp
+SOURCE += multipliertable.cpp
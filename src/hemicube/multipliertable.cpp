@@ -0,0 +1,192 @@
+///
+/// @file MultiplierTable.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Normalized delta form factors of the hemicube cells, shared by every
+///     hemicube of the same resolution.
+///
+
+#include "multipliertable.h"
+
+#include <map>
+#include <mutex>
+
+namespace Radiosity
+{
+
+namespace
+{
+
+// The weights are worked out in units of cells, with the hemicube center
+// at the origin. The front face lies half a resolution away from the
+// center, as do the side faces, and cell centers sit half a cell off the
+// grid lines. A cell's weight is its delta form factor: the cosine between
+// the ray through its center and the face normal, times the cosine between
+// that ray and the patch normal, over the squared distance r^2 to the
+// cell. With h the distance to the face, that comes to
+//
+//     front: (h / r) (h / r) / r^2 = h^2 / (x^2 + y^2 + h^2)^2
+//     side:  (h / r) (z / r) / r^2 = h z / (h^2 + x^2 + z^2)^2
+//
+// for a cell centered x and y (or z above the base) from the face center.
+
+constexpr double FrontWeight(int half, int a, int b)
+{
+    double r2 = (a + 0.5) * (a + 0.5) + (b + 0.5) * (b + 0.5) +
+                double(half) * half;
+    return double(half) * half / (r2 * r2);
+}
+
+constexpr double SideWeight(int half, int a, int height)
+{
+    double r2 = double(half) * half + (a + 0.5) * (a + 0.5) +
+                (height + 0.5) * (height + 0.5);
+    return half * (height + 0.5) / (r2 * r2);
+}
+
+// Sum of the weights over the whole hemicube: four quadrants of the front
+// face and eight half side faces.
+constexpr double TotalWeight(int half)
+{
+    double total = 0;
+
+    for (int b = 0; b < half; ++b)
+    {
+        for (int a = 0; a < half; ++a)
+        {
+            total += 4 * FrontWeight(half, a, b) + 8 * SideWeight(half, a, b);
+        }
+    }
+
+    return total;
+}
+
+// Fills one octant of the front face and one half of a side face with
+// weights normalized over the whole hemicube. Compiled and run time tables
+// are both built here, so every resolution is weighted the same way.
+constexpr void FillWeights(int half, float *front, float *side)
+{
+    double total = TotalWeight(half);
+
+    for (int b = 0; b < half; ++b)
+    {
+        for (int a = 0; a <= b; ++a)
+        {
+            front[b * (b + 1) / 2 + a] =
+                float(FrontWeight(half, a, b) / total);
+        }
+
+        for (int a = 0; a < half; ++a)
+        {
+            side[b * half + a] = float(SideWeight(half, a, b) / total);
+        }
+    }
+}
+
+///
+/// @name CompiledTable
+///
+/// @description
+/// 	Weights of a resolution, evaluated by the compiler.
+///
+template <int N>
+struct CompiledTable
+{
+    static constexpr int HALF = N / 2;
+
+    float mFront[HALF * (HALF + 1) / 2];
+    float mSide[HALF * HALF];
+
+    constexpr CompiledTable():
+        mFront(),
+        mSide()
+    {
+        FillWeights(HALF, mFront, mSide);
+    }
+};
+
+constexpr CompiledTable<16> TABLE_16;
+constexpr CompiledTable<26> TABLE_26;
+constexpr CompiledTable<32> TABLE_32;
+constexpr CompiledTable<52> TABLE_52;
+constexpr CompiledTable<64> TABLE_64;
+constexpr CompiledTable<104> TABLE_104;
+constexpr CompiledTable<128> TABLE_128;
+
+}   // namespace
+
+const MultiplierTable &MultiplierTable::ForResolution(int resolution)
+{
+    static std::mutex mutex;
+    static std::map<int, MultiplierTable*> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<int, MultiplierTable*>::iterator found = tables.find(resolution);
+
+    if (found != tables.end())
+    {
+        return *found->second;
+    }
+
+    MultiplierTable *table;
+
+    switch (resolution)
+    {
+    case 16:
+        table = new MultiplierTable(16, TABLE_16.mFront, TABLE_16.mSide);
+        break;
+    case 26:
+        table = new MultiplierTable(26, TABLE_26.mFront, TABLE_26.mSide);
+        break;
+    case 32:
+        table = new MultiplierTable(32, TABLE_32.mFront, TABLE_32.mSide);
+        break;
+    case 52:
+        table = new MultiplierTable(52, TABLE_52.mFront, TABLE_52.mSide);
+        break;
+    case 64:
+        table = new MultiplierTable(64, TABLE_64.mFront, TABLE_64.mSide);
+        break;
+    case 104:
+        table = new MultiplierTable(104, TABLE_104.mFront, TABLE_104.mSide);
+        break;
+    case 128:
+        table = new MultiplierTable(128, TABLE_128.mFront, TABLE_128.mSide);
+        break;
+    default:
+        table = new MultiplierTable(resolution);
+        break;
+    }
+
+    tables[resolution] = table;
+    return *table;
+}
+
+MultiplierTable::MultiplierTable(int resolution):
+    mResolution(resolution),
+    mHalf(resolution / 2)
+{
+    int octant = mHalf * (mHalf + 1) / 2;
+
+    mStorage.resize(octant + mHalf * mHalf);
+
+    FillWeights(mHalf, &mStorage.at(0), &mStorage.at(octant));
+
+    mFront = &mStorage.at(0);
+    mSide = &mStorage.at(octant);
+}
+
+MultiplierTable::MultiplierTable(int resolution, const float *front,
+                                 const float *side):
+    mResolution(resolution),
+    mHalf(resolution / 2),
+    mFront(front),
+    mSide(side)
+{
+}
+
+}   // namespace Radiosity
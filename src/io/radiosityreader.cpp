@@ -13,7 +13,8 @@
 namespace Radiosity
 {
 
-RadiosityReader::RadiosityReader()
+RadiosityReader::RadiosityReader(Arena *arena):
+    mArena(arena)
 {
 }
 
@@ -36,6 +37,9 @@ std::vector<Rectangle*> *RadiosityReader::ParseObj(const char *filename)
 
 	Color color;
 
+	// Emission applies to every face after it, like color
+	float emission = 0;
+
 	char *buffer = new char[INPUT_BUFFER_LEN];
 
 	std::vector<Rectangle*> *quads = new std::vector<Rectangle*>();
@@ -53,8 +57,6 @@ std::vector<Rectangle*> *RadiosityReader::ParseObj(const char *filename)
 	    // Parse the first character
 	    char *begin = strtok(buffer, " \n");
 
-	    float emission;
-
 	    if (strncmp(begin, "#", 1) == 0)
 	    {
 	        // comment - do nothing
@@ -120,12 +122,12 @@ std::vector<Rectangle*> *RadiosityReader::ParseObj(const char *filename)
 	        int index_d = strtol(dc, nullptr, 0) - 1;
 
 	        // Create the new quad
-	        quads->push_back(new Rectangle(vertices.at(index_a),
-	                                       vertices.at(index_b),
-	                                       vertices.at(index_c),
-	                                       vertices.at(index_d),
-	                                       color,
-	                                       emission));
+	        quads->push_back(mArena->New<Rectangle>(vertices.at(index_a),
+	                                                vertices.at(index_b),
+	                                                vertices.at(index_c),
+	                                                vertices.at(index_d),
+	                                                color,
+	                                                emission));
 	    }
 	    else
 	    {
@@ -153,7 +155,8 @@ std::vector<Rectangle*> *RadiosityReader::ParseObj(const char *filename)
     return quads;
 }
 
-std::vector<Patch*> *RadiosityReader::ParsePat(const char *filename)
+std::vector<Patch*> *RadiosityReader::ParsePat(const char *filename,
+                                               Mesh *mesh)
 {
     int line_num(0);
 
@@ -219,13 +222,22 @@ std::vector<Patch*> *RadiosityReader::ParsePat(const char *filename)
 	        float Dz = strtof(strtok(nullptr, " "), nullptr);
 	        float emission = strtof(strtok(nullptr, " "), nullptr);
 
-	        Point *A = new Point(Ax, Ay, Az, color);
-	        Point *B = new Point(Bx, By, Bz, color);
-	        Point *C = new Point(Cx, Cy, Cz, color);
-	        Point *D = new Point(Dx, Dy, Dz, color);
+	        Point a(Ax, Ay, Az);
+	        Point b(Bx, By, Bz);
+	        Point c(Cx, Cy, Cz);
+	        Point d(Dx, Dy, Dz);
+
+	        // Corners only weld with those of patches facing the same way
+	        Vector normal = crossProduct(Vector(d, a), Vector(b, a));
+
+	        uint32_t A = mesh->Weld(a, normal);
+	        uint32_t B = mesh->Weld(b, normal);
+	        uint32_t C = mesh->Weld(c, normal);
+	        uint32_t D = mesh->Weld(d, normal);
 
 	        // Create the new patch
-	        Patch *p = new Patch(A, B, C, D, color, emission);
+	        Patch *p = mArena->New<Patch>(mesh, A, B, C, D, color, emission);
+	        p->SetIndex(patches->size());
 	        patches->push_back(p);
 	    }
 	    else
@@ -252,7 +264,9 @@ std::vector<Patch*> *RadiosityReader::ParsePat(const char *filename)
     return patches;
 }
 
-std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename)
+std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename,
+                                               Mesh *mesh,
+                                               VisibilityMatrix *visibility)
 {
     int line_num(0);
 
@@ -321,13 +335,22 @@ std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename)
 	        float Dz = strtof(strtok(nullptr, " "), nullptr);
 	        float emission = strtof(strtok(nullptr, " "), nullptr);
 
-	        Point *A = new Point(Ax, Ay, Az, color);
-	        Point *B = new Point(Bx, By, Bz, color);
-	        Point *C = new Point(Cx, Cy, Cz, color);
-	        Point *D = new Point(Dx, Dy, Dz, color);
+	        Point a(Ax, Ay, Az);
+	        Point b(Bx, By, Bz);
+	        Point c(Cx, Cy, Cz);
+	        Point d(Dx, Dy, Dz);
+
+	        // Corners only weld with those of patches facing the same way
+	        Vector normal = crossProduct(Vector(d, a), Vector(b, a));
+
+	        uint32_t A = mesh->Weld(a, normal);
+	        uint32_t B = mesh->Weld(b, normal);
+	        uint32_t C = mesh->Weld(c, normal);
+	        uint32_t D = mesh->Weld(d, normal);
 
 	        // Create the new patch
-	        Patch *p = new Patch(A, B, C, D, color, emission);
+	        Patch *p = mArena->New<Patch>(mesh, A, B, C, D, color, emission);
+	        p->SetIndex(patches->size());
 	        patches->push_back(p);
 
 	        // Create the corresponding los vector
@@ -356,7 +379,9 @@ std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename)
 	    memset(buffer, 0, INPUT_BUFFER_LEN);
 	}
 
-	// convert the los ids into pointers
+	// record the los ids in the visibility matrix
+	visibility->Reset(patches->size());
+
 	std::vector< std::vector<int> >::iterator los_iter = los.begin();
 
 	for (int index = 0; los_iter != los.end(); ++los_iter)
@@ -365,7 +390,7 @@ std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename)
 
 	    for (; iditer != los_iter->end(); ++iditer)
 	    {
-	        patches->at(index)->AddViewablePatch(patches->at(*iditer));
+	        visibility->Set(index, *iditer);
 	    }
 	    ++index;
 	}
@@ -379,7 +404,10 @@ std::vector<Patch*> *RadiosityReader::ParseLos(const char *filename)
     return patches;
 }
 
-std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename)
+std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename,
+                                               Mesh *mesh,
+                                               VisibilityMatrix *visibility,
+                                               FormFactorMatrix *formFactors)
 {
     int line_num(0);
 
@@ -401,6 +429,9 @@ std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename)
 	// Create a parallel vector of vectors for line of sight values
 	std::vector< std::vector<int> > los;
 
+	// And another for the form factors listed with each patch
+	std::vector< std::vector<float> > factors;
+
 	// Clear the buffer
 	memset(buffer, 0, INPUT_BUFFER_LEN);
 
@@ -447,18 +478,31 @@ std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename)
 	        float Dz = strtof(strtok(nullptr, " "), nullptr);
 	        float emission = strtof(strtok(nullptr, " "), nullptr);
 
-	        Point *A = new Point(Ax, Ay, Az, color);
-	        Point *B = new Point(Bx, By, Bz, color);
-	        Point *C = new Point(Cx, Cy, Cz, color);
-	        Point *D = new Point(Dx, Dy, Dz, color);
+	        Point a(Ax, Ay, Az);
+	        Point b(Bx, By, Bz);
+	        Point c(Cx, Cy, Cz);
+	        Point d(Dx, Dy, Dz);
+
+	        // Corners only weld with those of patches facing the same way
+	        Vector normal = crossProduct(Vector(d, a), Vector(b, a));
+
+	        uint32_t A = mesh->Weld(a, normal);
+	        uint32_t B = mesh->Weld(b, normal);
+	        uint32_t C = mesh->Weld(c, normal);
+	        uint32_t D = mesh->Weld(d, normal);
 
 	        // Create the new patch
-	        Patch *p = new Patch(A, B, C, D, color, emission);
+	        Patch *p = mArena->New<Patch>(mesh, A, B, C, D, color, emission);
+	        p->SetIndex(patches->size());
 	        patches->push_back(p);
 
 	        // Create the corresponding los vector
 	        std::vector<int> v;
 	        los.push_back(v);
+
+	        // And the corresponding form factor vector
+	        std::vector<float> f;
+	        factors.push_back(f);
 	    }
 	    else if (strcmp(begin, "l") == 0)
 	    {
@@ -476,8 +520,8 @@ std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename)
 	        // read the patch num
 	        float ff = strtof(strtok(nullptr, " "), nullptr);
 
-	        // insert the patch num into the last los vector
-	        patches->back()->GetFormFactors()->push_back(ff);
+	        // insert the form factor into the last form factor vector
+	        factors.back().push_back(ff);
 	    }
 	    else
 	    {
@@ -491,31 +535,37 @@ std::vector<Patch*> *RadiosityReader::ParseFor(const char *filename)
 	    memset(buffer, 0, INPUT_BUFFER_LEN);
 	}
 
-	// convert the los ids into pointers
+	// record the los ids in the visibility matrix, and the form factors
+	// listed in the same order into matrix rows. Missing form factors
+	// are zero.
+	visibility->Reset(patches->size());
+	formFactors->Reset(patches->size());
+
 	std::vector< std::vector<int> >::iterator los_iter = los.begin();
+	std::vector<FormFactorMatrix::Entry> entries;
 
 	for (int index = 0; los_iter != los.end(); ++los_iter)
 	{
 	    std::vector<int>::iterator iditer = los_iter->begin();
 
-	    for (; iditer != los_iter->end(); ++iditer)
+	    for (int slot = 0; iditer != los_iter->end(); ++iditer, ++slot)
 	    {
-	        patches->at(index)->AddViewablePatch(patches->at(*iditer));
-	    }
+	        visibility->Set(index, *iditer);
 
-	    if (patches->at(index)->GetViewablePatches()->size() !=
-	        patches->at(index)->GetFormFactors()->size())
-        {
-	        while (patches->at(index)->GetFormFactors()->size() <
-	               patches->at(index)->GetViewablePatches()->size())
-            {
-	            patches->at(index)->GetFormFactors()->push_back(0);
+	        if (slot < int(factors.at(index).size()))
+	        {
+	            entries.push_back(FormFactorMatrix::Entry(
+	                *iditer, factors.at(index).at(slot)));
 	        }
-        }
+	    }
+
+	    formFactors->SetRow(index, entries);
 
 	    ++index;
 	}
 
+	formFactors->Compress();
+
 	// delete the buffer
 	delete [] buffer;
 
@@ -0,0 +1,87 @@
+///
+/// @file Arena.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	A monotonic allocator for objects that live as long as the scene.
+///     Objects are bumped out of large blocks and all released together,
+///     instead of being allocated and freed one at a time.
+///
+
+#include "arena.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+namespace Radiosity
+{
+
+Arena::Arena(std::size_t blockSize):
+    mBlockSize(blockSize),
+    mCursor(nullptr),
+    mEnd(nullptr),
+    mAllocations(0),
+    mBytesAllocated(0),
+    mBytesReserved(0)
+{
+}
+
+Arena::~Arena()
+{
+    Release();
+}
+
+void *Arena::Allocate(std::size_t size, std::size_t alignment)
+{
+    uintptr_t cursor = reinterpret_cast<uintptr_t>(mCursor);
+    std::size_t padding = (alignment - cursor % alignment) % alignment;
+
+    if ((mCursor == nullptr) ||
+        (size + padding > static_cast<std::size_t>(mEnd - mCursor)))
+    {
+        // Blocks come from operator new, which aligns them for any object
+        std::size_t blockSize = std::max(mBlockSize, size);
+        char *block = static_cast<char*>(::operator new(blockSize));
+
+        mBlocks.push_back(block);
+        mBytesReserved += blockSize;
+
+        mCursor = block;
+        mEnd = block + blockSize;
+        padding = 0;
+    }
+
+    void *memory = mCursor + padding;
+    mCursor += padding + size;
+
+    ++mAllocations;
+    mBytesAllocated += padding + size;
+
+    return memory;
+}
+
+void Arena::Release()
+{
+    for (std::vector<Destructor>::reverse_iterator iter =
+             mDestructors.rbegin(); iter != mDestructors.rend(); ++iter)
+    {
+        iter->mDestroy(iter->mObjects, iter->mCount);
+    }
+
+    for (unsigned int index = 0; index < mBlocks.size(); ++index)
+    {
+        ::operator delete(mBlocks.at(index));
+    }
+
+    mDestructors.clear();
+    mBlocks.clear();
+    mCursor = nullptr;
+    mEnd = nullptr;
+    mAllocations = 0;
+    mBytesAllocated = 0;
+    mBytesReserved = 0;
+}
+
+}   // namespace Radiosity
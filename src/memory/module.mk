@@ -0,0 +1 @@
+SOURCE += arena.cpp
@@ -0,0 +1 @@
+SOURCE += threadpool.cpp
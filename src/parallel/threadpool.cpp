@@ -0,0 +1,266 @@
+///
+/// @file ThreadPool.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	A fixed-size pool of worker threads for data-parallel loops.
+///
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace Radiosity
+{
+
+ThreadPool::ThreadPool(unsigned int numThreads):
+    mTask(nullptr),
+    mCount(0),
+    mGrain(1),
+    mStatic(false),
+    mNext(0),
+    mGeneration(0),
+    mActive(0),
+    mShutdown(false)
+{
+    if (numThreads == 0)
+    {
+        numThreads = HardwareThreads();
+    }
+
+    mBlocks.reset(new std::atomic<uint64_t>[numThreads]);
+
+    // The calling thread acts as worker 0, so only spawn the rest.
+    for (unsigned int worker = 1; worker < numThreads; ++worker)
+    {
+        mThreads.push_back(std::thread(&ThreadPool::WorkerLoop, this, worker));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mWake.notify_all();
+
+    for (unsigned int index = 0; index < mThreads.size(); ++index)
+    {
+        mThreads.at(index).join();
+    }
+}
+
+unsigned int ThreadPool::Size() const
+{
+    return mThreads.size() + 1;
+}
+
+unsigned int ThreadPool::HardwareThreads()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return (count == 0) ? 1 : count;
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grain,
+                             const RangeTask &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Nothing to share the work with; avoid the synchronization entirely.
+    if (mThreads.empty())
+    {
+        task(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mGrain = std::max<std::size_t>(grain, 1);
+        mStatic = false;
+        mNext.store(0);
+    }
+
+    Publish();
+}
+
+void ThreadPool::ParallelForStatic(std::size_t count, const RangeTask &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (mThreads.empty())
+    {
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            task(index, index + 1, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mStatic = true;
+
+        // Deal the indices out in equal contiguous blocks
+        for (unsigned int worker = 0; worker < Size(); ++worker)
+        {
+            uint64_t begin = count * worker / Size();
+            uint64_t end = count * (worker + 1) / Size();
+            mBlocks[worker].store((begin << 32) | end);
+        }
+    }
+
+    Publish();
+}
+
+void ThreadPool::Publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mActive = mThreads.size();
+        ++mGeneration;
+    }
+    mWake.notify_all();
+
+    if (mStatic)
+    {
+        RunBlocks(0);
+    }
+    else
+    {
+        RunChunks(0);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mActive > 0)
+    {
+        mDone.wait(lock);
+    }
+    mTask = nullptr;
+}
+
+void ThreadPool::WorkerLoop(unsigned int worker)
+{
+    unsigned int seen = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mShutdown && (mGeneration == seen))
+            {
+                mWake.wait(lock);
+            }
+
+            if (mShutdown)
+            {
+                return;
+            }
+
+            seen = mGeneration;
+        }
+
+        if (mStatic)
+        {
+            RunBlocks(worker);
+        }
+        else
+        {
+            RunChunks(worker);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mActive;
+        }
+        mDone.notify_one();
+    }
+}
+
+void ThreadPool::RunChunks(unsigned int worker)
+{
+    const std::size_t share = 2 * Size();
+
+    for (;;)
+    {
+        // Claim a chunk proportional to the remaining work (guided
+        // scheduling), so the tail of the loop is split finely.
+        std::size_t begin = mNext.load();
+        std::size_t end;
+
+        do
+        {
+            if (begin >= mCount)
+            {
+                return;
+            }
+
+            std::size_t remaining = mCount - begin;
+            std::size_t chunk = std::max(mGrain, remaining / share);
+            end = begin + std::min(chunk, remaining);
+        }
+        while (!mNext.compare_exchange_weak(begin, end));
+
+        (*mTask)(begin, end, worker);
+    }
+}
+
+void ThreadPool::RunBlocks(unsigned int worker)
+{
+    // Work through our own block from the front
+    for (;;)
+    {
+        uint64_t block = mBlocks[worker].load();
+        uint64_t front = block >> 32;
+        uint64_t back = block & 0xffffffff;
+
+        if (front >= back)
+        {
+            break;
+        }
+
+        if (mBlocks[worker].compare_exchange_weak(
+                block, ((front + 1) << 32) | back))
+        {
+            (*mTask)(front, front + 1, worker);
+        }
+    }
+
+    // Then steal from the back of the others until every block is empty
+    for (unsigned int offset = 1; offset < Size(); ++offset)
+    {
+        unsigned int victim = (worker + offset) % Size();
+
+        for (;;)
+        {
+            uint64_t block = mBlocks[victim].load();
+            uint64_t front = block >> 32;
+            uint64_t back = block & 0xffffffff;
+
+            if (front >= back)
+            {
+                break;
+            }
+
+            if (mBlocks[victim].compare_exchange_weak(
+                    block, (front << 32) | (back - 1)))
+            {
+                (*mTask)(back - 1, back, worker);
+            }
+        }
+    }
+}
+
+}   // namespace Radiosity
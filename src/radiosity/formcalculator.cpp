@@ -11,26 +11,502 @@
 
 #include "formcalculator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+// Nearest-patch distance, in patch widths, at and beyond which the base
+// resolution is fine. Closer geometry scales the resolution up.
+#define ADAPTIVE_REACH 4.0f
+
+// Fraction of the way to its center each corner of a patch is pulled in
+// when checking what lies between it and another patch, so that patches
+// merely touching its edges do not count as being in the way
+#define NEAR_FIELD_INSET 1e-3f
+
 namespace Radiosity
 {
 
-FormCalculator::FormCalculator(std::vector<Rectangle*> *quads):
-    mHemicube(25, quads)
+FormCalculator::FormCalculator(std::vector<Rectangle*> *quads,
+                               const VisibilityMatrix *visibility,
+                               const Bvh *bvh,
+                               Hemicube::Backend backend,
+                               ThreadPool *pool):
+    mQuads(quads),
+    mVisibility(visibility),
+    mBvh(bvh),
+    mBackend(backend),
+    mPool(pool),
+    mResolution(DEFAULT_RESOLUTION),
+    mMaxResolution(0),
+    mNearField(0),
+    mReciprocity(TRACE_ALL),
+    mTracedRows(0),
+    mReciprocityError(0),
+    mMaxReciprocityError(0)
+{
+}
+
+std::vector<int> FormCalculator::Levels() const
+{
+    // Resolutions available to the patches: the base resolution, then
+    // doublings of it up to the maximum when adaptive.
+    std::vector<int> levels;
+    levels.push_back(Hemicube::RoundResolution(mResolution));
+
+    int finest = Hemicube::RoundResolution(mMaxResolution);
+
+    while ((mMaxResolution > 0) && (levels.back() < finest))
+    {
+        levels.push_back(std::min(2 * levels.back(), finest));
+    }
+
+    return levels;
+}
+
+void FormCalculator::SetResolution(int resolution)
+{
+    mResolution = resolution;
+}
+
+void FormCalculator::SetAdaptiveResolution(int maxResolution)
+{
+    mMaxResolution = maxResolution;
+}
+
+void FormCalculator::SetNearField(float reach)
 {
+    mNearField = reach;
+}
+
+void FormCalculator::SetReciprocity(Reciprocity reciprocity)
+{
+    mReciprocity = reciprocity;
 }
 
 FormCalculator::~FormCalculator()
 {
+    for (unsigned int level = 0; level < mRowHemicubes.size(); ++level)
+    {
+        delete mRowHemicubes.at(level);
+    }
+}
+
+void FormCalculator::CalculateFormFactors(std::vector<Patch*> *patches,
+                                          FormFactorMatrix *formFactors)
+{
+    formFactors->Reset(patches->size());
+
+    std::vector<bool> derivable(patches->size(), true);
+    std::vector<bool> traced;
+    ChooseTraced(patches, derivable, traced);
+
+    std::vector<uint32_t> tracedRows;
+    std::vector<uint32_t> derivedRows;
+
+    for (unsigned int index = 0; index < patches->size(); ++index)
+    {
+        if (traced.at(index))
+        {
+            tracedRows.push_back(index);
+        }
+        else
+        {
+            derivedRows.push_back(index);
+        }
+    }
+
+    TraceRows(patches, tracedRows, formFactors);
+    DeriveRows(patches, derivedRows, formFactors);
+
+    formFactors->Compress();
+
+    MeasureReciprocity(patches, formFactors);
+}
+
+void FormCalculator::TraceRows(std::vector<Patch*> *patches,
+                               const std::vector<uint32_t> &indices,
+                               FormFactorMatrix *formFactors)
+{
+    std::vector<int> levels = Levels();
+
+    mTracedRows = indices.size();
+
+    // Hemicubes keep scratch state while tracing, so give each thread in
+    // the pool its own, one per resolution, a viewable list and a row to
+    // trace into.
+    std::vector<Hemicube*> hemicubes;
+    std::vector< std::vector<uint32_t> > viewable(mPool->Size());
+    std::vector< std::vector<FormFactorMatrix::Entry> > rows(mPool->Size());
+
+    for (unsigned int worker = 0; worker < mPool->Size(); ++worker)
+    {
+        for (unsigned int level = 0; level < levels.size(); ++level)
+        {
+            hemicubes.push_back(new Hemicube(levels.at(level), mQuads,
+                                             patches, mBvh, mBackend));
+        }
+    }
+
+    // The cost of a hemicube varies with the number of viewable patches,
+    // so hand patches out one at a time and let the pool balance them.
+    mPool->ParallelFor(indices.size(), 1,
+        [this, &hemicubes, &viewable, &rows, &levels, &indices, patches,
+         formFactors](std::size_t begin, std::size_t end, unsigned int worker)
+        {
+            for (std::size_t position = begin; position < end; ++position)
+            {
+                uint32_t index = indices.at(position);
+                Patch *patch = patches->at(index);
+
+                mVisibility->Row(index, viewable.at(worker));
+
+                unsigned int level = ChooseLevel(patches, patch,
+                                                 viewable.at(worker), levels);
+
+                hemicubes.at(worker * levels.size() + level)->
+                    TraceHemicube(patch, viewable.at(worker),
+                                  rows.at(worker));
+
+                ApplyNearField(patches, patch, rows.at(worker));
+
+                formFactors->SetRow(index, rows.at(worker));
+            }
+        });
+
+    for (unsigned int worker = 0; worker < hemicubes.size(); ++worker)
+    {
+        delete hemicubes.at(worker);
+    }
+}
+
+void FormCalculator::DeriveRows(std::vector<Patch*> *patches,
+                                const std::vector<uint32_t> &indices,
+                                FormFactorMatrix *formFactors)
+{
+    std::vector< std::vector<uint32_t> > viewable(mPool->Size());
+    std::vector< std::vector<FormFactorMatrix::Entry> > rows(mPool->Size());
+
+    // Every patch a derived row can see has its row staged, so each of
+    // its form factors follows from the other side of the pair.
+    mPool->ParallelFor(indices.size(), 16,
+        [this, &viewable, &rows, &indices, patches, formFactors](
+            std::size_t begin, std::size_t end, unsigned int worker)
+        {
+            for (std::size_t position = begin; position < end; ++position)
+            {
+                uint32_t index = indices.at(position);
+                float area = patches->at(index)->GetArea();
+                std::vector<FormFactorMatrix::Entry> &row = rows.at(worker);
+
+                mVisibility->Row(index, viewable.at(worker));
+                row.clear();
+
+                for (unsigned int slot = 0; slot < viewable.at(worker).size();
+                     ++slot)
+                {
+                    uint32_t other = viewable.at(worker)[slot];
+                    float factor = formFactors->GetStaged(other, index);
+
+                    row.push_back(FormFactorMatrix::Entry(other,
+                        factor * patches->at(other)->GetArea() / area));
+                }
+
+                formFactors->SetRow(index, row);
+            }
+        });
+}
+
+void FormCalculator::CalculateRow(std::vector<Patch*> *patches,
+                                  Patch *patch,
+                                  std::vector<FormFactorMatrix::Entry> &row)
+{
+    std::vector<int> levels = Levels();
+
+    // Keep the hemicubes around; rows tend to be requested one after the
+    // other.
+    if (mRowHemicubes.empty())
+    {
+        for (unsigned int level = 0; level < levels.size(); ++level)
+        {
+            mRowHemicubes.push_back(new Hemicube(levels.at(level), mQuads,
+                                                 patches, mBvh, mBackend));
+        }
+    }
+
+    mVisibility->Row(patch->GetIndex(), mRowViewable);
+    mRowHemicubes.at(ChooseLevel(patches, patch, mRowViewable, levels))->
+        TraceHemicube(patch, mRowViewable, row);
+
+    ApplyNearField(patches, patch, row);
+
+    // Drop the patches the hemicube did not see
+    unsigned int kept = 0;
+
+    for (unsigned int entry = 0; entry < row.size(); ++entry)
+    {
+        if (row.at(entry).second != 0)
+        {
+            row.at(kept++) = row.at(entry);
+        }
+    }
+
+    row.resize(kept);
+}
+
+void FormCalculator::ChooseTraced(const std::vector<Patch*> *patches,
+                                  const std::vector<bool> &derivable,
+                                  std::vector<bool> &traced) const
+{
+    traced.assign(patches->size(), true);
+
+    if (mReciprocity != DERIVE)
+    {
+        return;
+    }
+
+    std::vector<std::size_t> degree(patches->size());
+
+    for (unsigned int index = 0; index < patches->size(); ++index)
+    {
+        degree.at(index) = mVisibility->Count(index);
+    }
+
+    std::vector<uint32_t> order(patches->size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(),
+        [&degree, patches](uint32_t a, uint32_t b)
+        {
+            if (degree.at(a) != degree.at(b))
+            {
+                return degree.at(a) < degree.at(b);
+            }
+
+            return patches->at(a)->GetArea() > patches->at(b)->GetArea();
+        });
+
+    // Greedily leave patches out, then keep everything they can see
+    std::vector<bool> needed(patches->size(), false);
+    std::vector<uint32_t> viewable;
+
+    for (unsigned int position = 0; position < order.size(); ++position)
+    {
+        uint32_t index = order.at(position);
+
+        if (needed.at(index) || !derivable.at(index))
+        {
+            continue;
+        }
+
+        traced.at(index) = false;
+        mVisibility->Row(index, viewable);
+
+        for (unsigned int slot = 0; slot < viewable.size(); ++slot)
+        {
+            needed.at(viewable[slot]) = true;
+        }
+    }
+}
+
+void FormCalculator::ApplyNearField(const std::vector<Patch*> *patches,
+                                    const Patch *patch,
+                                    std::vector<FormFactorMatrix::Entry> &row)
+                                    const
+{
+    if ((mNearField <= 0) || (mBvh == nullptr))
+    {
+        return;
+    }
+
+    // The hemicube looks out from the center of the patch
+    const Point &origin = patch->GetCenter();
+    const Vector &normal = patch->GetNormal();
+
+    // Sums of the hemicube values that are kept, and of those that are
+    // replaced, before and after
+    double kept = 0;
+    double replacedBefore = 0;
+    double replacedAfter = 0;
+    std::vector<bool> replaced(row.size(), false);
+
+    for (unsigned int entry = 0; entry < row.size(); ++entry)
+    {
+        const Patch *other = patches->at(row.at(entry).first);
+        const Point *corners[4] =
+            { other->GetA(), other->GetB(), other->GetC(), other->GetD() };
+
+        float width = std::sqrt(std::max(patch->GetArea(), other->GetArea()));
+
+        if (origin.DistanceTo(other->GetCenter()) >= mNearField * width)
+        {
+            continue;
+        }
+
+        // The formula needs all of the other patch in front of this one,
+        // facing it
+        if (dotProduct(Vector(origin, *other->GetA()),
+                       other->GetNormal()) <= 0)
+        {
+            continue;
+        }
+
+        bool inFront = true;
+        Vector rays[4] = { normal, normal, normal, normal };
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            Vector ray(*corners[corner], origin);
+
+            if (dotProduct(ray, normal) < 0)
+            {
+                inFront = false;
+                break;
+            }
+
+            rays[corner] = add(ray, scalarMultiply(
+                Vector(other->GetCenter(), *corners[corner]),
+                NEAR_FIELD_INSET));
+        }
+
+        if (!inFront)
+        {
+            continue;
+        }
+
+        Frustum frustum;
+        frustum.Set(origin, rays);
+        frustum.SetFar(*other->GetA(), other->GetNormal());
+
+        if (mBvh->Occupied(frustum, patch->GetIndex(), other->GetIndex()))
+        {
+            continue;
+        }
+
+        replacedBefore += row.at(entry).second;
+        row.at(entry).second = other->PointFormFactor(origin, normal);
+        replacedAfter += row.at(entry).second;
+        replaced.at(entry) = true;
+    }
+
+    if (replacedAfter == replacedBefore)
+    {
+        return;
+    }
+
+    // The hemicube values were normalized to the row's total, so scale the
+    // kept ones to make room for the exact values and keep that total.
+    // Should the exact values alone exceed it, they are scaled down too.
+    for (unsigned int entry = 0; entry < row.size(); ++entry)
+    {
+        if (!replaced.at(entry))
+        {
+            kept += row.at(entry).second;
+        }
+    }
+
+    double total = kept + replacedBefore;
+    double keptScale = (kept > 0) ?
+        std::max(0.0, total - replacedAfter) / kept : 0.0;
+    double replacedScale = (replacedAfter > total) ?
+        total / replacedAfter : 1.0;
+
+    for (unsigned int entry = 0; entry < row.size(); ++entry)
+    {
+        row.at(entry).second *= float(replaced.at(entry) ? replacedScale
+                                                         : keptScale);
+    }
+}
+
+void FormCalculator::MeasureReciprocity(const std::vector<Patch*> *patches,
+                                        const FormFactorMatrix *formFactors)
+{
+    mReciprocityError = 0;
+    mMaxReciprocityError = 0;
+
+    if (mReciprocity != VALIDATE)
+    {
+        return;
+    }
+
+    double difference = 0;
+    double total = 0;
+
+    const uint32_t *columns = formFactors->Columns();
+    const float *values = formFactors->Values();
+
+    for (unsigned int row = 0; row < formFactors->Rows(); ++row)
+    {
+        for (uint32_t entry = formFactors->RowBegin(row);
+             entry < formFactors->RowEnd(row); ++entry)
+        {
+            uint32_t column = columns[entry];
+            float reverse = formFactors->Get(column, row);
+
+            // Count each pair once, from its lower index or from the only
+            // side that saw the other
+            if ((column < row) && (reverse != 0))
+            {
+                continue;
+            }
+
+            double forward = double(patches->at(row)->GetArea()) *
+                             values[entry];
+            double backward = double(patches->at(column)->GetArea()) *
+                              reverse;
+            double discrepancy = std::fabs(forward - backward);
+
+            difference += discrepancy;
+            total += forward + backward;
+
+            mMaxReciprocityError = std::max(mMaxReciprocityError,
+                float(discrepancy / (forward + backward)));
+        }
+    }
+
+    mReciprocityError = (total > 0) ? difference / total : 0;
 }
 
-void FormCalculator::CalculateFormFactors(std::vector<Patch*> *patches)
+unsigned int FormCalculator::ChooseLevel(const std::vector<Patch*> *patches,
+                                         const Patch *patch,
+                                         const std::vector<uint32_t> &viewable,
+                                         const std::vector<int> &levels) const
 {
-    std::vector<Patch*>::const_iterator iter = patches->begin();
+    if (levels.size() == 1)
+    {
+        return 0;
+    }
 
-    for (; iter != patches->end(); ++iter)
+    // Distance to the nearest patch this one can see
+    float nearest = std::numeric_limits<float>::max();
+
+    for (unsigned int slot = 0; slot < viewable.size(); ++slot)
     {
-        mHemicube.TraceHemicube(*iter);
+        nearest = std::min(nearest, patch->GetCenter().DistanceTo(
+            patches->at(viewable[slot])->GetCenter()));
     }
+
+    if (nearest == std::numeric_limits<float>::max())
+    {
+        return 0;
+    }
+
+    // Scale the base resolution by how much closer than ADAPTIVE_REACH
+    // patch widths the nearest patch is.
+    float width = std::sqrt(patch->GetArea());
+    float wanted = levels.front() * ADAPTIVE_REACH * width /
+                   std::max(nearest, width * 1e-3f);
+
+    for (unsigned int level = 0; level < levels.size(); ++level)
+    {
+        if (levels.at(level) >= wanted)
+        {
+            return level;
+        }
+    }
+
+    return levels.size() - 1;
 }
 
 }   // namespace Radiosity
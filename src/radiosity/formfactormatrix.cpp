@@ -0,0 +1,121 @@
+///
+/// @file FormFactorMatrix.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Sparse matrix of the form factors between all patches of a scene,
+///     stored in compressed sparse row form.
+///
+
+#include "formfactormatrix.h"
+
+#include <algorithm>
+
+namespace Radiosity
+{
+
+FormFactorMatrix::FormFactorMatrix()
+{
+}
+
+void FormFactorMatrix::Reset(unsigned int numRows)
+{
+    mOffsets.assign(numRows + 1, 0);
+    mColumns.clear();
+    mValues.clear();
+
+    mStaged.clear();
+    mStaged.resize(numRows);
+}
+
+void FormFactorMatrix::SetRow(unsigned int row, std::vector<Entry> &entries)
+{
+    std::vector<Entry> &staged = mStaged.at(row);
+
+    staged.clear();
+
+    for (unsigned int index = 0; index < entries.size(); ++index)
+    {
+        if (entries.at(index).second != 0)
+        {
+            staged.push_back(entries.at(index));
+        }
+    }
+
+    std::sort(staged.begin(), staged.end());
+    entries.clear();
+}
+
+float FormFactorMatrix::GetStaged(unsigned int row,
+                                  unsigned int column) const
+{
+    const std::vector<Entry> &staged = mStaged.at(row);
+    std::vector<Entry>::const_iterator found = std::lower_bound(
+        staged.begin(), staged.end(), column,
+        [](const Entry &entry, unsigned int value)
+        {
+            return entry.first < value;
+        });
+
+    if ((found == staged.end()) || (found->first != column))
+    {
+        return 0;
+    }
+
+    return found->second;
+}
+
+void FormFactorMatrix::Compress()
+{
+    std::size_t total = 0;
+
+    for (unsigned int row = 0; row < mStaged.size(); ++row)
+    {
+        mOffsets.at(row) = total;
+        total += mStaged.at(row).size();
+    }
+
+    mOffsets.back() = total;
+
+    mColumns.resize(total);
+    mValues.resize(total);
+
+    for (unsigned int row = 0; row < mStaged.size(); ++row)
+    {
+        const std::vector<Entry> &staged = mStaged.at(row);
+
+        for (unsigned int index = 0; index < staged.size(); ++index)
+        {
+            mColumns.at(mOffsets.at(row) + index) = staged.at(index).first;
+            mValues.at(mOffsets.at(row) + index) = staged.at(index).second;
+        }
+    }
+
+    // Swap the staging rows out so their storage is actually released
+    std::vector< std::vector<Entry> >().swap(mStaged);
+}
+
+std::size_t FormFactorMatrix::MemoryUsage() const
+{
+    return mOffsets.size() * sizeof(uint32_t) +
+           mColumns.size() * sizeof(uint32_t) +
+           mValues.size() * sizeof(float);
+}
+
+float FormFactorMatrix::Get(unsigned int row, unsigned int column) const
+{
+    const uint32_t *begin = Columns() + RowBegin(row);
+    const uint32_t *end = Columns() + RowEnd(row);
+    const uint32_t *found = std::lower_bound(begin, end, column);
+
+    if ((found == end) || (*found != column))
+    {
+        return 0;
+    }
+
+    return mValues[found - Columns()];
+}
+
+}   // namespace Radiosity
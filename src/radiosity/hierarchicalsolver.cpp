@@ -0,0 +1,540 @@
+///
+/// @file HierarchicalSolver.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Hierarchical radiosity: every quad of the scene becomes the root of
+///     a quadtree of elements, and pairs of elements are linked at the
+///     coarsest level at which their form factor is small enough, so the
+///     number of links grows linearly with the number of elements.
+///
+
+#include "hierarchicalsolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#define PI 3.141592654
+
+// Rays cast between two elements to estimate how much of each the other
+// can see
+#define VISIBILITY_RAYS 4
+
+// Distance from the plane of an element, relative to the size of the
+// elements, within which a corner counts as lying on the plane
+#define PLANE_TOLERANCE 1e-4f
+
+namespace Radiosity
+{
+
+HierarchicalSolver::HierarchicalSolver(std::vector<Rectangle*> *quads,
+                                       Mesh *mesh, Arena *arena):
+    mQuads(quads),
+    mMesh(mesh),
+    mArena(arena),
+    mBvh(nullptr),
+    mThreshold(DEFAULT_LINK_THRESHOLD),
+    mMinimumSize(0),
+    mPool(nullptr),
+    mTolerance(0),
+    mNorm(Residual::L1)
+{
+    for (unsigned int index = 0; index < quads->size(); ++index)
+    {
+        Rectangle *quad = quads->at(index);
+
+        Element root;
+        root.mCorners[0] = mMesh->Weld(quad->A(), quad->Normal());
+        root.mCorners[1] = mMesh->Weld(quad->B(), quad->Normal());
+        root.mCorners[2] = mMesh->Weld(quad->C(), quad->Normal());
+        root.mCorners[3] = mMesh->Weld(quad->D(), quad->Normal());
+        root.mQuad = index;
+        root.mChildren = -1;
+        root.mLeaf = -1;
+        root.mPatch = mArena->New<Patch>(mMesh, root.mCorners[0],
+            root.mCorners[1], root.mCorners[2], root.mCorners[3],
+            quad->GetColor(), quad->emission);
+        root.mPatch->SetIndex(index);
+        root.mPatch->SetParent(index);
+
+        mElements.push_back(root);
+
+        // The hierarchy knows patches by their position, so the roots
+        // keep their place in it once Refine renumbers them as leaves
+        mRoots.push_back(root.mPatch);
+    }
+
+    mBvh = new Bvh(&mRoots);
+}
+
+HierarchicalSolver::~HierarchicalSolver()
+{
+    delete mBvh;
+}
+
+void HierarchicalSolver::SetThreshold(float threshold)
+{
+    mThreshold = threshold;
+}
+
+void HierarchicalSolver::SetMinimumSize(float size)
+{
+    mMinimumSize = size;
+}
+
+void HierarchicalSolver::SetThreadPool(ThreadPool *pool)
+{
+    mPool = pool;
+}
+
+void HierarchicalSolver::SetTolerance(float tolerance)
+{
+    mTolerance = tolerance;
+}
+
+void HierarchicalSolver::SetNorm(Residual::Norm norm)
+{
+    mNorm = norm;
+}
+
+std::size_t HierarchicalSolver::Links() const
+{
+    std::size_t links = 0;
+
+    for (unsigned int index = 0; index < mElements.size(); ++index)
+    {
+        links += mElements.at(index).mLinks.size();
+    }
+
+    return links;
+}
+
+void HierarchicalSolver::Refine(std::vector<Patch*> *leaves)
+{
+    // Quads are flat, so a quad never links with itself
+    for (uint32_t a = 0; a < mQuads->size(); ++a)
+    {
+        for (uint32_t b = a + 1; b < mQuads->size(); ++b)
+        {
+            RefinePair(a, b);
+        }
+    }
+
+    for (unsigned int index = 0; index < mElements.size(); ++index)
+    {
+        Element &element = mElements.at(index);
+
+        if (element.mChildren < 0)
+        {
+            element.mLeaf = leaves->size();
+            element.mPatch->SetIndex(leaves->size());
+            element.mPatch->SetParent(element.mQuad);
+            leaves->push_back(element.mPatch);
+        }
+    }
+}
+
+void HierarchicalSolver::RefinePair(uint32_t a, uint32_t b)
+{
+    float ab;
+    float ba;
+    bool behindA;
+    bool behindB;
+
+    if (!Estimate(mElements.at(a).mPatch, mElements.at(b).mPatch, ab, ba,
+                  behindA, behindB))
+    {
+        return;
+    }
+
+    // Splitting an element that reaches behind the other separates the
+    // part that faces it from the part that does not. Otherwise, by
+    // reciprocity the larger element has the larger form factor from the
+    // other, so split it first.
+    uint32_t larger = a;
+    uint32_t smaller = b;
+
+    if (mElements.at(b).mPatch->GetArea() >
+        mElements.at(a).mPatch->GetArea())
+    {
+        std::swap(larger, smaller);
+    }
+
+    int64_t split = -1;
+
+    if (behindA || behindB)
+    {
+        if (behindA && CanSubdivide(a))
+        {
+            split = a;
+        }
+        else if (behindB && CanSubdivide(b))
+        {
+            split = b;
+        }
+    }
+    else if (std::max(ab, ba) > mThreshold)
+    {
+        if (CanSubdivide(larger))
+        {
+            split = larger;
+        }
+        else if (CanSubdivide(smaller))
+        {
+            split = smaller;
+        }
+    }
+
+    if (split >= 0)
+    {
+        Subdivide(split);
+
+        int32_t first = mElements.at(split).mChildren;
+
+        for (int32_t child = first; child < first + 4; ++child)
+        {
+            if (split == a)
+            {
+                RefinePair(child, b);
+            }
+            else
+            {
+                RefinePair(a, child);
+            }
+        }
+
+        return;
+    }
+
+    if ((ab == 0) && (ba == 0))
+    {
+        return;
+    }
+
+    float visible = Visibility(a, b);
+
+    if (visible == 0)
+    {
+        return;
+    }
+
+    Link toB = { b, ab * visible };
+    Link toA = { a, ba * visible };
+
+    mElements.at(a).mLinks.push_back(toB);
+    mElements.at(b).mLinks.push_back(toA);
+}
+
+bool HierarchicalSolver::Estimate(const Patch *a, const Patch *b,
+                                  float &ab, float &ba, bool &behindA,
+                                  bool &behindB) const
+{
+    const Point *cornersA[4] = { a->GetA(), a->GetB(), a->GetC(), a->GetD() };
+    const Point *cornersB[4] = { b->GetA(), b->GetB(), b->GetC(), b->GetD() };
+
+    float tolerance = PLANE_TOLERANCE *
+                      std::sqrt(std::max(a->GetArea(), b->GetArea()));
+
+    // Count the corners of each element in front of and behind the other
+    int frontA = 0;
+    int backA = 0;
+    int frontB = 0;
+    int backB = 0;
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        float distanceA = dotProduct(Vector(*cornersA[corner], *b->GetA()),
+                                     b->GetNormal());
+        float distanceB = dotProduct(Vector(*cornersB[corner], *a->GetA()),
+                                     a->GetNormal());
+
+        frontA += (distanceA > tolerance);
+        backA += (distanceA < -tolerance);
+        frontB += (distanceB > tolerance);
+        backB += (distanceB < -tolerance);
+    }
+
+    if ((frontA == 0) || (frontB == 0))
+    {
+        return false;
+    }
+
+    behindA = (backA > 0);
+    behindB = (backB > 0);
+
+    if (!behindA && !behindB)
+    {
+        ab = b->PointFormFactor(a->GetCenter(), a->GetNormal());
+        ba = a->PointFormFactor(b->GetCenter(), b->GetNormal());
+        return true;
+    }
+
+    // Only part of the one faces the other; treat them as small disks at
+    // their centers, seen at the cosines clamped to the front.
+    Vector between(b->GetCenter(), a->GetCenter());
+    float squared = dotProduct(between, between);
+    float distance = std::sqrt(squared);
+
+    float cosineA = std::max(0.0f, dotProduct(between, a->GetNormal())) /
+                    distance;
+    float cosineB = std::max(0.0f, -dotProduct(between, b->GetNormal())) /
+                    distance;
+
+    ab = cosineA * cosineB * b->GetArea() / (PI * squared + b->GetArea());
+    ba = cosineA * cosineB * a->GetArea() / (PI * squared + a->GetArea());
+
+    return true;
+}
+
+float HierarchicalSolver::Visibility(uint32_t a, uint32_t b) const
+{
+    const Element &elementA = mElements.at(a);
+    const Element &elementB = mElements.at(b);
+
+    const Point &centerA = elementA.mPatch->GetCenter();
+    const Point &centerB = elementB.mPatch->GetCenter();
+    const Vector &normalA = elementA.mPatch->GetNormal();
+    const Vector &normalB = elementB.mPatch->GetNormal();
+
+    int visible = 0;
+
+    // Join the centers of matching quarters of the two elements
+    for (int ray = 0; ray < VISIBILITY_RAYS; ++ray)
+    {
+        const Point &cornerA = mMesh->GetVertex(elementA.mCorners[ray]);
+        const Point &cornerB = mMesh->GetVertex(elementB.mCorners[ray]);
+
+        Point from = scalarMultiply(Vector(cornerA, centerA),
+                                    0.5f).Translate(centerA);
+        Point to = scalarMultiply(Vector(cornerB, centerB),
+                                  0.5f).Translate(centerB);
+
+        Vector direction(to, from);
+
+        // Points behind either element cannot see each other
+        if ((dotProduct(direction, normalA) <= 0) ||
+            (dotProduct(direction, normalB) >= 0))
+        {
+            continue;
+        }
+
+        float distance = std::sqrt(dotProduct(direction, direction));
+        normalize(direction);
+
+        if (!mBvh->Occluded(direction, from, distance, elementA.mQuad,
+                            elementB.mQuad))
+        {
+            ++visible;
+        }
+    }
+
+    return float(visible) / VISIBILITY_RAYS;
+}
+
+bool HierarchicalSolver::CanSubdivide(uint32_t element) const
+{
+    const uint32_t *corners = mElements.at(element).mCorners;
+    const Point &a = mMesh->GetVertex(corners[0]);
+    const Point &b = mMesh->GetVertex(corners[1]);
+    const Point &c = mMesh->GetVertex(corners[2]);
+
+    return std::max(a.DistanceTo(b), b.DistanceTo(c)) > mMinimumSize;
+}
+
+uint32_t HierarchicalSolver::Midpoint(uint32_t p, uint32_t q)
+{
+    const Point &from = mMesh->GetVertex(p);
+    Point midpoint = scalarMultiply(Vector(mMesh->GetVertex(q), from), 0.5f).
+                     Translate(from);
+
+    return mMesh->Weld(midpoint, mMesh->GetNormal(p));
+}
+
+void HierarchicalSolver::Subdivide(uint32_t element)
+{
+    if (mElements.at(element).mChildren >= 0)
+    {
+        return;
+    }
+
+    uint32_t a = mElements.at(element).mCorners[0];
+    uint32_t b = mElements.at(element).mCorners[1];
+    uint32_t c = mElements.at(element).mCorners[2];
+    uint32_t d = mElements.at(element).mCorners[3];
+    uint32_t quad = mElements.at(element).mQuad;
+
+    // Neighbouring elements share the midpoints of the edges they share
+    uint32_t ab = Midpoint(a, b);
+    uint32_t bc = Midpoint(b, c);
+    uint32_t cd = Midpoint(c, d);
+    uint32_t da = Midpoint(d, a);
+    uint32_t middle = Midpoint(a, c);
+
+    // Each quarter keeps the winding, and so the normal, of the element
+    uint32_t quarters[4][4] =
+    {
+        { a, ab, middle, da },
+        { ab, b, bc, middle },
+        { middle, bc, c, cd },
+        { da, middle, cd, d }
+    };
+
+    int32_t first = mElements.size();
+    Rectangle *rectangle = mQuads->at(quad);
+
+    for (int quarter = 0; quarter < 4; ++quarter)
+    {
+        Element child;
+        std::copy(quarters[quarter], quarters[quarter] + 4, child.mCorners);
+        child.mQuad = quad;
+        child.mChildren = -1;
+        child.mLeaf = -1;
+        child.mPatch = mArena->New<Patch>(mMesh, child.mCorners[0],
+            child.mCorners[1], child.mCorners[2], child.mCorners[3],
+            rectangle->GetColor(), rectangle->emission);
+
+        mElements.push_back(child);
+    }
+
+    mElements.at(element).mChildren = first;
+}
+
+void HierarchicalSolver::Gather()
+{
+    ThreadPool::RangeTask task =
+        [this](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for (std::size_t index = begin; index < end; ++index)
+            {
+                const std::vector<Link> &links = mElements[index].mLinks;
+
+                for (unsigned int channel = 0; channel < 3; ++channel)
+                {
+                    const float *exidence = mExidence[channel].data();
+                    float gathered = 0;
+
+                    for (unsigned int link = 0; link < links.size(); ++link)
+                    {
+                        gathered += links[link].mFactor *
+                                    exidence[links[link].mSource];
+                    }
+
+                    mGathered[channel][index] = gathered;
+                }
+            }
+        };
+
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(mElements.size(), 256, task);
+    }
+    else
+    {
+        task(0, mElements.size(), 0);
+    }
+}
+
+void HierarchicalSolver::PushPull(uint32_t element, const float above[3],
+                                  PatchStore *store, Residual &residual)
+{
+    const Element &node = mElements[element];
+
+    float arriving[3];
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        arriving[channel] = above[channel] + mGathered[channel][element];
+    }
+
+    if (node.mChildren < 0)
+    {
+        for (unsigned int channel = 0; channel < 3; ++channel)
+        {
+            float updated = store->Emission(channel)[node.mLeaf] +
+                            store->Reflectance(channel)[node.mLeaf] *
+                            arriving[channel];
+
+            residual.Add(mExidence[channel][element], updated);
+
+            mExidence[channel][element] = updated;
+            store->Exidence(channel)[node.mLeaf] = updated;
+            store->Incidence(channel)[node.mLeaf] = arriving[channel];
+        }
+
+        return;
+    }
+
+    float pulled[3] = { 0, 0, 0 };
+    float area = 0;
+
+    for (int32_t child = node.mChildren; child < node.mChildren + 4; ++child)
+    {
+        PushPull(child, arriving, store, residual);
+
+        float childArea = mElements[child].mPatch->GetArea();
+
+        for (unsigned int channel = 0; channel < 3; ++channel)
+        {
+            pulled[channel] += childArea * mExidence[channel][child];
+        }
+
+        area += childArea;
+    }
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        mExidence[channel][element] = pulled[channel] / area;
+    }
+}
+
+int HierarchicalSolver::CalculateRadiosity(PatchStore *store,
+                                           int numIterations)
+{
+    const float nothing[3] = { 0, 0, 0 };
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        mExidence[channel].assign(mElements.size(), 0);
+        mGathered[channel].assign(mElements.size(), 0);
+    }
+
+    // Nothing has been gathered yet, so this leaves the emission at the
+    // leaves and averages it up the trees.
+    Residual start(mNorm);
+
+    for (uint32_t root = 0; root < mQuads->size(); ++root)
+    {
+        PushPull(root, nothing, store, start);
+    }
+
+    int iteration = 0;
+
+    while (iteration < numIterations)
+    {
+        Gather();
+
+        Residual residual(mNorm);
+
+        for (uint32_t root = 0; root < mQuads->size(); ++root)
+        {
+            PushPull(root, nothing, store, residual);
+        }
+
+        ++iteration;
+
+        std::cout << "Iteration " << iteration << ": residual "
+                  << residual.Value() << std::endl;
+
+        if (residual.Value() < mTolerance)
+        {
+            break;
+        }
+    }
+
+    return iteration;
+}
+
+}   // namespace Radiosity
@@ -0,0 +1,565 @@
+///
+/// @file MeshRefiner.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Adapts the patches of a solved scene to its lighting: patches whose
+///     exidence differs strongly from a neighbour are split, and flat
+///     blocks of patches are merged, reusing as many form factors of the
+///     old patches as the new geometry allows.
+///
+
+#include "meshrefiner.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Fraction of the split threshold below which the differences within a
+// block must all stay for it to be merged; the gap keeps a patch from
+// being merged right after it was split
+#define MERGE_FRACTION 0.25f
+
+// Distance, relative to the size of a patch, within which two edges count
+// as touching
+#define EDGE_TOLERANCE 1e-3f
+
+namespace Radiosity
+{
+
+MeshRefiner::MeshRefiner(std::vector<Rectangle*> *quads, Mesh *mesh,
+                         Arena *arena):
+    mQuads(quads),
+    mMesh(mesh),
+    mArena(arena),
+    mThreshold(DEFAULT_GRADIENT),
+    mSplit(0),
+    mMerged(0)
+{
+}
+
+MeshRefiner::~MeshRefiner()
+{
+}
+
+void MeshRefiner::SetThreshold(float threshold)
+{
+    mThreshold = threshold;
+}
+
+bool MeshRefiner::Refine(const std::vector<Patch*> *patches,
+                         const PatchStore *store,
+                         std::vector<Patch*> *refined)
+{
+    uint32_t count = patches->size();
+
+    // Place every patch within its quad
+    std::vector<Extent> extents(count);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        const Patch *patch = patches->at(index);
+        const Rectangle *quad = mQuads->at(patch->GetParent());
+
+        Point origin = quad->A();
+        Vector u(quad->B(), origin);
+        Vector v(quad->D(), origin);
+        normalize(u);
+        normalize(v);
+
+        const Point *corners[4] =
+            { patch->GetA(), patch->GetB(), patch->GetC(), patch->GetD() };
+
+        Extent &extent = extents.at(index);
+        extent.mU0 = extent.mV0 = INFINITY;
+        extent.mU1 = extent.mV1 = -INFINITY;
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            Vector offset(*corners[corner], origin);
+            float s = dotProduct(offset, u);
+            float t = dotProduct(offset, v);
+
+            extent.mU0 = std::min(extent.mU0, s);
+            extent.mU1 = std::max(extent.mU1, s);
+            extent.mV0 = std::min(extent.mV0, t);
+            extent.mV1 = std::max(extent.mV1, t);
+        }
+    }
+
+    std::vector< std::vector<uint32_t> > right(count);
+    std::vector< std::vector<uint32_t> > above(count);
+    FindNeighbours(patches, extents, true, right);
+    FindNeighbours(patches, extents, false, above);
+
+    // Largest difference in exidence between each patch and its neighbours
+    std::vector<float> brightness(count, 0);
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        const float *exidence = store->Exidence(channel);
+
+        for (uint32_t index = 0; index < count; ++index)
+        {
+            brightness[index] += exidence[index];
+        }
+    }
+
+    std::vector<float> contrast(count, 0);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            const std::vector<uint32_t> &neighbours =
+                side == 0 ? right.at(index) : above.at(index);
+
+            for (uint32_t other : neighbours)
+            {
+                float brighter = std::max(brightness[index],
+                                          brightness[other]);
+
+                if (brighter <= 0)
+                {
+                    continue;
+                }
+
+                float difference =
+                    std::fabs(brightness[index] - brightness[other]) /
+                    brighter;
+
+                contrast[index] = std::max(contrast[index], difference);
+                contrast[other] = std::max(contrast[other], difference);
+            }
+        }
+    }
+
+    // Gather blocks of four flat patches of the same size, stored as the
+    // patches at A, B, C and D of the merged patch
+    std::vector<int32_t> block(count, -1);
+    std::vector< std::vector<uint32_t> > blocks;
+
+    auto flat = [&](uint32_t index)
+    {
+        return block[index] < 0 &&
+               contrast[index] < mThreshold * MERGE_FRACTION;
+    };
+
+    auto same = [&](uint32_t index, uint32_t other, bool alongU)
+    {
+        const Extent &a = extents.at(index);
+        const Extent &b = extents.at(other);
+        float tolerance = EDGE_TOLERANCE *
+            std::min(a.mU1 - a.mU0, a.mV1 - a.mV0);
+
+        return alongU ?
+            std::fabs(a.mV0 - b.mV0) < tolerance &&
+            std::fabs(a.mV1 - b.mV1) < tolerance &&
+            std::fabs((a.mU1 - a.mU0) - (b.mU1 - b.mU0)) < tolerance :
+            std::fabs(a.mU0 - b.mU0) < tolerance &&
+            std::fabs(a.mU1 - b.mU1) < tolerance &&
+            std::fabs((a.mV1 - a.mV0) - (b.mV1 - b.mV0)) < tolerance;
+    };
+
+    auto partner = [&](uint32_t index, bool alongU)
+    {
+        const std::vector<uint32_t> &neighbours =
+            alongU ? right.at(index) : above.at(index);
+
+        for (uint32_t other : neighbours)
+        {
+            if (flat(other) && same(index, other, alongU))
+            {
+                return static_cast<int64_t>(other);
+            }
+        }
+
+        return static_cast<int64_t>(-1);
+    };
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        if (!flat(index))
+        {
+            continue;
+        }
+
+        int64_t b = partner(index, true);
+        int64_t d = partner(index, false);
+
+        if (b < 0 || d < 0)
+        {
+            continue;
+        }
+
+        int64_t c = partner(d, true);
+
+        if (c < 0 || c == b ||
+            !same(b, c, false))
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> members = { index, static_cast<uint32_t>(b),
+                                          static_cast<uint32_t>(c),
+                                          static_cast<uint32_t>(d) };
+
+        for (uint32_t member : members)
+        {
+            block[member] = blocks.size();
+        }
+
+        blocks.push_back(members);
+    }
+
+    // Lay out the refined patches in the order of the old ones
+    refined->clear();
+    mOrigins.clear();
+    mSuccessor.assign(count, 0);
+    mSuccessors.assign(count, 1);
+    mSplit = 0;
+    mMerged = 0;
+
+    std::vector<bool> emitted(blocks.size(), false);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        const Patch *patch = patches->at(index);
+        Origin origin;
+        origin.mOld[0] = index;
+        origin.mCount = 1;
+        origin.mKept = false;
+
+        if (block[index] >= 0)
+        {
+            const std::vector<uint32_t> &members = blocks.at(block[index]);
+
+            if (!emitted.at(block[index]))
+            {
+                emitted.at(block[index]) = true;
+
+                Rectangle *quad = mQuads->at(patch->GetParent());
+                Patch *merged = mArena->New<Patch>(mMesh,
+                    patches->at(members[0])->GetCorners()[0],
+                    patches->at(members[1])->GetCorners()[1],
+                    patches->at(members[2])->GetCorners()[2],
+                    patches->at(members[3])->GetCorners()[3],
+                    quad->GetColor(), quad->emission);
+                merged->SetParent(patch->GetParent());
+
+                std::copy(members.begin(), members.end(), origin.mOld);
+                origin.mCount = 4;
+
+                for (uint32_t member : members)
+                {
+                    mSuccessor.at(member) = refined->size();
+                }
+
+                refined->push_back(merged);
+                mOrigins.push_back(origin);
+                ++mMerged;
+            }
+        }
+        else if (contrast[index] > mThreshold)
+        {
+            mSuccessor.at(index) = refined->size();
+            mSuccessors.at(index) = 4;
+
+            Split(patch, refined);
+            mOrigins.insert(mOrigins.end(), 4, origin);
+            ++mSplit;
+        }
+        else
+        {
+            mSuccessor.at(index) = refined->size();
+            origin.mKept = true;
+
+            refined->push_back(patches->at(index));
+            mOrigins.push_back(origin);
+        }
+    }
+
+    for (uint32_t index = 0; index < refined->size(); ++index)
+    {
+        refined->at(index)->SetIndex(index);
+    }
+
+    return mSplit > 0 || mMerged > 0;
+}
+
+void MeshRefiner::FindNeighbours(const std::vector<Patch*> *patches,
+                                 const std::vector<Extent> &extents,
+                                 bool alongU,
+                                 std::vector< std::vector<uint32_t> >
+                                     &neighbours) const
+{
+    auto start = [&](uint32_t index)
+    {
+        return alongU ? extents.at(index).mU0 : extents.at(index).mV0;
+    };
+
+    // Patches of each quad, by where they start along the direction
+    std::vector< std::vector<uint32_t> > byQuad(mQuads->size());
+
+    for (uint32_t index = 0; index < patches->size(); ++index)
+    {
+        byQuad.at(patches->at(index)->GetParent()).push_back(index);
+    }
+
+    for (std::vector<uint32_t> &group : byQuad)
+    {
+        std::sort(group.begin(), group.end(),
+                  [&](uint32_t a, uint32_t b)
+                  { return start(a) < start(b); });
+
+        for (uint32_t index : group)
+        {
+            const Extent &extent = extents.at(index);
+            float end = alongU ? extent.mU1 : extent.mV1;
+            float tolerance = EDGE_TOLERANCE *
+                std::min(extent.mU1 - extent.mU0, extent.mV1 - extent.mV0);
+
+            std::vector<uint32_t>::iterator other =
+                std::lower_bound(group.begin(), group.end(), end - tolerance,
+                                 [&](uint32_t a, float value)
+                                 { return start(a) < value; });
+
+            for (; other != group.end() && start(*other) <= end + tolerance;
+                 ++other)
+            {
+                const Extent &next = extents.at(*other);
+
+                // The edges must overlap across the direction, not just
+                // meet at a corner
+                float overlap = alongU ?
+                    std::min(extent.mV1, next.mV1) -
+                    std::max(extent.mV0, next.mV0) :
+                    std::min(extent.mU1, next.mU1) -
+                    std::max(extent.mU0, next.mU0);
+
+                if (overlap > tolerance)
+                {
+                    neighbours.at(index).push_back(*other);
+                }
+            }
+        }
+    }
+}
+
+void MeshRefiner::Split(const Patch *patch,
+                        std::vector<Patch*> *refined) const
+{
+    uint32_t a = patch->GetCorners()[0];
+    uint32_t b = patch->GetCorners()[1];
+    uint32_t c = patch->GetCorners()[2];
+    uint32_t d = patch->GetCorners()[3];
+
+    // Quarters of neighbouring patches share the midpoints of the edges
+    // the patches share
+    auto midpoint = [this](uint32_t p, uint32_t q)
+    {
+        const Point &from = mMesh->GetVertex(p);
+        Point middle = scalarMultiply(Vector(mMesh->GetVertex(q), from),
+                                      0.5f).Translate(from);
+
+        return mMesh->Weld(middle, mMesh->GetNormal(p));
+    };
+
+    uint32_t ab = midpoint(a, b);
+    uint32_t bc = midpoint(b, c);
+    uint32_t cd = midpoint(c, d);
+    uint32_t da = midpoint(d, a);
+    uint32_t middle = midpoint(a, c);
+
+    // Each quarter keeps the winding, and so the normal, of the patch
+    uint32_t quarters[4][4] =
+    {
+        { a, ab, middle, da },
+        { ab, b, bc, middle },
+        { middle, bc, c, cd },
+        { da, middle, cd, d }
+    };
+
+    Rectangle *quad = mQuads->at(patch->GetParent());
+
+    for (int quarter = 0; quarter < 4; ++quarter)
+    {
+        Patch *child = mArena->New<Patch>(mMesh,
+            quarters[quarter][0], quarters[quarter][1],
+            quarters[quarter][2], quarters[quarter][3],
+            quad->GetColor(), quad->emission);
+        child->SetParent(patch->GetParent());
+        refined->push_back(child);
+    }
+}
+
+void MeshRefiner::CarryFormFactors(const FormFactorMatrix &formFactors,
+                                   std::vector<Patch*> *refined,
+                                   FormCalculator *calculator,
+                                   FormFactorMatrix *result) const
+{
+    unsigned int count = refined->size();
+    result->Reset(count);
+
+    // Rows carried over come from the old matrix. In DERIVE mode merged
+    // patches may be derived instead of traced: the rows carried over
+    // hold their columns whatever they trace. Quarters are always traced,
+    // since the rows carried over are shared among them by their rows.
+    std::vector<bool> derivable(count, false);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        derivable.at(index) = mOrigins.at(index).mCount == 4;
+    }
+
+    std::vector<bool> staged;
+    calculator->ChooseTraced(refined, derivable, staged);
+
+    std::vector<uint32_t> traced;
+    std::vector<uint32_t> derived;
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        if (!staged.at(index))
+        {
+            derived.push_back(index);
+        }
+        else if (!mOrigins.at(index).mKept)
+        {
+            traced.push_back(index);
+        }
+    }
+
+    calculator->TraceRows(refined, traced, result);
+
+    const uint32_t *columns = formFactors.Columns();
+    const float *values = formFactors.Values();
+    std::vector<FormFactorMatrix::Entry> row;
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        const Origin &origin = mOrigins.at(index);
+
+        if (!origin.mKept)
+        {
+            continue;
+        }
+
+        row.clear();
+
+        for (uint32_t entry = formFactors.RowBegin(origin.mOld[0]);
+             entry < formFactors.RowEnd(origin.mOld[0]); ++entry)
+        {
+            uint32_t first = mSuccessor.at(columns[entry]);
+            float factor = values[entry];
+
+            if (mSuccessors.at(columns[entry]) == 1)
+            {
+                row.push_back(FormFactorMatrix::Entry(first, factor));
+                continue;
+            }
+
+            // A_q F_q,i = A_i F_i,q for every quarter q, so each quarter
+            // takes the share of the patch that it sees of this one
+            float weights[4];
+            float total = 0;
+            float area = 0;
+
+            for (uint32_t quarter = 0; quarter < 4; ++quarter)
+            {
+                float quarterArea = refined->at(first + quarter)->GetArea();
+                weights[quarter] = quarterArea *
+                    result->GetStaged(first + quarter, index);
+                total += weights[quarter];
+                area += quarterArea;
+            }
+
+            for (uint32_t quarter = 0; quarter < 4; ++quarter)
+            {
+                float share = total > 0 ? weights[quarter] / total :
+                    refined->at(first + quarter)->GetArea() / area;
+
+                row.push_back(FormFactorMatrix::Entry(first + quarter,
+                                                      factor * share));
+            }
+        }
+
+        // Patches merged into one share a column
+        std::sort(row.begin(), row.end());
+        std::vector<FormFactorMatrix::Entry>::iterator last = row.begin();
+
+        for (std::vector<FormFactorMatrix::Entry>::iterator entry =
+                 row.begin(); entry != row.end(); ++entry)
+        {
+            if (entry != last && entry->first == last->first)
+            {
+                last->second += entry->second;
+            }
+            else if (entry != last)
+            {
+                *(++last) = *entry;
+            }
+        }
+
+        if (!row.empty())
+        {
+            row.erase(last + 1, row.end());
+        }
+
+        result->SetRow(index, row);
+    }
+
+    calculator->DeriveRows(refined, derived, result);
+
+    result->Compress();
+
+    calculator->MeasureReciprocity(refined, result);
+}
+
+void MeshRefiner::CarryVisibility(std::vector<uint32_t> &previous) const
+{
+    previous.resize(mOrigins.size());
+
+    for (uint32_t index = 0; index < mOrigins.size(); ++index)
+    {
+        const Origin &origin = mOrigins.at(index);
+        previous.at(index) = origin.mKept ? origin.mOld[0] : NO_PREVIOUS_ROW;
+    }
+}
+
+void MeshRefiner::CarryExidence(const PatchStore &store,
+                                PatchStore *refined) const
+{
+    const float *area = store.Area();
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        const float *exidence = store.Exidence(channel);
+        float *carried = refined->Exidence(channel);
+
+        for (uint32_t index = 0; index < mOrigins.size(); ++index)
+        {
+            const Origin &origin = mOrigins.at(index);
+
+            if (origin.mCount == 1)
+            {
+                carried[index] = exidence[origin.mOld[0]];
+                continue;
+            }
+
+            float power = 0;
+            float total = 0;
+
+            for (unsigned int old = 0; old < origin.mCount; ++old)
+            {
+                power += exidence[origin.mOld[old]] * area[origin.mOld[old]];
+                total += area[origin.mOld[old]];
+            }
+
+            carried[index] = power / total;
+        }
+    }
+}
+
+}   // namespace Radiosity
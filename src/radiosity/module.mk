@@ -1,5 +1,13 @@
 SOURCE += formcalculator.cpp
+SOURCE += formfactormatrix.cpp
+SOURCE += hierarchicalsolver.cpp
+SOURCE += meshrefiner.cpp
 SOURCE += patchcalculator.cpp
+SOURCE += patchstore.cpp
+SOURCE += progressivesolver.cpp
 SOURCE += radiositycalculator.cpp
 SOURCE += radiosity.cpp
+SOURCE += residual.cpp
+SOURCE += shooterqueue.cpp
 SOURCE += sightcalculator.cpp
+SOURCE += visibilitymatrix.cpp
@@ -10,11 +10,18 @@
 
 #include "patchcalculator.h"
 
+#include <algorithm>
+
+// Rows of corners, or of patches, handed to a thread at a time
+#define ROW_GRAIN 4
+
 namespace Radiosity
 {
 
-PatchCalculator::PatchCalculator(float patchSize):
-    mPatchSize(patchSize)
+PatchCalculator::PatchCalculator(float patchSize, Arena *arena):
+    mPatchSize(patchSize),
+    mArena(arena),
+    mPool(nullptr)
 {
 }
 
@@ -22,15 +29,24 @@ PatchCalculator::~PatchCalculator()
 {
 }
 
-void PatchCalculator::Subdivide(std::vector<Rectangle*> *quads,
-                                std::vector<Patch*> *patches)
+void PatchCalculator::SetThreadPool(ThreadPool *pool)
 {
-    std::vector<Rectangle*>::iterator iter = quads->begin();
+    mPool = pool;
+}
 
-    // For each quad
-    for (; iter != quads->end(); ++iter)
+void PatchCalculator::Plan(std::vector<Rectangle*> *quads,
+                           std::vector<Layout> &layouts,
+                           std::vector<Point> &rowStarts,
+                           std::vector<uint32_t> &rowQuads) const
+{
+    std::size_t corners = 0;
+    std::size_t patches = 0;
+
+    layouts.reserve(quads->size());
+
+    for (unsigned int index = 0; index < quads->size(); ++index)
     {
-        Rectangle *quad = *iter;
+        Rectangle *quad = quads->at(index);
 
         // Calculate the number of patches along one axis
         float distance_i = quad->A().DistanceTo(quad->B());
@@ -54,81 +70,197 @@ void PatchCalculator::Subdivide(std::vector<Rectangle*> *quads,
             ++size_j;
         }
 
-        // Create a two-dimensional vector to hold points
-        std::vector< std::vector<Point*> > points(size_i + 1, std::vector<Point*>(size_j + 1,
-            (Point*)nullptr));
-
-        Vector AB((*iter)->B(), (*iter)->A());
-        Vector AD((*iter)->D(), (*iter)->A());
-        float len_AB = (*iter)->B().DistanceTo((*iter)->A());
-        float len_AD = (*iter)->D().DistanceTo((*iter)->A());
+        Vector AB(quad->B(), quad->A());
+        Vector AD(quad->D(), quad->A());
+        float len_AB = quad->B().DistanceTo(quad->A());
+        float len_AD = quad->D().DistanceTo(quad->A());
 
         normalize(AB);
         normalize(AD);
 
-        Point *p1;
+        Layout layout;
+        layout.mSizeI = size_i;
+        layout.mSizeJ = size_j;
+        layout.mAB = AB;
+        layout.mLengthAB = len_AB;
+        layout.mNormal = quad->Normal();
+        layout.mFirstCorner = corners;
+        layout.mFirstRow = rowStarts.size();
+        layout.mFirstPatch = patches;
+        layouts.push_back(layout);
+
+        corners += std::size_t(size_i + 1) * (size_j + 1);
+        patches += std::size_t(size_i) * size_j;
 
-        // Create the starting point
-        p1 = new Point((*iter)->A());
+        // Step along AD to the start of every row
+        Point p1 = quad->A();
 
-        // Loop in AD direction
         for (int j = 0; j <= size_j; ++j)
         {
-            // add p1 to the list
-            points.at(0).at(j) = p1;
+            rowStarts.push_back(p1);
+            rowQuads.push_back(index);
+
+            if (j == size_j - 1)
+            {
+                p1 = scalarMultiply(AD, len_AD).Translate(quad->A());
+            }
+            else
+            {
+                p1 = scalarMultiply(AD, mPatchSize).Translate(p1);
+            }
+        }
+    }
+
+}   // Plan
+
+void PatchCalculator::Subdivide(std::vector<Rectangle*> *quads,
+                                std::vector<Patch*> *patches, Mesh *mesh)
+{
+    std::vector<Layout> layouts;
+    std::vector<Point> rowStarts;
+    std::vector<uint32_t> rowQuads;
+
+    Plan(quads, layouts, rowStarts, rowQuads);
+
+    if (layouts.empty())
+    {
+        return;
+    }
 
-            Point *p2 = p1;
+    const Layout &last = layouts.back();
+    std::size_t cornerCount = last.mFirstCorner +
+        std::size_t(last.mSizeI + 1) * (last.mSizeJ + 1);
+    std::size_t patchCount = last.mFirstPatch +
+        std::size_t(last.mSizeI) * last.mSizeJ;
+    std::size_t rowCount = rowStarts.size();
 
-            // Loop in AB direction
-            for (int i = 0; i < size_i; ++i)
+    // Step along AB across every row, each row on its own
+    std::vector<Point> corners(cornerCount);
+
+    ThreadPool::RangeTask walk =
+        [&](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for (std::size_t row = begin; row < end; ++row)
             {
-                Point *p3;
+                const Layout &layout = layouts[rowQuads[row]];
+                int j = row - layout.mFirstRow;
+                Point *points = &corners[layout.mFirstCorner +
+                                         std::size_t(j) * (layout.mSizeI + 1)];
 
-                // Check boundary
-                if (i == size_i - 1)
-                {
-                    p3 = new Point(scalarMultiply(AB, len_AB).Translate(*p1));
-                }
-                else
+                const Point &p1 = rowStarts[row];
+                Point p2 = p1;
+                points[0] = p1;
+
+                for (int i = 0; i < layout.mSizeI; ++i)
                 {
-                    p3 = new Point(scalarMultiply(AB, mPatchSize).Translate(*p2));
-                }
+                    Point p3;
 
-                // add p3 to the list
-                points.at(i+1).at(j) = p3;
+                    // Check boundary
+                    if (i == layout.mSizeI - 1)
+                    {
+                        p3 = scalarMultiply(layout.mAB,
+                                            layout.mLengthAB).Translate(p1);
+                    }
+                    else
+                    {
+                        p3 = scalarMultiply(layout.mAB,
+                                            mPatchSize).Translate(p2);
+                    }
 
-                // Update p2
-                p2 = p3;
-            }
+                    points[i + 1] = p3;
 
-            // Update p1
-            if (j == size_j - 1)
-            {
-                p1 = new Point(scalarMultiply(AD, len_AD).Translate((*iter)->A()));
+                    // Update p2
+                    p2 = p3;
+                }
             }
-            else
+        };
+
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(rowCount, ROW_GRAIN, walk);
+    }
+    else
+    {
+        walk(0, rowCount, 0);
+    }
+
+    // Corners on the edge of a quad may land on corners of another quad
+    // in the same plane and are welded; those inside it are new, and are
+    // only added
+    std::vector<uint32_t> vertices(cornerCount);
+
+    for (unsigned int index = 0; index < layouts.size(); ++index)
+    {
+        const Layout &layout = layouts[index];
+        std::size_t corner = layout.mFirstCorner;
+
+        for (int j = 0; j <= layout.mSizeJ; ++j)
+        {
+            for (int i = 0; i <= layout.mSizeI; ++i, ++corner)
             {
-                p1 = new Point(scalarMultiply(AD, mPatchSize).Translate(*p1));
+                if (i == 0 || i == layout.mSizeI ||
+                    j == 0 || j == layout.mSizeJ)
+                {
+                    vertices[corner] = mesh->Weld(corners[corner],
+                                                  layout.mNormal);
+                }
+                else
+                {
+                    vertices[corner] = mesh->Add(corners[corner],
+                                                 layout.mNormal);
+                }
             }
         }
+    }
+
+    // Build the patches of every row straight into one array, each at the
+    // position the counts above gave it
+    std::size_t firstIndex = patches->size();
+    Patch *storage = mArena->Array<Patch>(patchCount);
+    patches->resize(firstIndex + patchCount);
 
-        // Create the patches
-        // Loop in AD direction
-        for (int j = 0; j < size_j; ++j)
+    ThreadPool::RangeTask build =
+        [&](std::size_t begin, std::size_t end, unsigned int)
         {
-            // Loop in AB direction
-            for (int i = 0; i < size_i; ++i)
+            for (std::size_t row = begin; row < end; ++row)
             {
-                Point *A = points.at(i).at(j);
-                Point *B = points.at(i+1).at(j);
-                Point *C = points.at(i+1).at(j+1);
-                Point *D = points.at(i).at(j+1);
-
-                // Create the patch
-                Patch *p = new Patch(A, B, C, D, quad->GetColor(), quad->emission);
-                patches->push_back(p);
+                uint32_t parent = rowQuads[row];
+                const Layout &layout = layouts[parent];
+                int j = row - layout.mFirstRow;
+
+                // The last row of corners closes the patches of the one
+                // before it
+                if (j == layout.mSizeJ)
+                {
+                    continue;
+                }
+
+                Rectangle *quad = quads->at(parent);
+                const uint32_t *lower = &vertices[layout.mFirstCorner +
+                    std::size_t(j) * (layout.mSizeI + 1)];
+                const uint32_t *upper = lower + layout.mSizeI + 1;
+                std::size_t slot = layout.mFirstPatch +
+                                   std::size_t(j) * layout.mSizeI;
+
+                for (int i = 0; i < layout.mSizeI; ++i, ++slot)
+                {
+                    Patch *p = new (&storage[slot]) Patch(mesh,
+                        lower[i], lower[i + 1], upper[i + 1], upper[i],
+                        quad->GetColor(), quad->emission);
+                    p->SetIndex(firstIndex + slot);
+                    p->SetParent(parent);
+                    (*patches)[firstIndex + slot] = p;
+                }
             }
-        }
+        };
+
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(rowCount, ROW_GRAIN, build);
+    }
+    else
+    {
+        build(0, rowCount, 0);
     }
 
 }   // Subdivide
@@ -0,0 +1,78 @@
+///
+/// @file PatchStore.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Radiometric state of all patches in a scene, laid out as one array
+///     per quantity so the solver streams through contiguous memory.
+///
+
+#define COLOR_BLENDING
+
+#include "patchstore.h"
+
+namespace Radiosity
+{
+
+PatchStore::PatchStore(std::vector<Patch*> *patches)
+{
+    unsigned int count = patches->size();
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        mExidence[channel].resize(count);
+        mNextExidence[channel].resize(count);
+        mIncidence[channel].assign(count, 0);
+        mReflectance[channel].resize(count);
+        mEmission[channel].resize(count);
+    }
+
+    mArea.resize(count);
+
+    for (unsigned int index = 0; index < count; ++index)
+    {
+        Patch *patch = patches->at(index);
+
+#ifdef COLOR_BLENDING
+        Color reflectance = patch->GetColor() * patch->GetReflectance();
+#else
+        Color reflectance(patch->GetReflectance(), patch->GetReflectance(),
+                          patch->GetReflectance());
+#endif
+        const Color &emission = patch->GetEmission();
+
+        mReflectance[0][index] = reflectance.R();
+        mReflectance[1][index] = reflectance.G();
+        mReflectance[2][index] = reflectance.B();
+
+        mEmission[0][index] = emission.R();
+        mEmission[1][index] = emission.G();
+        mEmission[2][index] = emission.B();
+
+        mArea[index] = patch->GetArea();
+
+        patch->SetStore(this);
+    }
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        mExidence[channel] = mEmission[channel];
+        mUnshot[channel] = mEmission[channel];
+    }
+}
+
+PatchStore::~PatchStore()
+{
+}
+
+void PatchStore::SwapExidence()
+{
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        mExidence[channel].swap(mNextExidence[channel]);
+    }
+}
+
+}   // namespace Radiosity
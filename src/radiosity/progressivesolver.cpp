@@ -0,0 +1,132 @@
+///
+/// @file ProgressiveSolver.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Progressive refinement radiosity: repeatedly shoots the unshot light
+///     of the brightest patch into the scene.
+///
+
+#include "progressivesolver.h"
+
+namespace Radiosity
+{
+
+ProgressiveSolver::ProgressiveSolver(std::vector<Patch*> *patches,
+                                     PatchStore *store,
+                                     FormCalculator *formCalculator):
+    mPatches(patches),
+    mStore(store),
+    mFormCalculator(formCalculator),
+    mQueue(store->Size()),
+    mRows(store->Size()),
+    mTraced(store->Size(), false),
+    mShots(0)
+{
+    for (unsigned int index = 0; index < store->Size(); ++index)
+    {
+        UpdateKey(index);
+    }
+
+    mEmittedPower = UnshotPower();
+}
+
+ProgressiveSolver::~ProgressiveSolver()
+{
+}
+
+bool ProgressiveSolver::Shoot()
+{
+    if (mStore->Size() == 0)
+    {
+        return false;
+    }
+
+    unsigned int shooter = mQueue.Top();
+
+    if (mQueue.Key(shooter) <= 0)
+    {
+        return false;
+    }
+
+    if (!mTraced[shooter])
+    {
+        mFormCalculator->CalculateRow(mPatches, mPatches->at(shooter),
+                                      mRows[shooter]);
+        mTraced[shooter] = true;
+    }
+
+    const std::vector<FormFactorMatrix::Entry> &row = mRows[shooter];
+    const float *area = mStore->Area();
+
+    // The hemicube gives the form factors from the shooter to the
+    // receivers; reciprocity turns them into the form factors from the
+    // receivers back to the shooter, which scale what each one receives.
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        float *exidence = mStore->Exidence(channel);
+        float *incidence = mStore->Incidence(channel);
+        float *unshot = mStore->Unshot(channel);
+        const float *reflectance = mStore->Reflectance(channel);
+
+        float power = unshot[shooter] * area[shooter];
+
+        for (unsigned int entry = 0; entry < row.size(); ++entry)
+        {
+            unsigned int receiver = row[entry].first;
+            float received = power * row[entry].second / area[receiver];
+            float reflected = received * reflectance[receiver];
+
+            incidence[receiver] += received;
+            exidence[receiver] += reflected;
+            unshot[receiver] += reflected;
+        }
+
+        unshot[shooter] = 0;
+    }
+
+    for (unsigned int entry = 0; entry < row.size(); ++entry)
+    {
+        UpdateKey(row[entry].first);
+    }
+
+    UpdateKey(shooter);
+
+    ++mShots;
+    return true;
+}
+
+float ProgressiveSolver::UnshotPower() const
+{
+    float total = 0;
+
+    for (unsigned int index = 0; index < mStore->Size(); ++index)
+    {
+        total += mQueue.Key(index);
+    }
+
+    return total;
+}
+
+float ProgressiveSolver::RelativeUnshotPower() const
+{
+    if (mEmittedPower == 0)
+    {
+        return 0;
+    }
+
+    return UnshotPower() / mEmittedPower;
+}
+
+void ProgressiveSolver::UpdateKey(unsigned int index)
+{
+    float unshot = mStore->Unshot(0)[index] +
+                   mStore->Unshot(1)[index] +
+                   mStore->Unshot(2)[index];
+
+    mQueue.Update(index, unshot * mStore->Area()[index]);
+}
+
+}   // namespace Radiosity
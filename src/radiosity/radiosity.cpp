@@ -10,16 +10,30 @@
 
 #include "point.h"
 #include "patch.h"
+#include "mesh.h"
 #include "radiosityreader.h"
 #include "formcalculator.h"
 #include "sightcalculator.h"
 #include "patchcalculator.h"
 #include "radiositycalculator.h"
+#include "formfactormatrix.h"
+#include "patchstore.h"
+#include "progressivesolver.h"
+#include "hierarchicalsolver.h"
+#include "meshrefiner.h"
+#include "threadpool.h"
+#include "bvh.h"
+#include "visibilitymatrix.h"
+#include "arena.h"
 
 #include <GL/glut.h>
 
+#include <getopt.h>
+
+#include <utility>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #define WINDOW_WIDTH 512
@@ -30,11 +44,145 @@
 
 #define PI 3.141592654
 
+// Patches shot between redraws when shooting
+#define SHOTS_PER_FRAME 8
+
 bool show_los = false;
 bool show_normals = false;
 bool outline_patches = false;
 
 std::vector<Radiosity::Patch*> *Patches;
+Radiosity::Mesh *SceneMesh = nullptr;
+
+// The rest of the scene, kept until the program exits
+std::vector<Radiosity::Rectangle*> *Quads = nullptr;
+Radiosity::PatchStore *Store = nullptr;
+Radiosity::HierarchicalSolver *Hierarchy = nullptr;
+Radiosity::Bvh *SceneBvh = nullptr;
+Radiosity::Arena *SceneArena = nullptr;
+
+Radiosity::ProgressiveSolver *Solver = nullptr;
+int RemainingShots = 0;
+float Tolerance = 0;
+
+void cleanup( void )
+{
+    // glutMainLoop never returns; closing the window exits from inside it.
+    // The quads and patches go with the arena.
+    delete Solver;
+    Solver = nullptr;
+
+    delete Hierarchy;
+    Hierarchy = nullptr;
+
+    delete Store;
+    Store = nullptr;
+
+    delete SceneBvh;
+    SceneBvh = nullptr;
+
+    delete Patches;
+    Patches = nullptr;
+
+    delete Quads;
+    Quads = nullptr;
+
+    delete SceneMesh;
+    SceneMesh = nullptr;
+
+    delete SceneArena;
+    SceneArena = nullptr;
+}
+
+void report_form_factors(const Radiosity::FormCalculator &calculator,
+                         std::size_t patches,
+                         Radiosity::FormCalculator::Reciprocity reciprocity)
+{
+    std::cout << "Traced " << calculator.GetTracedRows() << " of "
+              << patches << " hemicubes..." << std::endl;
+
+    if (reciprocity == Radiosity::FormCalculator::VALIDATE)
+    {
+        std::cout << "Reciprocity error: "
+                  << calculator.GetReciprocityError()
+                  << " overall, "
+                  << calculator.GetMaxReciprocityError()
+                  << " for the worst pair" << std::endl;
+    }
+}
+
+void usage( void )
+{
+    std::cout << "Usage: Radiosity [options] <patch_size> <input file>" <<
+        " <num_iterations>" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -t, --threads <n>     worker threads (default: all cores)"
+              << std::endl;
+    std::cout << "  -a, --accel <type>    ray acceleration: bvh (default) or"
+              << " none" << std::endl;
+    std::cout << "  -H, --hemicube <type> face tracing: raycast (default) or"
+              << " zbuffer" << std::endl;
+    std::cout << "  -r, --resolution <n>  hemicube resolution (default: "
+              << DEFAULT_RESOLUTION << ")" << std::endl;
+    std::cout << "  -A, --adaptive <max>  pick a resolution per patch, up to"
+              << " max" << std::endl;
+    std::cout << "  -s, --solver <type>   gather (default), shoot or"
+              << " hierarchical; when" << std::endl;
+    std::cout << "                        shooting, the iterations are the"
+              << " number of shots;" << std::endl;
+    std::cout << "                        hierarchical subdivides down to"
+              << " the patch size" << std::endl;
+    std::cout << "  -f, --link-threshold <x> largest form factor of a"
+              << " hierarchical link" << std::endl;
+    std::cout << "                        (default: "
+              << DEFAULT_LINK_THRESHOLD << ")" << std::endl;
+    std::cout << "  -e, --tolerance <x>   stop once the relative residual"
+              << " is below x" << std::endl;
+    std::cout << "                        (default: 0, run every"
+              << " iteration)" << std::endl;
+    std::cout << "  -n, --norm <type>     residual of the gather: l1"
+              << " (default) or linf" << std::endl;
+    std::cout << "  -m, --method <type>   gather iteration: jacobi"
+              << " (default), gauss-seidel" << std::endl;
+    std::cout << "                        or sor" << std::endl;
+    std::cout << "  -w, --omega <x>       relaxation factor for sor"
+              << " (default: 1.2)" << std::endl;
+    std::cout << "  -c, --colored         sweep gauss-seidel and sor by"
+              << " color, in parallel" << std::endl;
+    std::cout << "  -o, --occlusion       drop hidden pairs of patches"
+              << " before tracing" << std::endl;
+    std::cout << "                        the hemicubes" << std::endl;
+    std::cout << "  -N, --near-field <x>  exact form factors for"
+              << " unoccluded pairs closer" << std::endl;
+    std::cout << "                        than x patch widths (default:"
+              << " 0, off)" << std::endl;
+    std::cout << "  -R, --reciprocity <type> trace (default), derive or"
+              << " validate; derive" << std::endl;
+    std::cout << "                        traces fewer hemicubes and"
+              << " fills in the other" << std::endl;
+    std::cout << "                        rows by reciprocity, validate"
+              << " reports how far" << std::endl;
+    std::cout << "                        traced pairs disagree"
+              << std::endl;
+    std::cout << "  -k, --kernel <type>   patch intersection: scalar, sse,"
+              << " avx2 or validate;" << std::endl;
+    std::cout << "                        defaults to the widest the"
+              << " processor supports," << std::endl;
+    std::cout << "                        validate checks each against"
+              << " the scalar patch test" << std::endl;
+    std::cout << "  -v, --validate-los    check every line of sight row"
+              << " against single pair" << std::endl;
+    std::cout << "                        lookups" << std::endl;
+    std::cout << "  -d, --adapt <n>       after gathering, split and merge"
+              << " patches by the" << std::endl;
+    std::cout << "                        solution and re-solve, up to n"
+              << " times (default: 0)" << std::endl;
+    std::cout << "  -g, --gradient <x>    relative difference between"
+              << " neighbours above which" << std::endl;
+    std::cout << "                        --adapt splits a patch (default: "
+              << DEFAULT_GRADIENT << ")" << std::endl;
+    exit(1);
+}
 
 void display( void )
 {
@@ -62,16 +210,12 @@ void display( void )
 
     gluLookAt( 0.0, -0.0, 100.0, 0.0, 0.0, -1.0, 0.0, 1.0, 0.0 );
 
+    // Update the corner colors with the weighted average of the centers
+    SceneMesh->UpdateColors(Patches);
+
     std::vector<Radiosity::Patch*>::iterator iter = Patches->begin();
 
-    // Update the corner colors with the weighted average of the centers
     for (; iter != Patches->end(); ++iter)
-    {
-        Radiosity::Patch *patch = *iter;
-        patch->UpdateCornerColors();
-    }
-
-    for (iter = Patches->begin(); iter != Patches->end(); ++iter)
     {
         Radiosity::Patch *patch = *iter;
         patch->Draw();
@@ -127,44 +271,535 @@ void display( void )
     glutSwapBuffers();
 }
 
+void idle( void )
+{
+    // Shoot a few patches per frame so the image refines as it goes
+    bool finished = false;
+
+    for (int shot = 0; (shot < SHOTS_PER_FRAME) && !finished; ++shot)
+    {
+        finished = (RemainingShots <= 0) || !Solver->Shoot();
+        --RemainingShots;
+    }
+
+    // The residual of the shooting solver is the fraction of the emitted
+    // power that has not been shot yet.
+    float residual = Solver->RelativeUnshotPower();
+
+    std::cout << "Shot " << Solver->GetShots() << ": residual " << residual
+              << std::endl;
+
+    if (finished || (residual < Tolerance))
+    {
+        std::cout << "Finished after " << Solver->GetShots() << " shots"
+                  << std::endl;
+
+        glutIdleFunc(nullptr);
+    }
+
+    glutPostRedisplay();
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 4)
+    unsigned int num_threads = Radiosity::ThreadPool::HardwareThreads();
+    bool use_bvh = true;
+    Radiosity::Hemicube::Backend backend = Radiosity::Hemicube::RAY_CAST;
+    int resolution = DEFAULT_RESOLUTION;
+    int max_resolution = 0;
+    bool shoot = false;
+    bool hierarchical = false;
+    float link_threshold = DEFAULT_LINK_THRESHOLD;
+    Radiosity::Residual::Norm norm = Radiosity::Residual::L1;
+    Radiosity::RadiosityCalculator::Method method =
+        Radiosity::RadiosityCalculator::JACOBI;
+    float omega = 1.2;
+    bool colored = false;
+    bool occlusion = false;
+    float near_field = 0;
+    Radiosity::FormCalculator::Reciprocity reciprocity =
+        Radiosity::FormCalculator::TRACE_ALL;
+    int adapt_passes = 0;
+    float gradient = DEFAULT_GRADIENT;
+    bool gradient_given = false;
+    Radiosity::PatchPacket::Kernel kernel =
+        Radiosity::PatchPacket::Supported();
+    bool validate_kernel = false;
+    bool validate_los = false;
+
+    static const struct option long_options[] =
     {
-        std::cout << "Usage: Radiosity <patch_size> <input file>" <<
-            " <num_iterations>" << std::endl;
-        exit(1);
+        { "threads",  required_argument, nullptr, 't' },
+        { "accel",    required_argument, nullptr, 'a' },
+        { "hemicube", required_argument, nullptr, 'H' },
+        { "resolution", required_argument, nullptr, 'r' },
+        { "adaptive", required_argument, nullptr, 'A' },
+        { "solver",   required_argument, nullptr, 's' },
+        { "link-threshold", required_argument, nullptr, 'f' },
+        { "tolerance", required_argument, nullptr, 'e' },
+        { "norm",     required_argument, nullptr, 'n' },
+        { "method",   required_argument, nullptr, 'm' },
+        { "omega",    required_argument, nullptr, 'w' },
+        { "colored",  no_argument,       nullptr, 'c' },
+        { "occlusion", no_argument,      nullptr, 'o' },
+        { "near-field", required_argument, nullptr, 'N' },
+        { "reciprocity", required_argument, nullptr, 'R' },
+        { "adapt",    required_argument, nullptr, 'd' },
+        { "gradient", required_argument, nullptr, 'g' },
+        { "kernel",   required_argument, nullptr, 'k' },
+        { "validate-los", no_argument,   nullptr, 'v' },
+        { nullptr,    0,                 nullptr, 0   }
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:a:H:r:A:s:f:e:n:m:w:coN:R:d:g:k:v", long_options, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            num_threads = strtoul(optarg, nullptr, 0);
+            break;
+        case 'a':
+            if (strcmp(optarg, "bvh") == 0)
+            {
+                use_bvh = true;
+            }
+            else if (strcmp(optarg, "none") == 0)
+            {
+                use_bvh = false;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'H':
+            if (strcmp(optarg, "raycast") == 0)
+            {
+                backend = Radiosity::Hemicube::RAY_CAST;
+            }
+            else if (strcmp(optarg, "zbuffer") == 0)
+            {
+                backend = Radiosity::Hemicube::Z_BUFFER;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'r':
+            resolution = strtol(optarg, nullptr, 0);
+            break;
+        case 'A':
+            max_resolution = strtol(optarg, nullptr, 0);
+            break;
+        case 's':
+            if (strcmp(optarg, "gather") == 0)
+            {
+                shoot = false;
+                hierarchical = false;
+            }
+            else if (strcmp(optarg, "shoot") == 0)
+            {
+                shoot = true;
+                hierarchical = false;
+            }
+            else if (strcmp(optarg, "hierarchical") == 0)
+            {
+                shoot = false;
+                hierarchical = true;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'f':
+            link_threshold = strtof(optarg, nullptr);
+            break;
+        case 'e':
+            Tolerance = strtof(optarg, nullptr);
+            break;
+        case 'n':
+            if (strcmp(optarg, "l1") == 0)
+            {
+                norm = Radiosity::Residual::L1;
+            }
+            else if (strcmp(optarg, "linf") == 0)
+            {
+                norm = Radiosity::Residual::L_INFINITY;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'm':
+            if (strcmp(optarg, "jacobi") == 0)
+            {
+                method = Radiosity::RadiosityCalculator::JACOBI;
+            }
+            else if (strcmp(optarg, "gauss-seidel") == 0)
+            {
+                method = Radiosity::RadiosityCalculator::GAUSS_SEIDEL;
+            }
+            else if (strcmp(optarg, "sor") == 0)
+            {
+                method = Radiosity::RadiosityCalculator::SOR;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'w':
+            omega = strtof(optarg, nullptr);
+            break;
+        case 'c':
+            colored = true;
+            break;
+        case 'o':
+            occlusion = true;
+            break;
+        case 'N':
+            near_field = strtof(optarg, nullptr);
+            break;
+        case 'R':
+            if (strcmp(optarg, "trace") == 0)
+            {
+                reciprocity = Radiosity::FormCalculator::TRACE_ALL;
+            }
+            else if (strcmp(optarg, "derive") == 0)
+            {
+                reciprocity = Radiosity::FormCalculator::DERIVE;
+            }
+            else if (strcmp(optarg, "validate") == 0)
+            {
+                reciprocity = Radiosity::FormCalculator::VALIDATE;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'd':
+            adapt_passes = strtol(optarg, nullptr, 0);
+            break;
+        case 'g':
+            gradient = strtof(optarg, nullptr);
+            gradient_given = true;
+            break;
+        case 'k':
+            if (strcmp(optarg, "scalar") == 0)
+            {
+                kernel = Radiosity::PatchPacket::SCALAR;
+            }
+            else if (strcmp(optarg, "sse") == 0)
+            {
+                kernel = Radiosity::PatchPacket::SSE;
+            }
+            else if (strcmp(optarg, "avx2") == 0)
+            {
+                kernel = Radiosity::PatchPacket::AVX2;
+            }
+            else if (strcmp(optarg, "validate") == 0)
+            {
+                validate_kernel = true;
+            }
+            else
+            {
+                usage();
+            }
+            break;
+        case 'v':
+            validate_los = true;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (argc - optind != 3)
+    {
+        usage();
     }
 
-    int num_iterations = strtol(argv[3], nullptr, 0);
+    // Only the gathering solver adapts its patches
+    if (((adapt_passes > 0) || gradient_given) && (shoot || hierarchical))
+    {
+        std::cout << "--adapt and --gradient only apply to the gather"
+                  << " solver" << std::endl;
+        usage();
+    }
 
-    float patch_size = strtof(argv[1], nullptr);
+    int num_iterations = strtol(argv[optind + 2], nullptr, 0);
+
+    float patch_size = strtof(argv[optind], nullptr);
+
+    Radiosity::ThreadPool thread_pool(num_threads);
+
+    std::cout << "Using " << thread_pool.Size() << " threads..." << std::endl;
 
     std::vector<Radiosity::Rectangle*> *quads;
     std::vector<Radiosity::Patch*> *patches = new std::vector<Radiosity::Patch*>();
 
-    Radiosity::RadiosityReader myReader;
-    quads = myReader.ParseObj(argv[2]);
+    // Quads and patches live as long as the scene, and are released with
+    // the arena
+    Radiosity::Arena *arena = new Radiosity::Arena();
+
+    Radiosity::RadiosityReader myReader(arena);
+    quads = myReader.ParseObj(argv[optind + 1]);
+
+    // Corners of every patch, shared wherever they coincide on a plane
+    Radiosity::Mesh *mesh = new Radiosity::Mesh(patch_size * WELD_TOLERANCE);
+    SceneMesh = mesh;
 
-    // Subdivide into patches
-    Radiosity::PatchCalculator patch_calculator(patch_size);
-    patch_calculator.Subdivide(quads, patches);
+    Radiosity::HierarchicalSolver *hierarchy = nullptr;
+
+    if (hierarchical)
+    {
+        // Patches are split as the links between them are refined; the
+        // ones left whole are the patches of the solution.
+        hierarchy = new Radiosity::HierarchicalSolver(quads, mesh, arena);
+        hierarchy->SetThreshold(link_threshold);
+        hierarchy->SetMinimumSize(patch_size);
+        hierarchy->SetThreadPool(&thread_pool);
+        hierarchy->SetTolerance(Tolerance);
+        hierarchy->SetNorm(norm);
+        hierarchy->Refine(patches);
+    }
+    else
+    {
+        // Subdivide into patches
+        Radiosity::PatchCalculator patch_calculator(patch_size, arena);
+        patch_calculator.SetThreadPool(&thread_pool);
+        patch_calculator.Subdivide(quads, patches, mesh);
+    }
 
     std::cout << "Using " << patches->size() << " patches..." << std::endl;
+    std::cout << "Using " << mesh->Size() << " vertices ("
+              << mesh->MemoryUsage() / 1024 << " KiB)..." << std::endl;
+    std::cout << "Using " << arena->BytesAllocated() / 1024 << " KiB in "
+              << arena->Allocations() << " allocations from "
+              << arena->Blocks() << " blocks for the scene..." << std::endl;
 
-    // Calculate line of sight
-    Radiosity::SightCalculator sight_calculator;
-    sight_calculator.CalculateLOS(patches);
+    if (hierarchical)
+    {
+        std::cout << "Using " << hierarchy->Links() << " links between "
+                  << hierarchy->Elements() << " elements..." << std::endl;
+    }
+
+    // Build the acceleration structure over the patches
+    Radiosity::Bvh *bvh = nullptr;
+
+    if (use_bvh && !hierarchical)
+    {
+        bvh = new Radiosity::Bvh(patches);
+
+        // Check every kernel the processor supports, the scalar one
+        // included, against the patches' own test
+        for (int check = Radiosity::PatchPacket::SCALAR;
+             validate_kernel &&
+             (check <= Radiosity::PatchPacket::Supported()); ++check)
+        {
+            std::size_t tested;
+            bvh->SetKernel(Radiosity::PatchPacket::Kernel(check));
+            std::size_t differ = bvh->ValidateKernel(tested);
+
+            std::cout << "Kernel "
+                      << Radiosity::PatchPacket::KernelName(
+                             Radiosity::PatchPacket::Kernel(check))
+                      << ": " << differ << " of " << tested
+                      << " distances differ from the patch test..."
+                      << std::endl;
+        }
+
+        bvh->SetKernel(kernel);
+
+        std::cout << "Using the "
+                  << Radiosity::PatchPacket::KernelName(bvh->GetKernel())
+                  << " intersection kernel..." << std::endl;
+    }
+
+    // Calculate line of sight; the hierarchy tests visibility per link
+    Radiosity::VisibilityMatrix visibility;
+
+    if (!hierarchical)
+    {
+        Radiosity::SightCalculator sight_calculator;
+        sight_calculator.SetThreadPool(&thread_pool);
+        sight_calculator.SetOcclusionTest(occlusion);
+        sight_calculator.CalculateLOS(patches, bvh, &visibility);
+
+        std::cout << "Using " << visibility.Pairs() << " line of sight pairs ("
+                  << visibility.MemoryUsage() / 1024 << " KiB)..."
+                  << std::endl;
+
+        // Rows read the pairs below the diagonal through transposed
+        // blocks; check them against the pairs one at a time
+        if (validate_los)
+        {
+            std::cout << "Line of sight: " << visibility.Validate() << " of "
+                      << visibility.Size() << " rows differ from single"
+                      << " pair lookups..." << std::endl;
+        }
+    }
 
     Patches = patches;
 
-    Radiosity::FormCalculator form_calculator(quads);
-    form_calculator.CalculateFormFactors(patches);
+    Radiosity::FormCalculator form_calculator(quads, &visibility, bvh,
+                                              backend, &thread_pool);
+    form_calculator.SetResolution(resolution);
+    form_calculator.SetAdaptiveResolution(max_resolution);
+    form_calculator.SetNearField(near_field);
+    form_calculator.SetReciprocity(reciprocity);
+
+    // The solution the patches are bound to, replaced as they adapt
+    Radiosity::PatchStore *store = new Radiosity::PatchStore(patches);
+
+    if (shoot)
+    {
+        // Form factors are traced as patches shoot, while the window
+        // shows the solution so far.
+        Solver = new Radiosity::ProgressiveSolver(patches, store,
+                                                  &form_calculator);
+        RemainingShots = num_iterations;
+    }
+    else if (hierarchical)
+    {
+        int iterations = hierarchy->CalculateRadiosity(store,
+                                                       num_iterations);
+
+        std::cout << "Finished after " << iterations << " iterations"
+                  << std::endl;
+    }
+    else
+    {
+        Radiosity::FormFactorMatrix form_factors;
+        form_calculator.CalculateFormFactors(patches, &form_factors);
+
+        report_form_factors(form_calculator, patches->size(), reciprocity);
+
+        std::cout << "Using " << form_factors.NonZeros() << " form factors ("
+                  << form_factors.MemoryUsage() / 1024 << " KiB)..."
+                  << std::endl;
+
+        Radiosity::RadiosityCalculator myRadiosityCalculator;
+        myRadiosityCalculator.SetTolerance(Tolerance);
+        myRadiosityCalculator.SetNorm(norm);
+        myRadiosityCalculator.SetMethod(method);
+        myRadiosityCalculator.SetRelaxation(omega);
+        myRadiosityCalculator.SetColoredOrdering(colored);
+        myRadiosityCalculator.SetThreadPool(&thread_pool);
+
+        int iterations = myRadiosityCalculator.CalculateRadiosity(
+            store, form_factors, num_iterations);
+
+        std::cout << "Finished after " << iterations << " iterations"
+                  << std::endl;
+
+        // Adapt the patches to the solution. Only the new patches trace
+        // hemicubes and test their line of sight, and the solver starts
+        // from the previous solution.
+        Radiosity::VisibilityMatrix *sight = &visibility;
+
+        for (int pass = 0; pass < adapt_passes; ++pass)
+        {
+            Radiosity::MeshRefiner refiner(quads, mesh, arena);
+            refiner.SetThreshold(gradient);
+
+            std::vector<Radiosity::Patch*> *refined =
+                new std::vector<Radiosity::Patch*>();
+
+            if (!refiner.Refine(patches, store, refined))
+            {
+                delete refined;
+                break;
+            }
+
+            std::cout << "Split " << refiner.GetSplit() << " and merged "
+                      << refiner.GetMerged() << " blocks of patches, now "
+                      << refined->size() << " patches..." << std::endl;
+
+            Radiosity::Bvh *refined_bvh = nullptr;
 
-    Radiosity::RadiosityCalculator myRadiosityCalculator;
-    myRadiosityCalculator.CalculateRadiosity(patches, num_iterations);
+            if (use_bvh)
+            {
+                refined_bvh = new Radiosity::Bvh(refined);
+                refined_bvh->SetKernel(kernel);
+            }
+
+            std::vector<uint32_t> rows;
+            refiner.CarryVisibility(rows);
+
+            Radiosity::VisibilityMatrix *refined_visibility =
+                new Radiosity::VisibilityMatrix();
+            Radiosity::SightCalculator sight_calculator;
+            sight_calculator.SetThreadPool(&thread_pool);
+            sight_calculator.SetOcclusionTest(occlusion);
+            sight_calculator.UpdateLOS(refined, refined_bvh, *sight, rows,
+                                       refined_visibility);
+
+            Radiosity::FormCalculator refined_calculator(
+                quads, refined_visibility, refined_bvh, backend,
+                &thread_pool);
+            refined_calculator.SetResolution(resolution);
+            refined_calculator.SetAdaptiveResolution(max_resolution);
+            refined_calculator.SetNearField(near_field);
+            refined_calculator.SetReciprocity(reciprocity);
+
+            Radiosity::FormFactorMatrix refined_factors;
+            refiner.CarryFormFactors(form_factors, refined,
+                                     &refined_calculator, &refined_factors);
+
+            report_form_factors(refined_calculator, refined->size(),
+                                reciprocity);
+
+            Radiosity::PatchStore *refined_store =
+                new Radiosity::PatchStore(refined);
+            refiner.CarryExidence(*store, refined_store);
+
+            iterations = myRadiosityCalculator.CalculateRadiosity(
+                refined_store, refined_factors, num_iterations);
+
+            std::cout << "Finished after " << iterations << " iterations"
+                      << std::endl;
+
+            // The patches replaced stay in the arena until the end
+            std::swap(form_factors, refined_factors);
+            delete bvh;
+            bvh = refined_bvh;
+            delete patches;
+            patches = refined;
+
+            delete store;
+            store = refined_store;
+
+            if (sight != &visibility)
+            {
+                delete sight;
+            }
+
+            sight = refined_visibility;
+        }
+
+        if (sight != &visibility)
+        {
+            delete sight;
+        }
+
+        sight = nullptr;
+    }
 
     Patches = patches;
+    Quads = quads;
+    Store = store;
+    Hierarchy = hierarchy;
+    SceneBvh = bvh;
+    SceneArena = arena;
+
+    // Free up memory when the window closes
+    atexit(cleanup);
 
    	glutInit( &argc, argv );
    	glutInitDisplayMode( GLUT_RGB | GLUT_DEPTH | GLUT_DOUBLE );
@@ -179,19 +814,12 @@ int main(int argc, char **argv)
    	// Callback functions
    	glutDisplayFunc( display );
 
-   	glutMainLoop( );
-
-    // Free up memory ---------------------------------------------------------
+   	if (Solver != nullptr)
+   	{
+   	    glutIdleFunc( idle );
+   	}
 
-    std::vector<Radiosity::Patch*>::iterator patchIter = patches->begin();
-    for (; patchIter != patches->end(); ++patchIter)
-    {
-        delete *patchIter;
-        *patchIter = nullptr;
-    }
-
-    delete patches;
-    Patches = patches = nullptr;
+   	glutMainLoop( );
 
     return 0;
 }
@@ -5,53 +5,360 @@
 /// @date 2 February 2012
 ///
 /// @description
-/// 	Implements a progressive radiosity algorithm.
+/// 	Implements a gathering radiosity algorithm.
 ///
 
 #include "radiositycalculator.h"
 
+#include <algorithm>
+
 namespace Radiosity
 {
 
-void RadiosityCalculator::CalculateRadiosity(std::vector<Patch*> *patches,
-                                             int numIterations)
+RadiosityCalculator::RadiosityCalculator():
+    mTolerance(0),
+    mNorm(Residual::L1),
+    mMethod(JACOBI),
+    mRelaxation(1),
+    mColored(false),
+    mPool(nullptr)
+{
+}
+
+void RadiosityCalculator::SetTolerance(float tolerance)
+{
+    mTolerance = tolerance;
+}
+
+void RadiosityCalculator::SetNorm(Residual::Norm norm)
+{
+    mNorm = norm;
+}
+
+void RadiosityCalculator::SetMethod(Method method)
+{
+    mMethod = method;
+}
+
+void RadiosityCalculator::SetRelaxation(float omega)
+{
+    mRelaxation = omega;
+}
+
+void RadiosityCalculator::SetColoredOrdering(bool colored)
+{
+    mColored = colored;
+}
+
+void RadiosityCalculator::SetThreadPool(ThreadPool *pool)
+{
+    mPool = pool;
+}
+
+int RadiosityCalculator::CalculateRadiosity(PatchStore *store,
+                                            const FormFactorMatrix &formFactors,
+                                            int numIterations)
+{
+    // Order in which Gauss-Seidel visits the patches: color by color, or
+    // all patches in index order as a single color.
+    std::vector< std::vector<uint32_t> > colors;
+
+    if (mMethod == JACOBI)
+    {
+        PartitionRows(formFactors);
+    }
+    else
+    {
+        if (mColored)
+        {
+            ColorPatches(formFactors, colors);
+
+            std::cout << "Using " << colors.size() << " colors..."
+                      << std::endl;
+        }
+        else
+        {
+            colors.resize(1);
+
+            for (unsigned int patch = 0; patch < store->Size(); ++patch)
+            {
+                colors.at(0).push_back(patch);
+            }
+        }
+    }
+
+    int iteration = 0;
+
+    while (iteration < numIterations)
+    {
+        Residual residual(mNorm);
+
+        if (mMethod == JACOBI)
+        {
+            JacobiStep(store, formFactors, residual);
+        }
+        else
+        {
+            GaussSeidelStep(store, formFactors, colors, residual);
+        }
+
+        ++iteration;
+
+        std::cout << "Iteration " << iteration << ": residual "
+                  << residual.Value() << std::endl;
+
+        if (residual.Value() < mTolerance)
+        {
+            break;
+        }
+    }
+
+    return iteration;
+}
+
+void RadiosityCalculator::JacobiStep(PatchStore *store,
+                                     const FormFactorMatrix &formFactors,
+                                     Residual &residual)
 {
+    const uint32_t *columns = formFactors.Columns();
+    const float *values = formFactors.Values();
 
-    // The progressive radiosity algorithm pseudocode is as follows:
+    // Each iteration is a Jacobi step of the radiosity equation:
     //
-    //      for each iteration:
-    //          select a patch, p
-    //          for every other patch, q
-    //              calculate the form factor between p and q
-    //              based on the form factor:
-    //                  update the reflectance of patch q
-    //                  update the emission of patch q
-    //              set emission of patch p to zero
+    //      for every patch, p
+    //          gather the exidence of every patch, q, weighted by
+    //          the form factor from p to q, as the incidence of p
+    //          reflect the incidence of p and add its emission
     //
-    for (int iteration = 0; iteration < numIterations; ++iteration)
+    // The gather only reads the current exidence and the update only
+    // writes the back buffer, so the patches are independent and both
+    // happen in one pass. See ProgressiveSolver for the shooting variant.
+    mPartials.assign(mPartitions.size() - 1, Residual(mNorm));
+
+    ThreadPool::RangeTask gather =
+        [&](std::size_t first, std::size_t last, unsigned int)
+        {
+            for (std::size_t part = first; part < last; ++part)
+            {
+                Residual &partial = mPartials[part];
+
+                for (unsigned int channel = 0; channel < 3; ++channel)
+                {
+                    const float *exidence = store->Exidence(channel);
+                    float *next = store->NextExidence(channel);
+                    float *incidence = store->Incidence(channel);
+                    const float *reflectance = store->Reflectance(channel);
+                    const float *emission = store->Emission(channel);
+
+                    for (uint32_t patch = mPartitions[part];
+                         patch < mPartitions[part + 1]; ++patch)
+                    {
+                        // Update the patch's incidence
+                        float gathered = 0;
+                        uint32_t end = formFactors.RowEnd(patch);
+
+                        for (uint32_t entry = formFactors.RowBegin(patch);
+                             entry < end; ++entry)
+                        {
+                            gathered += exidence[columns[entry]] *
+                                        values[entry];
+                        }
+
+                        incidence[patch] = gathered;
+
+                        // Update the patch's exidence
+                        next[patch] = gathered * reflectance[patch] +
+                                      emission[patch];
+
+                        partial.Add(exidence[patch], next[patch]);
+                    }
+                }
+            }
+        };
+
+    if (mPool != nullptr)
     {
-        // Each patch collects light from the scene. Add up this light from
-        // all visible patches to get the total incident light for this
-        // iteration.
+        mPool->ParallelForStatic(mPartials.size(), gather);
+    }
+    else
+    {
+        gather(0, mPartials.size(), 0);
+    }
+
+    store->SwapExidence();
 
-        std::vector<Patch*>::iterator piter = patches->begin();
+    for (unsigned int part = 0; part < mPartials.size(); ++part)
+    {
+        residual.Merge(mPartials[part]);
+    }
+}
 
-        for (; piter != patches->end(); ++piter)
+void RadiosityCalculator::PartitionRows(const FormFactorMatrix &formFactors)
+{
+    unsigned int count = formFactors.Rows();
+
+    // Weigh each patch by its form factors, plus one for the update
+    uint64_t total = formFactors.NonZeros() + count;
+
+    mPartitions.assign(1, 0);
+
+    for (unsigned int part = 1; part < JACOBI_PARTITIONS; ++part)
+    {
+        uint64_t target = total * part / JACOBI_PARTITIONS;
+        uint32_t patch = mPartitions.back();
+
+        while ((patch < count) &&
+               (uint64_t(formFactors.RowBegin(patch)) + patch < target))
         {
-            // Update the patch's incidence
-            (*piter)->UpdateIncidence();
+            ++patch;
         }
 
-        // Update the exident light for each patch, now that all the incident
-        // light is accounted for.
-        piter = patches->begin();
+        mPartitions.push_back(patch);
+    }
+
+    mPartitions.push_back(count);
+}
+
+void RadiosityCalculator::GaussSeidelStep(
+    PatchStore *store,
+    const FormFactorMatrix &formFactors,
+    const std::vector< std::vector<uint32_t> > &colors,
+    Residual &residual)
+{
+    const uint32_t *columns = formFactors.Columns();
+    const float *values = formFactors.Values();
+    float omega = (mMethod == SOR) ? mRelaxation : 1.0f;
+
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        float *exidence = store->Exidence(channel);
+        float *incidence = store->Incidence(channel);
+        const float *reflectance = store->Reflectance(channel);
+        const float *emission = store->Emission(channel);
 
-        for (; piter != patches->end(); ++piter)
+        for (unsigned int color = 0; color < colors.size(); ++color)
         {
-            // Update the patche's exidence
-            (*piter)->UpdateExidence();
+            const std::vector<uint32_t> &patches = colors.at(color);
+
+            mPrevious.resize(patches.size());
+
+            // Gather and update each patch in place. Patches of the same
+            // color do not see each other, so they can go in parallel.
+            ThreadPool::RangeTask sweep =
+                [&](std::size_t begin, std::size_t end, unsigned int)
+                {
+                    for (std::size_t index = begin; index < end; ++index)
+                    {
+                        uint32_t patch = patches[index];
+                        float gathered = 0;
+                        uint32_t last = formFactors.RowEnd(patch);
+
+                        for (uint32_t entry = formFactors.RowBegin(patch);
+                             entry < last; ++entry)
+                        {
+                            gathered += exidence[columns[entry]] *
+                                        values[entry];
+                        }
+
+                        float updated = gathered * reflectance[patch] +
+                                        emission[patch];
+
+                        mPrevious[index] = exidence[patch];
+                        incidence[patch] = gathered;
+                        exidence[patch] = mPrevious[index] +
+                            omega * (updated - mPrevious[index]);
+                    }
+                };
+
+            if ((mPool != nullptr) && mColored)
+            {
+                mPool->ParallelFor(patches.size(), 64, sweep);
+            }
+            else
+            {
+                sweep(0, patches.size(), 0);
+            }
+
+            for (unsigned int index = 0; index < patches.size(); ++index)
+            {
+                residual.Add(mPrevious[index], exidence[patches[index]]);
+            }
         }
     }
 }
 
+void RadiosityCalculator::ColorPatches(
+    const FormFactorMatrix &formFactors,
+    std::vector< std::vector<uint32_t> > &colors)
+{
+    unsigned int count = formFactors.Rows();
+    const uint32_t *columns = formFactors.Columns();
+
+    // Form factors are not quite symmetric, so gather the links into each
+    // patch as well as the links out of it.
+    std::vector<uint32_t> offsets(count + 1, 0);
+
+    for (std::size_t entry = 0; entry < formFactors.NonZeros(); ++entry)
+    {
+        ++offsets[columns[entry] + 1];
+    }
+
+    for (unsigned int patch = 0; patch < count; ++patch)
+    {
+        offsets[patch + 1] += offsets[patch];
+    }
+
+    std::vector<uint32_t> incoming(formFactors.NonZeros());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+
+    for (unsigned int patch = 0; patch < count; ++patch)
+    {
+        for (uint32_t entry = formFactors.RowBegin(patch);
+             entry < formFactors.RowEnd(patch); ++entry)
+        {
+            incoming[next[columns[entry]]++] = patch;
+        }
+    }
+
+    // Give each patch the first color none of its neighbours has taken
+    std::vector<int> assigned(count, -1);
+    std::vector<unsigned int> taken;
+
+    colors.clear();
+
+    for (unsigned int patch = 0; patch < count; ++patch)
+    {
+        taken.assign(colors.size() + 1, count);
+
+        for (uint32_t entry = formFactors.RowBegin(patch);
+             entry < formFactors.RowEnd(patch); ++entry)
+        {
+            if (assigned[columns[entry]] >= 0)
+            {
+                taken[assigned[columns[entry]]] = patch;
+            }
+        }
+
+        for (uint32_t entry = offsets[patch]; entry < offsets[patch + 1];
+             ++entry)
+        {
+            if (assigned[incoming[entry]] >= 0)
+            {
+                taken[assigned[incoming[entry]]] = patch;
+            }
+        }
+
+        unsigned int color = std::find(taken.begin(), taken.end(), count) -
+                             taken.begin();
+
+        if (color == colors.size())
+        {
+            colors.push_back(std::vector<uint32_t>());
+        }
+
+        colors.at(color).push_back(patch);
+        assigned[patch] = color;
+    }
+}
+
 }	// namespace Radiosity
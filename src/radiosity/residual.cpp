@@ -0,0 +1,68 @@
+///
+/// @file Residual.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Measures how much a solver iteration changed the exidence, to
+///     decide when the solution has converged.
+///
+
+#include "residual.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Radiosity
+{
+
+Residual::Residual(Norm norm):
+    mNorm(norm),
+    mChange(0),
+    mMagnitude(0)
+{
+}
+
+void Residual::Add(float old, float updated)
+{
+    double change = std::fabs(double(updated) - old);
+    double magnitude = std::fabs(updated);
+
+    if (mNorm == L1)
+    {
+        mChange += change;
+        mMagnitude += magnitude;
+    }
+    else
+    {
+        mChange = std::max(mChange, change);
+        mMagnitude = std::max(mMagnitude, magnitude);
+    }
+}
+
+void Residual::Merge(const Residual &other)
+{
+    if (mNorm == L1)
+    {
+        mChange += other.mChange;
+        mMagnitude += other.mMagnitude;
+    }
+    else
+    {
+        mChange = std::max(mChange, other.mChange);
+        mMagnitude = std::max(mMagnitude, other.mMagnitude);
+    }
+}
+
+float Residual::Value() const
+{
+    if (mMagnitude == 0)
+    {
+        return 0;
+    }
+
+    return mChange / mMagnitude;
+}
+
+}   // namespace Radiosity
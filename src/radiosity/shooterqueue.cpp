@@ -0,0 +1,99 @@
+///
+/// @file ShooterQueue.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Indexed max-heap of patches keyed by their unshot power, used to
+///     pick the next patch to shoot from.
+///
+
+#include "shooterqueue.h"
+
+#include <algorithm>
+
+namespace Radiosity
+{
+
+ShooterQueue::ShooterQueue(unsigned int size):
+    mHeap(size),
+    mPositions(size),
+    mKeys(size, 0)
+{
+    for (unsigned int index = 0; index < size; ++index)
+    {
+        mHeap[index] = index;
+        mPositions[index] = index;
+    }
+}
+
+void ShooterQueue::Update(unsigned int index, float key)
+{
+    float old = mKeys[index];
+    mKeys[index] = key;
+
+    if (key > old)
+    {
+        SiftUp(mPositions[index]);
+    }
+    else if (key < old)
+    {
+        SiftDown(mPositions[index]);
+    }
+}
+
+void ShooterQueue::SiftUp(unsigned int position)
+{
+    while (position > 0)
+    {
+        unsigned int parent = (position - 1) / 2;
+
+        if (mKeys[mHeap[parent]] >= mKeys[mHeap[position]])
+        {
+            break;
+        }
+
+        Swap(parent, position);
+        position = parent;
+    }
+}
+
+void ShooterQueue::SiftDown(unsigned int position)
+{
+    unsigned int size = mHeap.size();
+
+    for (;;)
+    {
+        unsigned int largest = position;
+        unsigned int left = 2 * position + 1;
+        unsigned int right = left + 1;
+
+        if ((left < size) && (mKeys[mHeap[left]] > mKeys[mHeap[largest]]))
+        {
+            largest = left;
+        }
+
+        if ((right < size) && (mKeys[mHeap[right]] > mKeys[mHeap[largest]]))
+        {
+            largest = right;
+        }
+
+        if (largest == position)
+        {
+            break;
+        }
+
+        Swap(largest, position);
+        position = largest;
+    }
+}
+
+void ShooterQueue::Swap(unsigned int first, unsigned int second)
+{
+    std::swap(mHeap[first], mHeap[second]);
+    mPositions[mHeap[first]] = first;
+    mPositions[mHeap[second]] = second;
+}
+
+}   // namespace Radiosity
@@ -10,9 +10,18 @@
 
 #include "sightcalculator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Marks a patch outside every kept cluster
+#define NO_CLUSTER 0xFFFFFFFFu
+
 namespace Radiosity {
 
-SightCalculator::SightCalculator()
+SightCalculator::SightCalculator():
+    mPool(nullptr),
+    mOcclusion(false)
 {
 }
 
@@ -20,108 +29,479 @@ SightCalculator::~SightCalculator()
 {
 }
 
-void SightCalculator::CalculateLOS(std::vector<Patch*> *patches)
+void SightCalculator::CalculateLOS(std::vector<Patch*> *patches,
+                                   const Bvh *bvh,
+                                   VisibilityMatrix *visibility)
 {
     // Run quick elimination
-    RunQuickElimination(patches);
+    RunQuickElimination(patches, visibility);
+
+    if (!mOcclusion)
+    {
+        return;
+    }
 
-    // Test the remaining patches with intercepts
-    //RunInterceptTest(patches);
+    // Test the remaining patches with intercepts. Without a hierarchy
+    // this would be cubic in the number of patches, so build one if the
+    // caller has none.
+    if (bvh != nullptr)
+    {
+        RunInterceptTest(patches, bvh, visibility);
+    }
+    else
+    {
+        Bvh local(patches);
+        RunInterceptTest(patches, &local, visibility);
+    }
 }
 
-void SightCalculator::RunQuickElimination(std::vector<Patch*> *patches)
+void SightCalculator::UpdateLOS(std::vector<Patch*> *patches,
+                                const Bvh *bvh,
+                                const VisibilityMatrix &previous,
+                                const std::vector<uint32_t> &rows,
+                                VisibilityMatrix *visibility)
 {
-    std::vector<Patch*>::iterator iter1 = patches->begin();
+    // Facing is cheap to find again for every pair
+    RunQuickElimination(patches, visibility);
 
-    // For each patch
-    for (; iter1 != patches->end(); ++iter1)
+    if (!mOcclusion)
     {
-        // Look at every FOLLOWING patch (no need to compare twice) since
-        // line of sight is reciprocal
-        std::vector<Patch*>::iterator iter2 = iter1 + 1;
+        return;
+    }
 
-        for (; iter2 != patches->end(); ++iter2)
-        {
-            Patch *patch1 = *iter1;
-            Patch *patch2 = *iter2;
+    // As in CalculateLOS, the occlusion test needs a hierarchy
+    Bvh *local = nullptr;
 
-            if (patch1->IsFacing(patch2))
+    if (bvh == nullptr)
+    {
+        local = new Bvh(patches);
+        bvh = local;
+    }
+
+    // Pairs of unchanged patches keep the outcome of the previous test;
+    // the facing pairs with a new patch are tested
+    unsigned int count = patches->size();
+
+    ThreadPool::RangeTask test =
+        [&](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for (std::size_t index1 = begin; index1 < end; ++index1)
             {
-				 // Assuming nothing is in the way, these patches can see each
-				// other, so add each one to the other's line of sight vector.
-				patch1->AddViewablePatch(patch2);
-				patch2->AddViewablePatch(patch1);
+                const Patch *patch1 = patches->at(index1);
+                uint32_t row1 = rows[index1];
+                uint64_t *words = visibility->RowWords(index1);
+
+                for (unsigned int index2 = index1 + 1; index2 < count;
+                     ++index2)
+                {
+                    unsigned int bit = index2 - index1 - 1;
+                    uint64_t mask = uint64_t(1) << (bit % 64);
+                    uint64_t &word = words[bit / 64];
+                    uint32_t row2 = rows[index2];
+                    bool visible;
+
+                    if ((row1 != NO_PREVIOUS_ROW) && (row2 != NO_PREVIOUS_ROW))
+                    {
+                        visible = previous.Get(row1, row2);
+                    }
+                    else
+                    {
+                        visible = ((word & mask) != 0) &&
+                                  !IsOccluded(patch1, patches->at(index2),
+                                              bvh);
+                    }
+
+                    word = visible ? (word | mask) : (word & ~mask);
+                }
             }
+        };
 
-        } // loop over all following patches
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(count, 16, test);
+    }
+    else
+    {
+        test(0, count, 0);
+    }
 
-    } // loop over all patches
+    delete local;
 
-} // RunQuickElimination
+} // UpdateLOS
 
+void SightCalculator::SetThreadPool(ThreadPool *pool)
+{
+    mPool = pool;
+}
 
-void SightCalculator::RunInterceptTest(std::vector<Patch*> *patches)
+void SightCalculator::SetOcclusionTest(bool occlusion)
 {
-    // Loop over all patches
-    std::vector<Patch*>::const_iterator iter1 = patches->begin();
-    for (; iter1 != patches->end(); ++iter1)
+    mOcclusion = occlusion;
+}
+
+void SightCalculator::RunQuickElimination(std::vector<Patch*> *patches,
+                                          VisibilityMatrix *visibility)
+{
+    unsigned int count = patches->size();
+
+    visibility->Reset(count);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Scale the tolerance to the size of the scene
+    Point lower = patches->at(0)->GetCenter();
+    Point upper = lower;
+
+    for (unsigned int index = 1; index < count; ++index)
+    {
+        const Point &center = patches->at(index)->GetCenter();
+
+        lower = Point(std::min(lower.X(), center.X()),
+                      std::min(lower.Y(), center.Y()),
+                      std::min(lower.Z(), center.Z()));
+        upper = Point(std::max(upper.X(), center.X()),
+                      std::max(upper.Y(), center.Y()),
+                      std::max(upper.Z(), center.Z()));
+    }
+
+    float size = std::max(upper.DistanceTo(lower), 1.0f);
+    float tolerance = PLANE_TOLERANCE * size;
+
+    // A cluster's plane uses the normal of one member; the others may be
+    // tilted from it by up to the normal tolerance, which moves their
+    // distances from the plane by as much across the scene
+    float band = tolerance + 2 * NORMAL_TOLERANCE * size;
+
+    std::vector<Cluster> clusters;
+    std::vector<uint32_t> owner(count, NO_CLUSTER);
+    BuildClusters(patches, tolerance, clusters);
+
+    for (unsigned int cluster = 0; cluster < clusters.size(); ++cluster)
     {
-        // Each patch has a line of sight vector that contains patches it would
-        // be able to see if only those two patches existed. This function
-        // eliminates patches from the line of sight vector if they are blocked
-        // by other patches in the line of sight vector.
+        for (unsigned int entry = 0; entry < clusters[cluster].members.size();
+             ++entry)
+        {
+            owner[clusters[cluster].members[entry]] = cluster;
+        }
+    }
 
-        Patch *patch1 = *iter1;
+    // Decide facing once per pair of clusters. Patches on parallel planes
+    // facing the same way never see each other, whatever their positions.
+    unsigned int numClusters = clusters.size();
+    std::vector<char> parallel(numClusters * numClusters);
 
-        // Loop over line of sight vector
-        std::vector<Patch*>::iterator iter2 = patch1->GetViewablePatches()->begin();
-        for (; iter2 != patch1->GetViewablePatches()->end(); ++iter2)
+    for (unsigned int first = 0; first < numClusters; ++first)
+    {
+        for (unsigned int second = 0; second < numClusters; ++second)
         {
-            Patch *patch2 = *iter2;
+            const Vector &normal1 = clusters[first].normal;
+            const Vector &normal2 = clusters[second].normal;
 
-            // Calculate the vector between the patches
-            Vector ray(patch2->GetCenter(), patch1->GetCenter());
-            normalize(ray);
+            // Normals in neighbouring steps are parallel too
+            parallel[first * numClusters + second] =
+                (std::fabs(normal1.X() - normal2.X()) < 2 * NORMAL_TOLERANCE) &&
+                (std::fabs(normal1.Y() - normal2.Y()) < 2 * NORMAL_TOLERANCE) &&
+                (std::fabs(normal1.Z() - normal2.Z()) < 2 * NORMAL_TOLERANCE);
+        }
+    }
 
-            float shortest_distance =
-                patch1->GetCenter().DistanceTo(patch2->GetCenter());
+    // Which side of the plane of every cluster each patch lies on
+    std::vector<char> sides(std::size_t(count) * numClusters);
 
-            // Look at all other patches in the line of sight vector to see if
-            // another patch is closer along this ray
-            std::vector<Patch*>::const_iterator iter3 = patch1->GetViewablePatches()->begin();
-            for (; iter3 != patch1->GetViewablePatches()->end(); ++iter3)
+    for (unsigned int index = 0; index < count; ++index)
+    {
+        for (unsigned int cluster = 0; cluster < numClusters; ++cluster)
+        {
+            sides[std::size_t(index) * numClusters + cluster] =
+                Classify(patches->at(index), clusters[cluster], band);
+        }
+    }
+
+    // Each row only holds the pairs with FOLLOWING patches (no need to
+    // compare twice) since line of sight is reciprocal, so rows can be
+    // filled in parallel.
+    ThreadPool::RangeTask fill =
+        [&](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for (std::size_t index1 = begin; index1 < end; ++index1)
             {
-                Patch *patch3 = *iter3;
+                Patch *patch1 = patches->at(index1);
+                uint32_t cluster1 = owner[index1];
+                const char *parallel1 = (cluster1 != NO_CLUSTER) ?
+                    &parallel[std::size_t(cluster1) * numClusters] : nullptr;
+                const char *sides1 = &sides[index1 * numClusters];
+                uint64_t *words = visibility->RowWords(index1);
+
+                // Build the row a word at a time
+                uint64_t word = 0;
+                unsigned int bit = 0;
+
+                for (unsigned int index2 = index1 + 1; index2 < count;
+                     ++index2)
+                {
+                    uint32_t cluster2 = owner[index2];
+                    bool facing;
+
+                    // Patches outside the kept clusters, or too close to a
+                    // plane to tell, need the full test
+                    if ((cluster1 == NO_CLUSTER) || (cluster2 == NO_CLUSTER))
+                    {
+                        facing = patch1->IsFacing(patches->at(index2));
+                    }
+                    else
+                    {
+                        char side1 = sides1[cluster2];
+                        char side2 = sides[std::size_t(index2) * numClusters +
+                                           cluster1];
 
-                // Do not compare a patch against itself
-                if (patch2 == patch3)
+                        facing = !parallel1[cluster2] && (side1 != BEHIND) &&
+                                 (side2 != BEHIND) &&
+                                 (((side1 == IN_FRONT) &&
+                                   (side2 == IN_FRONT)) ||
+                                  patch1->IsFacing(patches->at(index2)));
+                    }
+
+                    if (facing)
+                    {
+                        word |= uint64_t(1) << bit;
+                    }
+
+                    if (++bit == 64)
+                    {
+                        *words++ = word;
+                        word = 0;
+                        bit = 0;
+                    }
+                }
+
+                if (bit > 0)
                 {
-                    continue;
+                    *words = word;
                 }
+            }
+        };
+
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(count, 16, fill);
+    }
+    else
+    {
+        fill(0, count, 0);
+    }
 
-                // Calculate the distance between patch 1 and patch 3 along the
-                // ray. If this distance is shorter than the distance to patch
-                // 2 along this ray, patch 3 is closer than, and therefore
-                // blocking, patch 2.
-                float new_distance = patch3->Intersect(ray, patch1->GetCenter());
+} // RunQuickElimination
+
+bool SightCalculator::PlaneKey::operator==(const PlaneKey &other) const
+{
+    return mX == other.mX && mY == other.mY && mZ == other.mZ &&
+           mOffset == other.mOffset;
+}
+
+std::size_t SightCalculator::PlaneKeyHash::operator()(const PlaneKey &key)
+    const
+{
+    // Large odd multipliers spread neighbouring keys apart
+    uint64_t hash = static_cast<uint64_t>(key.mX) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<uint64_t>(key.mY) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= static_cast<uint64_t>(key.mZ) * 0x165667B19E3779F9ull;
+    hash ^= static_cast<uint64_t>(key.mOffset) * 0x27D4EB2F165667C5ull;
+    return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
 
-                if ((new_distance > 0) && (new_distance < shortest_distance))
+void SightCalculator::BuildClusters(const std::vector<Patch*> *patches,
+                                    float tolerance,
+                                    std::vector<Cluster> &clusters)
+{
+    typedef std::unordered_map<PlaneKey, uint32_t, PlaneKeyHash> PlaneMap;
+    PlaneMap found;
+
+    clusters.clear();
+
+    // Patches whose rounded normals and plane offsets agree share a
+    // cluster. Planes that round apart only cost a cluster more: parallel
+    // clusters are still culled as a pair.
+    for (unsigned int index = 0; index < patches->size(); ++index)
+    {
+        const Patch *patch = patches->at(index);
+        const Vector &normal = patch->GetNormal();
+        const Point &center = patch->GetCenter();
+        float offset = dotProduct(normal, Vector(center.X(), center.Y(),
+                                                 center.Z()));
+
+        PlaneKey key = {
+            static_cast<int64_t>(std::floor(normal.X() / NORMAL_TOLERANCE)),
+            static_cast<int64_t>(std::floor(normal.Y() / NORMAL_TOLERANCE)),
+            static_cast<int64_t>(std::floor(normal.Z() / NORMAL_TOLERANCE)),
+            static_cast<int64_t>(std::floor(offset / tolerance)) };
+
+        std::pair<PlaneMap::iterator, bool> inserted =
+            found.insert(std::make_pair(key, uint32_t(clusters.size())));
+
+        if (inserted.second)
+        {
+            clusters.push_back(Cluster());
+            clusters.back().normal = normal;
+        }
+
+        clusters[inserted.first->second].members.push_back(index);
+    }
+
+    // Keep the largest clusters; ties go to the one found first
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster &first, const Cluster &second)
+        {
+            return first.members.size() > second.members.size();
+        });
+
+    if (clusters.size() > MAX_CLUSTERS)
+    {
+        clusters.resize(MAX_CLUSTERS);
+    }
+
+    // Measure every member against the plane of the cluster
+    for (unsigned int cluster = 0; cluster < clusters.size(); ++cluster)
+    {
+        Cluster &current = clusters[cluster];
+
+        for (unsigned int entry = 0; entry < current.members.size(); ++entry)
+        {
+            const Point &center =
+                patches->at(current.members[entry])->GetCenter();
+            float offset = dotProduct(current.normal,
+                                      Vector(center.X(), center.Y(),
+                                             center.Z()));
+
+            if ((entry == 0) || (offset < current.minOffset))
+            {
+                current.minOffset = offset;
+            }
+
+            if ((entry == 0) || (offset > current.maxOffset))
+            {
+                current.maxOffset = offset;
+            }
+        }
+    }
+}
+
+char SightCalculator::Classify(const Patch *patch, const Cluster &cluster,
+                               float tolerance)
+{
+    const Point &center = patch->GetCenter();
+
+    // Distance of the center from the nearest and farthest planes of the
+    // cluster
+    float offset = dotProduct(cluster.normal,
+                              Vector(center.X(), center.Y(), center.Z()));
+    float nearest = offset - cluster.maxOffset;
+    float farthest = offset - cluster.minOffset;
+
+    if (nearest > tolerance)
+    {
+        return IN_FRONT;
+    }
+    else if (farthest < -tolerance)
+    {
+        return BEHIND;
+    }
+
+    return UNSURE;
+}
+
+void SightCalculator::RunInterceptTest(std::vector<Patch*> *patches,
+                                       const Bvh *bvh,
+                                       VisibilityMatrix *visibility)
+{
+    unsigned int count = patches->size();
+
+    // Test every pair once, in the row of the patch with the lower index,
+    // and clear the hidden ones in place
+    ThreadPool::RangeTask test =
+        [&](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for (std::size_t index = begin; index < end; ++index)
+            {
+                const Patch *patch1 = patches->at(index);
+                uint64_t *words = visibility->RowWords(index);
+
+                for (unsigned int word = 0;
+                     word < visibility->RowWordCount(index); ++word)
                 {
-                    // Remove patch2 from patch1's line of sight and patch1
-                    // ftom patch2's line of sight
-                    patch2->RemoveViewablePatch(patch1);
-                    patch1->RemoveViewablePatch(patch2);
-                    --iter2;
+                    uint64_t bits = words[word];
 
-                    break;
-                }
+                    while (bits != 0)
+                    {
+                        int bit = __builtin_ctzll(bits);
+                        const Patch *patch2 =
+                            patches->at(index + 1 + word * 64 + bit);
 
-            } // for (siter; siter != patches->end(); ++siter)
+                        if (IsOccluded(patch1, patch2, bvh))
+                        {
+                            words[word] &= ~(uint64_t(1) << bit);
+                        }
 
-        } // Loop over line of sight vector
+                        bits &= bits - 1;
+                    }
+                }
+            }
+        };
 
-    } // Loop over all patches
+    if (mPool != nullptr)
+    {
+        mPool->ParallelFor(count, 16, test);
+    }
+    else
+    {
+        test(0, count, 0);
+    }
 
 } // RunInterceptTest
 
+bool SightCalculator::IsOccluded(const Patch *patch1, const Patch *patch2,
+                                 const Bvh *bvh) const
+{
+    // Fire a ray between the centers, then between matching corners
+    for (int sample = 0; sample < OCCLUSION_SAMPLES; ++sample)
+    {
+        Point origin = SamplePoint(patch1, sample);
+        Point target = SamplePoint(patch2, sample);
+
+        // Calculate the vector between the sample points
+        Vector ray(target, origin);
+        normalize(ray);
+
+        float distance = origin.DistanceTo(target);
+
+        // Any patch hit before patch 2 along the ray blocks it
+        if (!bvh->Occluded(ray, origin, distance, patch1->GetIndex(),
+                           patch2->GetIndex()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Point SightCalculator::SamplePoint(const Patch *patch, int sample) const
+{
+    const Point &center = patch->GetCenter();
+    const Point *corners[4] =
+        { patch->GetA(), patch->GetB(), patch->GetC(), patch->GetD() };
+
+    if (sample == 0)
+    {
+        return center;
+    }
+
+    Vector offset = scalarMultiply(Vector(*corners[sample - 1], center),
+                                   1 - OCCLUSION_INSET);
+
+    return offset.Translate(center);
+}
+
 } // namespace Radiosity
@@ -0,0 +1,263 @@
+///
+/// @file VisibilityMatrix.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Packed, symmetric bit matrix recording which pairs of patches have
+///     line of sight to each other.
+///
+
+#include "visibilitymatrix.h"
+
+#include <algorithm>
+
+namespace Radiosity
+{
+
+VisibilityMatrix::VisibilityMatrix():
+    mSize(0),
+    mOffsets(1, 0)
+{
+}
+
+VisibilityMatrix::~VisibilityMatrix()
+{
+}
+
+void VisibilityMatrix::Reset(unsigned int size)
+{
+    mSize = size;
+    mOffsets.resize(size + 1);
+    mOffsets[0] = 0;
+
+    for (unsigned int row = 0; row < size; ++row)
+    {
+        unsigned int bits = size - row - 1;
+        mOffsets[row + 1] = mOffsets[row] + (bits + 63) / 64;
+    }
+
+    mWords.assign(mOffsets[size], 0);
+}
+
+void VisibilityMatrix::Set(uint32_t a, uint32_t b)
+{
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+
+    uint32_t bit = b - a - 1;
+    mWords[mOffsets[a] + bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+void VisibilityMatrix::Clear(uint32_t a, uint32_t b)
+{
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+
+    uint32_t bit = b - a - 1;
+    mWords[mOffsets[a] + bit / 64] &= ~(uint64_t(1) << (bit % 64));
+}
+
+uint64_t VisibilityMatrix::Columns(uint32_t row, uint32_t first) const
+{
+    // Bit k of the row is column row + 1 + k, so the block starts at bit
+    // first - row - 1, which may fall before the row or inside a word
+    int64_t start = int64_t(first) - row - 1;
+    const uint64_t *words = RowWords(row);
+    int64_t count = RowWordCount(row);
+
+    if (start <= -64)
+    {
+        return 0;
+    }
+
+    if (start < 0)
+    {
+        return (count > 0) ? words[0] << -start : 0;
+    }
+
+    int64_t word = start / 64;
+    int shift = start % 64;
+
+    if (word >= count)
+    {
+        return 0;
+    }
+
+    uint64_t bits = words[word] >> shift;
+
+    if ((shift > 0) && (word + 1 < count))
+    {
+        bits |= words[word + 1] << (64 - shift);
+    }
+
+    return bits;
+}
+
+void VisibilityMatrix::Transpose(uint64_t block[64])
+{
+    // Swap ever smaller off-diagonal sub-blocks: halves, then quarters,
+    // down to single bits
+    uint64_t mask = 0x00000000FFFFFFFFull;
+
+    for (int width = 32; width > 0; width >>= 1, mask ^= mask << width)
+    {
+        for (int row = 0; row < 64; row = ((row | width) + 1) & ~width)
+        {
+            uint64_t swap = ((block[row] >> width) ^ block[row | width]) &
+                            mask;
+            block[row] ^= swap << width;
+            block[row | width] ^= swap;
+        }
+    }
+}
+
+uint64_t VisibilityMatrix::LowerColumns(uint32_t row, uint32_t first) const
+{
+    // Rows first to first + 63 hold the pairs, each in the 64 columns of
+    // the block that contains this row
+    uint32_t column = row & ~uint32_t(63);
+    uint64_t block[64];
+    bool empty = true;
+
+    for (uint32_t offset = 0; offset < 64; ++offset)
+    {
+        uint32_t other = first + offset;
+        block[offset] = (other < row) ? Columns(other, column) : 0;
+        empty = empty && (block[offset] == 0);
+    }
+
+    if (empty)
+    {
+        return 0;
+    }
+
+    Transpose(block);
+
+    return block[row - column];
+}
+
+std::size_t VisibilityMatrix::Count(uint32_t row) const
+{
+    std::size_t count = 0;
+
+    for (uint32_t first = 0; first < row; first += 64)
+    {
+        count += __builtin_popcountll(LowerColumns(row, first));
+    }
+
+    for (std::size_t word = mOffsets[row]; word < mOffsets[row + 1]; ++word)
+    {
+        count += __builtin_popcountll(mWords[word]);
+    }
+
+    return count;
+}
+
+std::size_t VisibilityMatrix::Pairs() const
+{
+    std::size_t count = 0;
+
+    for (std::size_t word = 0; word < mWords.size(); ++word)
+    {
+        count += __builtin_popcountll(mWords[word]);
+    }
+
+    return count;
+}
+
+void VisibilityMatrix::Row(uint32_t row, std::vector<uint32_t> &indices) const
+{
+    indices.clear();
+
+    // Walk the set bits of the row a word at a time, lower patches first
+    for (uint32_t first = 0; first < row; first += 64)
+    {
+        uint64_t bits = LowerColumns(row, first);
+
+        while (bits != 0)
+        {
+            indices.push_back(first + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+
+    const uint64_t *words = RowWords(row);
+
+    for (unsigned int word = 0; word < RowWordCount(row); ++word)
+    {
+        uint64_t bits = words[word];
+
+        while (bits != 0)
+        {
+            indices.push_back(row + 1 + word * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+std::size_t VisibilityMatrix::MemoryUsage() const
+{
+    return mWords.capacity() * sizeof(uint64_t) +
+           mOffsets.capacity() * sizeof(std::size_t);
+}
+
+std::size_t VisibilityMatrix::Validate() const
+{
+    std::size_t differ = 0;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> expected;
+
+    for (uint32_t row = 0; row < mSize; ++row)
+    {
+        expected.clear();
+
+        for (uint32_t column = 0; column < mSize; ++column)
+        {
+            if (Get(row, column))
+            {
+                expected.push_back(column);
+            }
+        }
+
+        Row(row, indices);
+
+        if ((indices != expected) || (Count(row) != expected.size()))
+        {
+            ++differ;
+        }
+    }
+
+    return differ;
+}
+
+bool VisibilityMatrix::Write(FILE *file) const
+{
+    uint32_t size = mSize;
+
+    return (fwrite(&size, sizeof(size), 1, file) == 1) &&
+           (fwrite(mWords.data(), sizeof(uint64_t), mWords.size(), file) ==
+            mWords.size());
+}
+
+bool VisibilityMatrix::Read(FILE *file)
+{
+    uint32_t size;
+
+    if (fread(&size, sizeof(size), 1, file) != 1)
+    {
+        return false;
+    }
+
+    Reset(size);
+
+    return fread(mWords.data(), sizeof(uint64_t), mWords.size(), file) ==
+           mWords.size();
+}
+
+}   // namespace Radiosity
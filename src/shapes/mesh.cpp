@@ -0,0 +1,174 @@
+///
+/// @file Mesh.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	The corners of every patch of a scene, held in one array. Patches
+///     refer to their corners by index, and corners that coincide on the
+///     same plane, such as those along the edge between two quads of one
+///     wall, are welded into one.
+///
+
+#include "mesh.h"
+#include "patch.h"
+
+#include <cmath>
+
+// Marks the end of the chain of vertices in a cell
+#define NO_VERTEX 0xFFFFFFFFu
+
+namespace Radiosity
+{
+
+Mesh::Mesh(float tolerance):
+    mTolerance(tolerance)
+{
+}
+
+Mesh::~Mesh()
+{
+}
+
+bool Mesh::Cell::operator==(const Cell &other) const
+{
+    return mX == other.mX && mY == other.mY && mZ == other.mZ;
+}
+
+std::size_t Mesh::CellHash::operator()(const Cell &cell) const
+{
+    // Large odd multipliers spread neighbouring cells apart
+    uint64_t hash = static_cast<uint64_t>(cell.mX) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<uint64_t>(cell.mY) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= static_cast<uint64_t>(cell.mZ) * 0x165667B19E3779F9ull;
+    return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
+
+uint32_t Mesh::Weld(const Point &point, const Vector &normal)
+{
+    Vector unit = normal;
+    normalize(unit);
+
+    float coordinates[3] = { point.X(), point.Y(), point.Z() };
+    int64_t first[3];
+    Cell cell;
+    int64_t *axes[3] = { &cell.mX, &cell.mY, &cell.mZ };
+
+    // Cells are twice the tolerance on a side, so a vertex within the
+    // tolerance lies in this cell or the neighbour on the nearer side
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float position = coordinates[axis] / (2 * mTolerance);
+        float lower = std::floor(position);
+
+        first[axis] = static_cast<int64_t>(lower) -
+                      (position - lower < 0.5f ? 1 : 0);
+        *axes[axis] = static_cast<int64_t>(lower);
+    }
+
+    for (int neighbour = 0; neighbour < 8; ++neighbour)
+    {
+        Cell probe = { first[0] + (neighbour & 1),
+                       first[1] + ((neighbour >> 1) & 1),
+                       first[2] + ((neighbour >> 2) & 1) };
+        std::unordered_map<Cell, uint32_t, CellHash>::const_iterator found =
+            mCells.find(probe);
+
+        if (found == mCells.end())
+        {
+            continue;
+        }
+
+        for (uint32_t index = found->second; index != NO_VERTEX;
+             index = mNext[index])
+        {
+            const Point &vertex = mVertices[index];
+
+            if (std::fabs(vertex.X() - point.X()) <= mTolerance &&
+                std::fabs(vertex.Y() - point.Y()) <= mTolerance &&
+                std::fabs(vertex.Z() - point.Z()) <= mTolerance &&
+                dotProduct(mNormals[index], unit) > WELD_COSINE)
+            {
+                return index;
+            }
+        }
+    }
+
+    return Insert(point, unit, cell);
+}
+
+uint32_t Mesh::Add(const Point &point, const Vector &normal)
+{
+    Vector unit = normal;
+    normalize(unit);
+
+    float size = 2 * mTolerance;
+    Cell cell = { static_cast<int64_t>(std::floor(point.X() / size)),
+                  static_cast<int64_t>(std::floor(point.Y() / size)),
+                  static_cast<int64_t>(std::floor(point.Z() / size)) };
+
+    return Insert(point, unit, cell);
+}
+
+uint32_t Mesh::Insert(const Point &point, const Vector &normal,
+                      const Cell &cell)
+{
+    uint32_t index = mVertices.size();
+    mVertices.push_back(Point(point.X(), point.Y(), point.Z()));
+    mNormals.push_back(normal);
+    mColors.push_back(Color());
+
+    // Chain the vertex in front of any others in its cell
+    std::pair<std::unordered_map<Cell, uint32_t, CellHash>::iterator, bool>
+        inserted = mCells.insert(std::make_pair(cell, index));
+    mNext.push_back(inserted.second ? NO_VERTEX : inserted.first->second);
+    inserted.first->second = index;
+
+    return index;
+}
+
+std::size_t Mesh::MemoryUsage() const
+{
+    return mVertices.capacity() * sizeof(Point) +
+           mNormals.capacity() * sizeof(Vector) +
+           mColors.capacity() * sizeof(Color) +
+           mNext.capacity() * sizeof(uint32_t);
+}
+
+void Mesh::UpdateColors(const std::vector<Patch*> *patches)
+{
+    std::vector<unsigned int> counts(mVertices.size(), 0);
+    mColors.assign(mVertices.size(), Color());
+
+    for (std::vector<Patch*>::const_iterator iter = patches->begin();
+         iter != patches->end(); ++iter)
+    {
+        const Patch *patch = *iter;
+        Color color = patch->GetColor() * patch->GetExidence();
+
+        // Unlit patches do not darken the corners they share
+        if (color == Color())
+        {
+            continue;
+        }
+
+        const uint32_t *corners = patch->GetCorners();
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            mColors[corners[corner]] += color;
+            ++counts[corners[corner]];
+        }
+    }
+
+    for (uint32_t index = 0; index < mVertices.size(); ++index)
+    {
+        if (counts[index] > 0)
+        {
+            mColors[index] = mColors[index] * (1.0f / counts[index]);
+        }
+    }
+}
+
+}   // namespace Radiosity
@@ -1,3 +1,5 @@
+SOURCE += mesh.cpp
 SOURCE += patch.cpp
 SOURCE += rectangle.cpp
+SOURCE += rectanglebatch.cpp
 SOURCE += shape.cpp
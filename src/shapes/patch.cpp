@@ -8,11 +8,15 @@
 /// 	Implements a radiosity patch data structure.
 ///
 
-#define COLOR_BLENDING
-
 #include "patch.h"
+#include "patchstore.h"
 #include <GL/glut.h>
 
+#include <algorithm>
+#include <cmath>
+
+#define PI 3.141592654
+
 namespace Radiosity
 {
 
@@ -21,59 +25,59 @@ int Patch::mNumPatches(0);
 //
 // Constructor
 //
-Patch::Patch(Point *a, Point *b, Point *c, Point *d, Color col, float emission):
-    mA(a),
-    mB(b),
-    mC(c),
-    mD(d),
-    mColor(col)
+Patch::Patch(const Mesh *mesh, uint32_t a, uint32_t b, uint32_t c, uint32_t d,
+             Color col, float emission):
+    mMesh(mesh),
+    mCorners{a, b, c, d},
+    mColor(col),
+    mIndex(0),
+    mParent(-1),
+    mStore(nullptr)
 {
+    const Point &A = mMesh->GetVertex(a);
+    const Point &B = mMesh->GetVertex(b);
+    const Point &C = mMesh->GetVertex(c);
+
     // Calculate the normal vector
-    Vector AB(*mB, *mA);
-    Vector BC(*mC, *mB);
+    Vector AB(B, A);
+    Vector BC(C, B);
     mPatchNormal = crossProduct(BC, AB);
     normalize(mPatchNormal);
 
     // Calculate the area
-    float dAB = mA->DistanceTo(*mB);
-    float dBC = mB->DistanceTo(*mC);
+    float dAB = A.DistanceTo(B);
+    float dBC = B.DistanceTo(C);
     mArea = dAB * dBC;
 
     // Calculate the center point
-    Vector AC(*mC, *mA);
+    Vector AC(C, A);
     normalize(AC);
     float dist = sqrt((dAB/2) * (dAB/2) + (dBC/2) * (dBC/2));
-    mCenterPoint = scalarMultiply(AC, dist).Translate(*mA);
+    mCenterPoint = scalarMultiply(AC, dist).Translate(A);
 
     // Emission
     mEmission = col * emission;
 
-    // Create the patch line of sight vector
-    mViewablePatches = new std::vector<Patch*>;
-
-    // Create the form factor vector
-    mFormFactors = new std::vector<float>;
-
     mReflectance = .85;
-
-    mIncidence = Color();
-
-    mExidence = mEmission;
 }
 
 Patch::~Patch()
 {
-    delete mViewablePatches;
-    delete mFormFactors;
 }
 
 void Patch::Draw()
 {
     glBegin(GL_QUADS);
-	mA->Draw();
-	mB->Draw();
-	mC->Draw();
-	mD->Draw();
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        const Point &point = mMesh->GetVertex(mCorners[corner]);
+        const Color &color = mMesh->GetColor(mCorners[corner]);
+
+        glColor3f(color.R(), color.G(), color.B());
+        glVertex3f(point.X(), point.Y(), point.Z());
+    }
+
     glEnd();
 }
 
@@ -83,14 +87,16 @@ void Patch::DrawOutline()
     glColor3f(0,0,0);
 
     glBegin(GL_LINES);
-	mA->DrawNoColor();
-	mB->DrawNoColor();
-	mB->DrawNoColor();
-	mC->DrawNoColor();
-	mC->DrawNoColor();
-	mD->DrawNoColor();
-	mD->DrawNoColor();
-	mA->DrawNoColor();
+
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        const Point &from = mMesh->GetVertex(mCorners[corner]);
+        const Point &to = mMesh->GetVertex(mCorners[(corner + 1) % 4]);
+
+        glVertex3f(from.X(), from.Y(), from.Z());
+        glVertex3f(to.X(), to.Y(), to.Z());
+    }
+
     glEnd();
 }
 
@@ -107,7 +113,7 @@ void Patch::DrawNormal()
 	glEnd();
 }
 
-float Patch::Intersect(Vector v, Point o)
+float Patch::Intersect(const Vector &v, const Point &o) const
 {
     // Check if vector is parallel to plane (no intercept)
     if (dotProduct(v, mPatchNormal) == 0)
@@ -117,15 +123,15 @@ float Patch::Intersect(Vector v, Point o)
 
     // Find the distance from the ray origin to the intersect point
     float distance = 0;
-    distance = dotProduct(Vector(*mA, o), mPatchNormal) / dotProduct(v, mPatchNormal);
+    distance = dotProduct(Vector(*GetA(), o), mPatchNormal) / dotProduct(v, mPatchNormal);
 
     // From the distance, calculate the intersect point
     Point intersect = scalarMultiply(v, distance).Translate(o);
 
     // Test to see if the point is inside the rectangle
-    Vector CI(intersect, *mC);
-    Vector BC(*mB, *mC);
-    Vector CD(*mD, *mC);
+    Vector CI(intersect, *GetC());
+    Vector BC(*GetB(), *GetC());
+    Vector CD(*GetD(), *GetC());
 
     if (((0 <= dotProduct(CI, BC)) &&
         (dotProduct(CI, BC) < dotProduct(BC, BC)) &&
@@ -144,9 +150,9 @@ float Patch::Intersect(Vector v, Point o)
 bool Patch::Contains(Point p) const
 {
     // Test to see if the point is inside the rectangle
-    Vector CI(p, *mC);
-    Vector BC(*mB, *mC);
-    Vector CD(*mD, *mC);
+    Vector CI(p, *GetC());
+    Vector BC(*GetB(), *GetC());
+    Vector CD(*GetD(), *GetC());
 
     return !(((0 <= dotProduct(CI, BC)) &&
         (dotProduct(CI, BC) < dotProduct(BC, BC)) &&
@@ -183,68 +189,46 @@ bool Patch::IsFacing(const Patch *other) const
 	return false;
 }
 
-void Patch::AddViewablePatch(Patch *patch)
+float Patch::PointFormFactor(const Point &point, const Vector &normal) const
 {
-    // Add the patch to the line of sight vector
-    mViewablePatches->push_back(patch);
+    const Point *corners[4] = { GetA(), GetB(), GetC(), GetD() };
+    double sum = 0;
 
-    // Add a form factor for this patch in parallel
-    mFormFactors->push_back(0);
-}
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        Vector r1(*corners[corner], point);
+        Vector r2(*corners[(corner + 1) % 4], point);
 
-void Patch::RemoveViewablePatch(Patch *patch)
-{
-    std::vector<Patch*>::iterator iter1 = mViewablePatches->begin();
+        normalize(r1);
+        normalize(r2);
 
-    for (; iter1 != mViewablePatches->end(); ++iter1)
-    {
-        // Remove the viewable patch, and its form factor
-        if (*iter1 == patch)
+        Vector edge = crossProduct(r1, r2);
+        double length = std::sqrt(dotProduct(edge, edge));
+
+        // An edge seen end on subtends no angle
+        if (length == 0)
         {
-            iter1 = mViewablePatches->erase(iter1);
-            break;
+            continue;
         }
-    }
 
-    // Add a form factor for this patch in parallel
-    mFormFactors->pop_back();
-}
+        double angle = std::acos(std::max(-1.0f,
+                                          std::min(1.0f, dotProduct(r1, r2))));
 
-void Patch::UpdateFormFactor(int index, float formFactor)
-{
-    mFormFactors->at(index) += formFactor;
+        sum += angle * dotProduct(edge, normal) / length;
+    }
+
+    // The sign depends on which way round the corners are wound
+    return std::fabs(sum) / (2 * PI);
 }
 
-void Patch::UpdateIncidence()
+Color Patch::GetExidence() const
 {
-    // Set incidence to zero so that the last iteration is not added
-    // in again.
-    mIncidence = Color();
-
-    // For every viewable patch
-    for (unsigned int index(0); index < mViewablePatches->size(); ++index)
+    if (mStore == nullptr)
     {
-        // Update the patch's incident light
-        mIncidence += mViewablePatches->at(index)->mExidence *
-            mFormFactors->at(index);
+        return mEmission;
     }
-}
 
-void Patch::UpdateExidence()
-{
-#ifdef COLOR_BLENDING
-    mExidence = mIncidence * (mColor * mReflectance) + mEmission;
-#else
-    mExidence = mIncidence * (mReflectance) + mEmission;
-#endif
-}
-
-void Patch::UpdateCornerColors()
-{
-    mA->UpdateColor((mColor * mExidence));
-    mB->UpdateColor((mColor * mExidence));
-    mC->UpdateColor((mColor * mExidence));
-    mD->UpdateColor((mColor * mExidence));
+    return mStore->GetExidence(mIndex);
 }
 
 }   // namespace Radiosity
@@ -19,8 +19,7 @@ Rectangle::Rectangle(Point a, Point b, Point c, Point d, Color color, float emit
     _a(a),
     _b(b),
     _c(c),
-    _d(d),
-    mPatches(nullptr)
+    _d(d)
 {
 
     // calculate the normal vector
@@ -34,143 +33,48 @@ Rectangle::~Rectangle()
 {
 }
 
-Point* Rectangle::Intersect(Vector v, Point o)
+Hit Rectangle::Intersect(const Vector &v, const Point &o, float limit) const
 {
+    Hit hit;
+
+    float facing = dotProduct(v, _normal);
+
     // Check if vector is parallel to plane (no intercept)
-    if (dotProduct(v, _normal) == 0)
+    if (facing == 0)
     {
-        return nullptr;
+        return hit;
     }
 
-    // Find the distance from the ray origin to the intersect point
-    float distance = dotProduct(Vector(_a, o), _normal) / dotProduct(v, _normal);
+    // Find the distance from the ray origin to the intersect point, and
+    // give up early if it is behind the origin or past the limit
+    float distance = dotProduct(Vector(_a, o), _normal) / facing;
+
+    if ((distance <= 0) || (distance >= limit))
+    {
+        return hit;
+    }
 
     // From the distance, calculate the intersect point
-    Point *intersect = new Point(scalarMultiply(v, distance).Translate(o));
+    Vector offset = scalarMultiply(v, distance);
+    Point intersect = offset.Translate(o);
 
     // Test to see if the point is inside the rectangle
-    Vector v_test(*intersect, _c);
+    Vector v_test(intersect, _c);
     Vector v1_test(_b, _c);
-    Vector v2_test(_c, _d);
+    Vector v2_test(_d, _c);
 
-    if ( (0 <= dotProduct(v_test, v1_test)) &&
-         (dotProduct(v_test, v1_test) < dotProduct(v1_test, v1_test)) &&
-         (0 <= dotProduct(v_test, v2_test)) &&
-         (dotProduct(v_test, v2_test) < dotProduct(v2_test, v2_test)))
-    {
-        return intersect;
-    }
-    else
+    float u = dotProduct(v_test, v1_test) / dotProduct(v1_test, v1_test);
+    float w = dotProduct(v_test, v2_test) / dotProduct(v2_test, v2_test);
+
+    if ((0 <= u) && (u < 1) && (0 <= w) && (w < 1))
     {
-        // does not intersect plane within the rectangle
-        return nullptr;
+        hit.t = distance;
+        hit.u = u;
+        hit.v = w;
     }
-}
 
-void Rectangle::Subdivide(float patchSize)
-{
-	if (mPatches == nullptr)
-	{
-		mPatches = new std::vector< Patch* >();
-
-		// Calculate the number of patches along one axis
-		float distance_i = _a.DistanceTo(_b);
-		float dimension_i = distance_i / patchSize;
-		int size_i = int(dimension_i);
-		float remainder_i = dimension_i - size_i;
-
-		if (remainder_i > 0)
-		{
-			++size_i;
-		}
-
-		// Calculate the number of patches along the other axis
-		float distance_j = _a.DistanceTo(_d);
-		float dimension_j = distance_j / patchSize;
-		int size_j = int(dimension_j);
-		float remainder_j = dimension_j - size_j;
-
-		if (remainder_j > 0)
-		{
-			++size_j;
-		}
-
-		// Create a two-dimensional vector to hold points
-		std::vector< std::vector<Point*> > points(size_i + 1, std::vector<Point*>(size_j + 1,
-			(Point*)nullptr));
-
-		Vector AB(_b, _a);
-		Vector AD(_d, _a);
-		float len_AB = _b.DistanceTo(_a);
-		float len_AD = _d.DistanceTo(_a);
-
-		normalize(AB);
-		normalize(AD);
-
-		Point *p1;
-
-		// Create the starting point
-		p1 = new Point(_a);
-
-		// Loop in AD direction
-		for (int j = 0; j <= size_j; ++j)
-		{
-			// add p1 to the list
-			points.at(0).at(j) = p1;
-
-			Point *p2 = p1;
-
-			// Loop in AB direction
-			for (int i = 0; i < size_i; ++i)
-			{
-			    Point *p3;
-
-				// Check boundary
-				if (i == size_i - 1)
-				{
-					p3 = new Point(scalarMultiply(AB, len_AB).Translate(*p1));
-				}
-				else
-				{
-					p3 = new Point(scalarMultiply(AB, patchSize).Translate(*p2));
-				}
-
-				// add p3 to the list
-				points.at(i+1).at(j) = p3;
-
-				// Update p2
-				p2 = p3;
-			}
-
-			// Update p1
-			if (j == size_j - 1)
-			{
-				p1 = new Point(scalarMultiply(AD, len_AD).Translate(_a));
-			}
-			else
-			{
-				p1 = new Point(scalarMultiply(AD, patchSize).Translate(*p1));
-			}
-		}
-
-		// Create the patches
-		// Loop in AD direction
-		for (int j = 0; j < size_j; ++j)
-		{
-			// Loop in AB direction
-			for (int i = 0; i < size_i; ++i)
-			{
-				Point *A = points.at(i).at(j);
-				Point *B = points.at(i+1).at(j);
-				Point *C = points.at(i+1).at(j+1);
-				Point *D = points.at(i).at(j+1);
-
-				// Create the patch
-				Patch *p = new Patch(A, B, C, D, GetColor(), emission);
-				mPatches->push_back(p);
-			}
-		}
-	}
+    // otherwise it does not intersect plane within the rectangle
+    return hit;
 }
 
 Point Rectangle::A() const
@@ -193,4 +97,9 @@ Point Rectangle::D() const
     return _d;
 }
 
+Vector Rectangle::Normal() const
+{
+    return _normal;
+}
+
 }   // namespace Radiosity
@@ -0,0 +1,115 @@
+///
+/// @file RectangleBatch.cpp
+///
+/// @author	Thomas Kohlman
+/// @date 17 October 2026
+///
+/// @description
+/// 	Rectangles stored contiguously, one array per coordinate, so that a
+///     ray can be tested against all of them in one tight loop.
+///
+
+#include "rectanglebatch.h"
+
+namespace Radiosity
+{
+
+RectangleBatch::RectangleBatch(const std::vector<Rectangle*> *rectangles)
+{
+    for (unsigned int index = 0; index < rectangles->size(); ++index)
+    {
+        const Rectangle *rectangle = rectangles->at(index);
+
+        Point a = rectangle->A();
+        Point c = rectangle->C();
+        Vector edge1(rectangle->B(), c);
+        Vector edge2(rectangle->D(), c);
+        Vector normal = crossProduct(Vector(rectangle->D(), a),
+                                     Vector(rectangle->B(), a));
+
+        const float plane[3] = { a.X(), a.Y(), a.Z() };
+        const float corner[3] = { c.X(), c.Y(), c.Z() };
+        const float e1[3] = { edge1.X(), edge1.Y(), edge1.Z() };
+        const float e2[3] = { edge2.X(), edge2.Y(), edge2.Z() };
+        const float n[3] = { normal.X(), normal.Y(), normal.Z() };
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            mPlane[axis].push_back(plane[axis]);
+            mCorner[axis].push_back(corner[axis]);
+            mEdge1[axis].push_back(e1[axis]);
+            mEdge2[axis].push_back(e2[axis]);
+            mNormal[axis].push_back(n[axis]);
+        }
+
+        mLength1.push_back(dotProduct(edge1, edge1));
+        mLength2.push_back(dotProduct(edge2, edge2));
+    }
+}
+
+RectangleBatch::~RectangleBatch()
+{
+}
+
+Hit RectangleBatch::Intersect(const Vector &v, const Point &o, float limit,
+                              int skip) const
+{
+    Hit hit;
+
+    const float origin[3] = { o.X(), o.Y(), o.Z() };
+    const float direction[3] = { v.X(), v.Y(), v.Z() };
+
+    for (int index = 0; index < int(Size()); ++index)
+    {
+        float facing = direction[0] * mNormal[0][index] +
+                       direction[1] * mNormal[1][index] +
+                       direction[2] * mNormal[2][index];
+
+        // Parallel to the plane (no intercept), or left out
+        if ((facing == 0) || (index == skip))
+        {
+            continue;
+        }
+
+        // Give up early if the plane is behind the origin or past the
+        // nearest hit so far
+        float t = ((mPlane[0][index] - origin[0]) * mNormal[0][index] +
+                   (mPlane[1][index] - origin[1]) * mNormal[1][index] +
+                   (mPlane[2][index] - origin[2]) * mNormal[2][index]) /
+                  facing;
+
+        if ((t <= 0) || (t >= limit))
+        {
+            continue;
+        }
+
+        // Position of the hit relative to corner C
+        float local[3];
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            local[axis] = (origin[axis] + direction[axis] * t) -
+                          mCorner[axis][index];
+        }
+
+        float u = (local[0] * mEdge1[0][index] +
+                   local[1] * mEdge1[1][index] +
+                   local[2] * mEdge1[2][index]) / mLength1[index];
+        float w = (local[0] * mEdge2[0][index] +
+                   local[1] * mEdge2[1][index] +
+                   local[2] * mEdge2[2][index]) / mLength2[index];
+
+        if ((0 <= u) && (u < 1) && (0 <= w) && (w < 1))
+        {
+            limit = t;
+            hit.t = t;
+            hit.u = u;
+            hit.v = w;
+            hit.shape = index;
+        }
+    }
+
+    return hit;
+}
+
+}   // namespace Radiosity